@@ -0,0 +1,422 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+#include <kcp/keypoint.hpp>
+#include <kcp/sampler.hpp>
+#include <kcp/solver.hpp>
+#include <kcp/utility.hpp>
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pcd.hpp"
+
+namespace {
+
+/**
+ * @brief The resolution of 360-degree horizontal field of view of synthetic
+ * scans.
+ *
+ */
+constexpr int HFOV_RESOLUTION = 1800;
+
+/**
+ * @brief The noise bound of TEASER++ used by registration benchmarks.
+ *
+ */
+constexpr double NOISE_BOUND = 0.06;
+
+/**
+ * @brief Per-iteration latencies of a benchmark, reported as percentile
+ * counters (in milliseconds) to track tail latency besides the mean.
+ *
+ */
+class LatencyRecorder {
+ protected:
+  std::vector<double> latencies;
+  std::chrono::steady_clock::time_point start_time;
+
+ public:
+  void start() { this->start_time = std::chrono::steady_clock::now(); }
+
+  void stop() {
+    const auto elapsed = std::chrono::steady_clock::now() - this->start_time;
+    this->latencies.push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+  }
+
+  void report(benchmark::State &state) {
+    if (this->latencies.empty()) return;
+
+    std::sort(this->latencies.begin(), this->latencies.end());
+    auto percentile = [this](double p) {
+      const size_t idx = static_cast<size_t>(std::ceil(p * this->latencies.size())) - 1;
+      return this->latencies[std::min(idx, this->latencies.size() - 1)];
+    };
+    state.counters["p50_ms"] = percentile(0.50);
+    state.counters["p90_ms"] = percentile(0.90);
+    state.counters["p99_ms"] = percentile(0.99);
+    state.counters["max_ms"] = this->latencies.back();
+  }
+};
+
+/**
+ * @brief Simulate a spinning LiDAR scan of a synthetic street, which consists
+ * of the ground, two rows of facades and poles, with ``n_beams`` channels
+ * uniformly spread from -25 to 15 degrees.
+ *
+ */
+Eigen::MatrixX3d simulate_scan(int n_beams) {
+  const double sensor_height = 1.8;
+  const double facade_y      = 12.0;
+  const double max_range     = 100.0;
+
+  std::vector<Eigen::Vector2d> poles;
+  for (int i = -6; i <= 6; ++i) {
+    poles.emplace_back(i * 8.0 + 1.5, 6.0);
+    poles.emplace_back(i * 8.0 + 5.5, -6.0);
+  }
+  const double pole_radius = 0.15;
+
+  std::mt19937 generator(n_beams);
+  std::normal_distribution<double> noise(0.0, 0.01);
+
+  Eigen::MatrixX3d cloud(static_cast<Eigen::Index>(n_beams) * HFOV_RESOLUTION, 3);
+  Eigen::Index n_points = 0;
+  for (int beam = 0; beam < n_beams; ++beam) {
+    const double elevation = (-25.0 + 40.0 * beam / std::max(1, n_beams - 1)) * M_PI / 180;
+    for (int col = 0; col < HFOV_RESOLUTION; ++col) {
+      const double azimuth = (col + 0.5) * 2 * M_PI / HFOV_RESOLUTION - M_PI;
+      const Eigen::Vector3d direction(std::cos(elevation) * std::cos(azimuth),
+                                      std::cos(elevation) * std::sin(azimuth),
+                                      std::sin(elevation));
+
+      double range = max_range;
+      if (direction.z() < 0) range = std::min(range, sensor_height / -direction.z());
+      if (std::abs(direction.y()) > 1e-9) range = std::min(range, facade_y / std::abs(direction.y()));
+
+      // Ray-circle intersections of poles in the horizontal plane
+      const Eigen::Vector2d planar = direction.head<2>();
+      const double planar_norm2    = planar.squaredNorm();
+      for (const auto &pole : poles) {
+        const double b    = planar.dot(pole);
+        const double disc = b * b - planar_norm2 * (pole.squaredNorm() - pole_radius * pole_radius);
+        if (b > 0 && disc >= 0) range = std::min(range, (b - std::sqrt(disc)) / planar_norm2);
+      }
+
+      if (range >= max_range) continue;
+      cloud.row(n_points++) = (direction * (range + noise(generator))).transpose();
+    }
+  }
+
+  cloud.conservativeResize(n_points, 3);
+  return cloud;
+}
+
+/**
+ * @brief A pair of synthetic keypoint clouds, where the target is the source
+ * moved by a small motion (as in odometry) with noise.
+ *
+ */
+struct KeypointPair {
+  Eigen::MatrixX3d src;
+  Eigen::MatrixX3d dst;
+};
+
+KeypointPair make_keypoint_pair(size_t n_keypoints) {
+  std::mt19937 generator(static_cast<unsigned>(n_keypoints));
+  std::uniform_real_distribution<double> horizontal(-40.0, 40.0);
+  std::uniform_real_distribution<double> vertical(-2.0, 6.0);
+  std::uniform_real_distribution<double> noise(-NOISE_BOUND / 2, NOISE_BOUND / 2);
+
+  KeypointPair pair;
+  pair.src.resize(n_keypoints, 3);
+  for (size_t idx = 0; idx < n_keypoints; ++idx) {
+    pair.src.row(idx) << horizontal(generator), horizontal(generator), vertical(generator);
+  }
+
+  const Eigen::Matrix3d rotation = Eigen::AngleAxisd(2.0 * M_PI / 180, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+  const Eigen::RowVector3d translation(0.5, 0.1, 0.0);
+  pair.dst = (pair.src * rotation.transpose()).rowwise() + translation;
+  for (size_t idx = 0; idx < n_keypoints; ++idx) {
+    pair.dst.row(idx) += Eigen::RowVector3d(noise(generator), noise(generator), noise(generator));
+  }
+  return pair;
+}
+
+/**
+ * @brief Synthetic scans indexed by the number of beams, generated once.
+ *
+ */
+const Eigen::MatrixX3d &get_synthetic_scan(int n_beams) {
+  static std::map<int, Eigen::MatrixX3d> scans;
+  auto iter = scans.find(n_beams);
+  if (iter == scans.end()) iter = scans.emplace(n_beams, simulate_scan(n_beams)).first;
+  return iter->second;
+}
+
+/**
+ * @brief Synthetic keypoint pairs indexed by the number of keypoints,
+ * generated once.
+ *
+ */
+const KeypointPair &get_keypoint_pair(size_t n_keypoints) {
+  static std::map<size_t, KeypointPair> pairs;
+  auto iter = pairs.find(n_keypoints);
+  if (iter == pairs.end()) iter = pairs.emplace(n_keypoints, make_keypoint_pair(n_keypoints)).first;
+  return iter->second;
+}
+
+/**
+ * @brief The two bundled nuScenes scans (source and target), loaded once.
+ *
+ */
+const std::vector<Eigen::MatrixX3d> &get_nuscenes_scans() {
+  static const std::vector<Eigen::MatrixX3d> scans = {
+      load_pcd(std::string(KCP_BENCHMARK_DATA_DIR) + "/1531883530.949817000.pcd"),
+      load_pcd(std::string(KCP_BENCHMARK_DATA_DIR) + "/1531883530.449377000.pcd"),
+  };
+  return scans;
+}
+
+kcp::KCP::Params make_kcp_params(size_t k) {
+  kcp::KCP::Params params;
+  params.k                  = k;
+  params.verbose            = false;
+  params.teaser.noise_bound = NOISE_BOUND;
+  return params;
+}
+
+/* ------------------------------- RangeImage ------------------------------- */
+
+void run_range_image(benchmark::State &state, const Eigen::MatrixX3d &cloud, const kcp::SensorModel &sensor_model) {
+  // The range image is reused across scans as in a streaming pipeline
+  kcp::keypoint::RangeImage range_image(sensor_model, HFOV_RESOLUTION);
+  LatencyRecorder recorder;
+  for (auto _ : state) {
+    recorder.start();
+    range_image.reset(cloud);
+    benchmark::DoNotOptimize(range_image.get_image_sequence_size());
+    recorder.stop();
+  }
+
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations() * cloud.rows());
+  state.counters["n_points"] = cloud.rows();
+}
+
+void BM_RangeImage(benchmark::State &state) {
+  const int n_beams = static_cast<int>(state.range(0));
+  run_range_image(state, get_synthetic_scan(n_beams), kcp::SensorModel::uniform(n_beams, -25, 15));
+}
+BENCHMARK(BM_RangeImage)->ArgName("beams")->Arg(32)->Arg(64)->Arg(128)->Unit(benchmark::kMillisecond);
+
+void BM_RangeImage_NuScenes(benchmark::State &state) {
+  run_range_image(state, get_nuscenes_scans()[0], kcp::SensorModel::uniform(32, -30, 10));
+}
+BENCHMARK(BM_RangeImage_NuScenes)->Unit(benchmark::kMillisecond);
+
+/* --------------------------- MultiScaleCurvature -------------------------- */
+
+void run_multi_scale_curvature(benchmark::State &state,
+                               const Eigen::MatrixX3d &cloud,
+                               const kcp::SensorModel &sensor_model) {
+  const kcp::keypoint::RangeImage range_image(cloud, sensor_model, HFOV_RESOLUTION);
+  const kcp::keypoint::MultiScaleCurvature::Params params;
+
+  LatencyRecorder recorder;
+  size_t n_corner_points = 0;
+  for (auto _ : state) {
+    // Copying the range image is excluded from the measurement
+    state.PauseTiming();
+    kcp::keypoint::RangeImage copy = range_image;
+    state.ResumeTiming();
+
+    recorder.start();
+    kcp::keypoint::MultiScaleCurvature msc(std::move(copy), params);
+    n_corner_points = msc.get_corner_points().rows();
+    recorder.stop();
+  }
+
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations() * range_image.get_image_sequence_size());
+  state.counters["n_corner_points"] = n_corner_points;
+}
+
+void BM_MultiScaleCurvature(benchmark::State &state) {
+  const int n_beams = static_cast<int>(state.range(0));
+  run_multi_scale_curvature(state, get_synthetic_scan(n_beams), kcp::SensorModel::uniform(n_beams, -25, 15));
+}
+BENCHMARK(BM_MultiScaleCurvature)->ArgName("beams")->Arg(32)->Arg(64)->Arg(128)->Unit(benchmark::kMillisecond);
+
+void BM_MultiScaleCurvature_NuScenes(benchmark::State &state) {
+  run_multi_scale_curvature(state, get_nuscenes_scans()[0], kcp::SensorModel::uniform(32, -30, 10));
+}
+BENCHMARK(BM_MultiScaleCurvature_NuScenes)->Unit(benchmark::kMillisecond);
+
+/* ------------------------------ VoxelSampler ------------------------------ */
+
+void BM_VoxelSampler(benchmark::State &state) {
+  const KeypointPair &pair = get_keypoint_pair(state.range(0));
+  kcp::keypoint::VoxelSampler::Params params;
+  params.max_points = state.range(1);
+
+  kcp::keypoint::VoxelSampler sampler(params);
+  LatencyRecorder recorder;
+  for (auto _ : state) {
+    recorder.start();
+    sampler.sample(pair.src);
+    benchmark::DoNotOptimize(sampler.get_indices().data());
+    recorder.stop();
+  }
+
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations() * pair.src.rows());
+  state.counters["n_iterations"] = sampler.get_profile().n_iterations;
+}
+BENCHMARK(BM_VoxelSampler)
+    ->ArgNames({"keypoints", "max_points"})
+    ->ArgsProduct({{2000, 5000, 10000}, {500, 1000}})
+    ->Unit(benchmark::kMicrosecond);
+
+/* ------------------------- get_kcp_correspondences ------------------------ */
+
+void run_correspondences(benchmark::State &state, const Eigen::MatrixX3d &src, const Eigen::MatrixX3d &dst, size_t k) {
+  // The target kd-tree is built in each iteration as by the legacy solve
+  kcp::Correspondences correspondences;
+  LatencyRecorder recorder;
+  for (auto _ : state) {
+    recorder.start();
+    kcp::get_kcp_correspondences(src, dst, src, dst, k, correspondences);
+    benchmark::DoNotOptimize(correspondences.indices.first.data());
+    recorder.stop();
+  }
+
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations() * src.rows());
+  state.counters["n_correspondences"] = correspondences.indices.first.size();
+}
+
+void BM_Correspondences(benchmark::State &state) {
+  const KeypointPair &pair = get_keypoint_pair(state.range(0));
+  run_correspondences(state, pair.src, pair.dst, state.range(1));
+}
+BENCHMARK(BM_Correspondences)
+    ->ArgNames({"keypoints", "k"})
+    ->ArgsProduct({{1000, 2000, 5000, 10000}, {1, 2, 3, 4, 5}})
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_Correspondences_NuScenes(benchmark::State &state) {
+  const auto &scans = get_nuscenes_scans();
+  const Eigen::MatrixX3d src = kcp::keypoint::MultiScaleCurvature(scans[0]).get_corner_points();
+  const Eigen::MatrixX3d dst = kcp::keypoint::MultiScaleCurvature(scans[1]).get_corner_points();
+  run_correspondences(state, src, dst, state.range(0));
+}
+BENCHMARK(BM_Correspondences_NuScenes)->ArgName("k")->DenseRange(1, 5)->Unit(benchmark::kMicrosecond);
+
+/* ---------------------------- ConsistencyGraph ---------------------------- */
+
+void BM_ConsistencyGraph(benchmark::State &state) {
+  const KeypointPair &pair = get_keypoint_pair(state.range(0));
+  kcp::Correspondences correspondences;
+  kcp::get_kcp_correspondences(pair.src, pair.dst, pair.src, pair.dst, state.range(1), correspondences);
+
+  kcp::ConsistencyGraph graph;
+  LatencyRecorder recorder;
+  for (auto _ : state) {
+    recorder.start();
+    graph.build(correspondences, 2 * NOISE_BOUND);
+    benchmark::DoNotOptimize(graph.get_row(0));
+    recorder.stop();
+  }
+
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations() * correspondences.indices.first.size());
+  // Every pair is tested, so ``n_pairs`` grows quadratically with the
+  // number of correspondences
+  const double n_correspondences      = correspondences.indices.first.size();
+  state.counters["n_correspondences"] = n_correspondences;
+  state.counters["n_pairs"]           = n_correspondences * (n_correspondences - 1) / 2;
+  state.counters["n_edges"]           = graph.get_n_edges();
+}
+BENCHMARK(BM_ConsistencyGraph)
+    ->ArgNames({"keypoints", "k"})
+    ->ArgsProduct({{1000, 2000, 5000}, {1, 2, 5}})
+    ->Unit(benchmark::kMillisecond);
+
+/* -------------------------------- KCP::solve ------------------------------ */
+
+void run_solve(benchmark::State &state,
+               const Eigen::MatrixX3d &src,
+               const Eigen::MatrixX3d &dst,
+               size_t k,
+               kcp::KCP::MaxCliqueBackend backend = kcp::KCP::MaxCliqueBackend::TEASER) {
+  // The solver is reused, so the target kd-tree is cached after the first
+  // iteration as in odometry with a fixed target
+  auto params               = make_kcp_params(k);
+  params.max_clique_backend = backend;
+  kcp::KCP solver(params);
+  LatencyRecorder recorder;
+  for (auto _ : state) {
+    recorder.start();
+    solver.solve(src, dst, src, dst);
+    benchmark::DoNotOptimize(solver.get_solution().data());
+    recorder.stop();
+  }
+
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations() * src.rows());
+  state.counters["n_correspondences"] = solver.get_profile().n_correspondences;
+  state.counters["n_inliers"]         = solver.get_profile().n_inliers;
+  state.counters["clique_time"]       = solver.get_profile().clique_time;
+}
+
+void BM_Solve(benchmark::State &state) {
+  const KeypointPair &pair = get_keypoint_pair(state.range(0));
+  run_solve(state, pair.src, pair.dst, state.range(1));
+}
+// The maximum clique pruning grows quadratically with the number of
+// correspondences, so larger k is only covered by the smaller clouds
+BENCHMARK(BM_Solve)
+    ->ArgNames({"keypoints", "k"})
+    ->ArgsProduct({{1000, 2000, 5000, 10000}, {1, 2}})
+    ->ArgsProduct({{1000, 2000}, {3, 4, 5}})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_Solve_NuScenes(benchmark::State &state) {
+  const auto &scans = get_nuscenes_scans();
+  const Eigen::MatrixX3d src = kcp::keypoint::MultiScaleCurvature(scans[0]).get_corner_points();
+  const Eigen::MatrixX3d dst = kcp::keypoint::MultiScaleCurvature(scans[1]).get_corner_points();
+  run_solve(state, src, dst, state.range(0));
+}
+BENCHMARK(BM_Solve_NuScenes)->ArgName("k")->DenseRange(1, 5)->Unit(benchmark::kMillisecond);
+
+void BM_Solve_Builtin(benchmark::State &state) {
+  const KeypointPair &pair = get_keypoint_pair(state.range(0));
+  run_solve(state, pair.src, pair.dst, state.range(1), kcp::KCP::MaxCliqueBackend::BUILTIN);
+}
+BENCHMARK(BM_Solve_Builtin)
+    ->ArgNames({"keypoints", "k"})
+    ->ArgsProduct({{1000, 2000, 5000, 10000}, {1, 2}})
+    ->ArgsProduct({{1000, 2000}, {3, 4, 5}})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_Solve_Builtin_NuScenes(benchmark::State &state) {
+  const auto &scans = get_nuscenes_scans();
+  const Eigen::MatrixX3d src = kcp::keypoint::MultiScaleCurvature(scans[0]).get_corner_points();
+  const Eigen::MatrixX3d dst = kcp::keypoint::MultiScaleCurvature(scans[1]).get_corner_points();
+  run_solve(state, src, dst, state.range(0), kcp::KCP::MaxCliqueBackend::BUILTIN);
+}
+BENCHMARK(BM_Solve_Builtin_NuScenes)->ArgName("k")->DenseRange(1, 5)->Unit(benchmark::kMillisecond);
+
+};  // namespace
+
+BENCHMARK_MAIN();
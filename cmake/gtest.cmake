@@ -1,18 +1,29 @@
-include(FetchContent)
+find_package(GTest QUIET)
 
-FetchContent_Declare(
-  googletest
-  GIT_REPOSITORY https://github.com/google/googletest.git
-  GIT_TAG        release-1.10.0
-)
+if(GTEST_FOUND OR GTest_FOUND)
+  # CMake < 3.20 only provides GTest::GTest and GTest::Main
+  if(NOT TARGET GTest::gtest_main)
+    add_library(GTest::gtest_main INTERFACE IMPORTED)
+    set_target_properties(GTest::gtest_main PROPERTIES INTERFACE_LINK_LIBRARIES "GTest::GTest;GTest::Main")
+  endif()
+else()
+  include(FetchContent)
 
-if (WIN32)
-  # For Windows: Prevent overriding the parent project's compiler/linker settings
-  set(gtest_force_shared_crt ON CACHE BOOL "" FORCE)
-endif()
+  FetchContent_Declare(
+    googletest
+    GIT_REPOSITORY https://github.com/google/googletest.git
+    GIT_TAG        release-1.10.0
+  )
+
+  if (WIN32)
+    # For Windows: Prevent overriding the parent project's compiler/linker settings
+    set(gtest_force_shared_crt ON CACHE BOOL "" FORCE)
+  endif()
 
-FetchContent_GetProperties(googletest)
-if(NOT googletest_POPULATED)
-  FetchContent_Populate(googletest)
-  add_subdirectory(${googletest_SOURCE_DIR} ${googletest_BINARY_DIR} EXCLUDE_FROM_ALL)
-endif()
\ No newline at end of file
+  FetchContent_GetProperties(googletest)
+  if(NOT googletest_POPULATED)
+    FetchContent_Populate(googletest)
+    add_subdirectory(${googletest_SOURCE_DIR} ${googletest_BINARY_DIR} EXCLUDE_FROM_ALL)
+  endif()
+  add_library(GTest::gtest_main ALIAS gtest_main)
+endif()
@@ -8,54 +8,51 @@
 #include <pcl/io/pcd_io.h>
 
 #include <iostream>
-
-/**
- * @brief Convert ``pcl::PointCloud`` to ``Eigen::MatrixX3d``.
- * 
- * @param cloud The point cloud of type ``pcl::PointCloud``
- * @param matrix The point cloud of type ``Eigen::MatrixX3d``.
- */
-void convert_pcl_point_cloud_to_eigen_matrix(pcl::PointCloud<pcl::PointXYZI>& cloud,
-                                             Eigen::MatrixX3d& matrix) {
-  matrix.setZero(cloud.size(), 3);
-  for (int idx = 0; idx < cloud.size(); ++idx) {
-    const auto& point = cloud[idx];
-    matrix(idx, 0)    = point.x;
-    matrix(idx, 1)    = point.y;
-    matrix(idx, 2)    = point.z;
-  }
-}
+#include <limits>
 
 /**
  * @brief Point cloud preprocessing for the nuScenes data.
  *
  * @details This preprocessing removes ground points (using a very simple
- * condition that z-axis <= -1.5m) and points coming from the inspector.
+ * condition that z-axis < -1.5m) and points coming from the inspector. The
+ * filter is applied by the range image while projecting points, so no filtered
+ * point cloud is materialized.
  *
- * @param cloud The point cloud.
+ * @return kcp::keypoint::RangeImageF::Filter
  */
-void preprocessing(pcl::PointCloud<pcl::PointXYZI>* cloud) {
-  pcl::PointCloud<pcl::PointXYZI> filtered_cloud;
+kcp::keypoint::RangeImageF::Filter preprocessing() {
+  kcp::keypoint::RangeImageF::Filter filter;
 
-  for (const auto& point : *cloud) {
-    // remove points comes from the inspector
-    bool&& cond_x = point.x > 0.62 || point.x < -0.62;
-    bool&& cond_y = point.y > 1.87 || point.y < -1.10;
-    if (!cond_x && !cond_y) continue;
+  // remove points comes from the inspector
+  const double inf = std::numeric_limits<double>::infinity();
+  filter.crop_boxes.emplace_back(Eigen::Vector3d(-0.62, -1.10, -inf), Eigen::Vector3d(0.62, 1.87, inf));
 
-    // remove ground points
-    bool&& cond_z = point.z > -1.5;
-    if (!cond_z) continue;
+  // remove ground points
+  filter.min_z = -1.5;
 
-    filtered_cloud.push_back(point);
-  }
+  return filter;
+}
 
-  *cloud = filtered_cloud;
+/**
+ * @brief Extract corner points of a ``pcl::PointCloud``, whose x, y and z
+ * fields are read in place.
+ *
+ * @param cloud The point cloud of type ``pcl::PointCloud``.
+ * @param filter The filter of points.
+ * @return Eigen::MatrixX3f
+ */
+Eigen::MatrixX3f get_corner_points(const pcl::PointCloud<pcl::PointXYZI>& cloud,
+                                   const kcp::keypoint::RangeImageF::Filter& filter) {
+  kcp::keypoint::RangeImageF range_image;
+  range_image.set_filter(filter);
+  range_image.reset(kcp::keypoint::RangeImageF::interleaved_view(
+      &cloud.points[0].x, cloud.size(), sizeof(pcl::PointXYZI) / sizeof(float)));
+  return kcp::keypoint::MultiScaleCurvatureF(range_image).get_corner_points();
 }
 
 int main() {
   /**
-   * 1. Load point clouds and convert their types to Eigen::MatrixX3d.
+   * 1. Load point clouds.
    */
   std::string source_point_cloud_filename = "data/1531883530.949817000.pcd";
   std::string target_point_cloud_filename = "data/1531883530.449377000.pcd";
@@ -66,20 +63,14 @@ int main() {
   pcl::io::loadPCDFile(source_point_cloud_filename, source_pcl_cloud);
   pcl::io::loadPCDFile(target_point_cloud_filename, target_pcl_cloud);
 
-  preprocessing(&source_pcl_cloud);
-  preprocessing(&target_pcl_cloud);
-
-  Eigen::MatrixX3d source;
-  Eigen::MatrixX3d target;
-
-  convert_pcl_point_cloud_to_eigen_matrix(source_pcl_cloud, source);
-  convert_pcl_point_cloud_to_eigen_matrix(target_pcl_cloud, target);
-
   /**
-   * 2. Extract corner points with multi-scale curvature.
+   * 2. Extract corner points with multi-scale curvature, where points are
+   * preprocessed during the projection.
    */
-  Eigen::MatrixX3d source_corner_points = kcp::keypoint::MultiScaleCurvature(source).get_corner_points();
-  Eigen::MatrixX3d target_corner_points = kcp::keypoint::MultiScaleCurvature(target).get_corner_points();
+  auto filter = preprocessing();
+
+  Eigen::MatrixX3f source_corner_points = get_corner_points(source_pcl_cloud, filter);
+  Eigen::MatrixX3f target_corner_points = get_corner_points(target_pcl_cloud, filter);
 
   /**
    * 3. Estimate the transformation of two clouds with KCP-TEASER.
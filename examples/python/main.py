@@ -73,9 +73,9 @@ def visualize(
         np.array([[0.2, 0.2, 1.0] for _ in range(target.shape[0])], dtype=float)
     )
 
-    size = initial_correspondences.points[0].shape[1]
-    points = list(initial_correspondences.points[0].T)
-    points += list(initial_correspondences.points[1].T)
+    size = initial_correspondences.src_points.shape[1]
+    points = list(initial_correspondences.src_points.T)
+    points += list(initial_correspondences.dst_points.T)
     lines = [[i, i + size] for i in range(size)]
     initial_correspondences_o3d = o3d.geometry.LineSet()
     initial_correspondences_o3d.points = o3d.utility.Vector3dVector(np.array(points))
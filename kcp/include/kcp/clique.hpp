@@ -0,0 +1,179 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "kcp/common.hpp"
+#include "kcp/parallel.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace kcp {
+
+/**
+ * @brief The pairwise consistency graph of correspondences, stored as a bitset
+ * adjacency matrix.
+ *
+ * @details Two correspondences ``i`` and ``j`` are consistent (adjacent) if
+ * they preserve the distance between their points within ``bound``, i.e.,
+ * ``| |s_i - s_j| - |d_i - d_j| | <= bound``, which is the test of TEASER++
+ * with ``bound = 2 * noise_bound * sqrt(cbar2)``.
+ *
+ * Unlike TEASER++, correspondences sharing a source point are never adjacent,
+ * since at most one of the k closest points of a source point is the true
+ * match. Correspondences of a source point may come in any order.
+ *
+ */
+class ConsistencyGraph {
+ protected:
+  /**
+   * @brief The number of vertices (correspondences).
+   *
+   */
+  size_t n_vertices;
+
+  /**
+   * @brief The number of 64-bit words of a row of the adjacency matrix.
+   *
+   */
+  size_t n_words;
+
+  /**
+   * @brief The adjacency matrix, where bit ``j % 64`` of word
+   * ``i * n_words + j / 64`` tells whether vertices ``i`` and ``j`` are
+   * adjacent.
+   *
+   */
+  std::vector<uint64_t> adjacency;
+
+  /**
+   * @brief The source point index of each vertex.
+   *
+   */
+  std::vector<int> groups;
+
+  /**
+   * @brief Buffer of coordinates of source and target points stored axis by
+   * axis, padded to whole words.
+   *
+   */
+  std::vector<double> coordinates;
+
+  /**
+   * @brief Buffer of vertices sorted by their source points.
+   *
+   */
+  std::vector<int> group_order;
+
+ public:
+  /**
+   * @brief Construct an empty ConsistencyGraph object.
+   *
+   */
+  ConsistencyGraph() : n_vertices(0), n_words(0) {}
+
+  /**
+   * @brief Build the graph of correspondences, replacing the previous one.
+   * Rows of the adjacency matrix are built in parallel.
+   *
+   * @details Only the upper triangle is tested, and the lower one is its
+   * transpose. Most pairs are settled by bounds on squared distances, and
+   * distances are only computed for pairs close to ``bound``, so the result
+   * equals the exact test.
+   *
+   * @param correspondences The correspondences, where ``indices.first`` tells
+   * the source point of each correspondence. If it is empty, all
+   * correspondences are treated as distinct source points.
+   * @param bound The maximum difference of distances of consistent
+   * correspondences.
+   * @param executor The executor, or ``nullptr`` for running in the calling
+   * thread.
+   * @param exclude_same_source Whether correspondences of the same source
+   * point are never adjacent. Otherwise, all correspondences are treated as
+   * distinct source points, and the graph equals the one of TEASER++.
+   */
+  void build(const Correspondences &correspondences,
+             double bound,
+             Executor *executor       = nullptr,
+             bool exclude_same_source = true);
+
+  /**
+   * @brief Get the number of vertices.
+   *
+   * @return size_t
+   */
+  size_t get_n_vertices() const { return this->n_vertices; }
+
+  /**
+   * @brief Get the number of 64-bit words of a row of the adjacency matrix.
+   *
+   * @return size_t
+   */
+  size_t get_n_words() const { return this->n_words; }
+
+  /**
+   * @brief Get the row of the adjacency matrix of a vertex.
+   *
+   * @param vertex The vertex.
+   * @return const uint64_t* The ``get_n_words()`` words of the row.
+   */
+  const uint64_t *get_row(size_t vertex) const { return this->adjacency.data() + vertex * this->n_words; }
+
+  /**
+   * @brief Whether two vertices are adjacent.
+   *
+   * @param i A vertex.
+   * @param j Another vertex.
+   * @return bool
+   */
+  bool is_adjacent(size_t i, size_t j) const { return (this->get_row(i)[j / 64] >> (j % 64)) & 1; }
+
+  /**
+   * @brief Get the source point index of each vertex.
+   *
+   * @return const std::vector<int>&
+   */
+  const std::vector<int> &get_groups() const { return this->groups; }
+
+  /**
+   * @brief Get the number of edges.
+   *
+   * @return size_t
+   */
+  size_t get_n_edges() const;
+};
+
+/**
+ * @brief Find a maximum clique of a consistency graph.
+ *
+ * @details Vertices are ordered by the core decomposition, and the maximum
+ * clique is searched by branch and bound over the later neighbors of each
+ * vertex, with bitset candidate sets bounded by a greedy coloring and by the
+ * number of distinct source points (as a clique takes at most one
+ * correspondence of each source point). A greedy clique found from every
+ * vertex gives the initial lower bound. Branches are distributed over the
+ * executor.
+ *
+ * Among maximum cliques, the one of the earliest branch (and the earliest in
+ * the search order of the branch) is returned, so the result does not depend
+ * on the number of threads, unless the time limit is reached.
+ *
+ * @param graph The consistency graph.
+ * @param exact Whether to search the maximum clique exactly. Otherwise, the
+ * largest greedy clique is returned.
+ * @param executor The executor, or ``nullptr`` for running in the calling
+ * thread.
+ * @param time_limit The time limit of the exact search in seconds, as
+ * ``max_clique_time_limit`` of TEASER++. Once it is reached, the largest
+ * clique found so far (at least the greedy one) is returned.
+ * @return std::vector<int> Vertices of the clique in ascending order.
+ */
+std::vector<int> find_max_clique(const ConsistencyGraph &graph,
+                                 bool exact         = true,
+                                 Executor *executor = nullptr,
+                                 double time_limit  = std::numeric_limits<double>::infinity());
+
+};  // namespace kcp
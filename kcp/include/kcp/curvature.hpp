@@ -0,0 +1,75 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "kcp/common.hpp"
+
+namespace kcp {
+
+namespace keypoint {
+
+/**
+ * @brief Implementations of the multi-scale curvature stencil.
+ *
+ * @details All kernels evaluate the 11-tap stencil on a depth row padded with
+ * CURVATURE_HALO elements on both sides, using reciprocal weights and the same
+ * order of summation. Compared with the division-based formula, results differ
+ * by a few ULPs of the intermediate sums due to the rounding of ``1/3`` and
+ * ``1/5`` (and the possible contraction into FMA instructions in vectorized
+ * kernels), i.e., about ``2e-6`` relative to the depths of the channel.
+ *
+ */
+enum class CurvatureKernel {
+  AUTO,    ///< The fastest kernel supported by the running CPU.
+  SCALAR,  ///< Portable kernel.
+  AVX2,    ///< 8-wide kernel for x86 CPUs with AVX2.
+  AVX512   ///< 16-wide kernel for x86 CPUs with AVX-512F.
+};
+
+/**
+ * @brief The number of halo elements on each side of a padded depth row.
+ * 
+ */
+constexpr int CURVATURE_HALO = 5;
+
+/**
+ * @brief Resolve the kernel to be used on the running CPU. ``AUTO`` is
+ * resolved to the fastest supported kernel, and unsupported kernels fall back
+ * to ``SCALAR``.
+ *
+ * @param kernel The requested kernel.
+ * @return CurvatureKernel
+ */
+CurvatureKernel resolve_curvature_kernel(CurvatureKernel kernel = CurvatureKernel::AUTO);
+
+/**
+ * @brief Pad a depth row of a channel with cyclic halo elements.
+ *
+ * @details The wrap follows the ``CYCLIC_INDEX`` convention of the range
+ * image, where the first and the last points of a channel are treated as the
+ * same point, i.e., the left halo is ``depth[size - 1 - m]`` and the right
+ * halo is ``depth[m]`` for ``m = 1, ..., CURVATURE_HALO``.
+ *
+ * @param depth The depth row of the channel.
+ * @param size The number of points of the channel (greater than
+ * CURVATURE_HALO).
+ * @param padded The output buffer of ``size + 2 * CURVATURE_HALO`` elements.
+ */
+void pad_cyclic_depth(const float *depth, int size, float *padded);
+
+/**
+ * @brief Compute the absolute multi-scale curvature of a padded depth row.
+ *
+ * @param padded The padded depth row created by pad_cyclic_depth().
+ * @param size The number of points of the channel.
+ * @param curvature The output buffer of ``size`` elements.
+ * @param kernel The kernel to be used. It must be resolved by
+ * resolve_curvature_kernel().
+ */
+void calculate_curvature(const float *padded, int size, float *curvature, CurvatureKernel kernel);
+
+};  // namespace keypoint
+
+};  // namespace kcp
@@ -5,6 +5,15 @@
 #pragma once
 
 #include "kcp/common.hpp"
+#include "kcp/curvature.hpp"
+#include "kcp/parallel.hpp"
+#include "kcp/profiling.hpp"
+#include "kcp/sensor.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
 
 namespace kcp {
 
@@ -14,42 +23,295 @@ namespace kcp {
  */
 namespace keypoint {
 
+/**
+ * @brief Types shared by range images of all scalar types.
+ *
+ */
+class RangeImageBase {
+ public:
+  /**
+   * @brief Type of the timing (in seconds) and counters of the latest
+   * projection. The timing is zero unless KCP is built with
+   * ``KCP_ENABLE_PROFILING``.
+   *
+   */
+  struct Profile {
+    /**
+     * @brief The number of input points.
+     *
+     */
+    size_t n_points;
+
+    /**
+     * @brief The number of points rejected by the filter.
+     *
+     */
+    size_t n_filtered_points;
+
+    /**
+     * @brief The number of points kept by the range image.
+     *
+     */
+    size_t n_projected_points;
+
+    /**
+     * @brief The time of the projection, including gathering sequences.
+     *
+     */
+    double projection_time;
+
+    /**
+     * @brief Construct a new RangeImage::Profile object.
+     *
+     */
+    Profile() : n_points(0), n_filtered_points(0), n_projected_points(0), projection_time(0) {}
+  };
+
+  /**
+   * @brief Type of the layout of a sweep for correcting the motion distortion
+   * (deskewing), where the capture time of a point is derived from its column
+   * as the sensor spins at a constant rate.
+   *
+   */
+  struct Deskew {
+    /**
+     * @brief The column where the sweep starts. Default by 0.
+     *
+     */
+    int start_column;
+
+    /**
+     * @brief Whether the sweep visits columns in descending order, e.g., a
+     * clockwise spinning LiDAR with columns of the spherical projection, whose
+     * columns ascend counterclockwise. Default by false.
+     *
+     */
+    bool descending;
+
+    /**
+     * @brief Construct a new RangeImage::Deskew object.
+     *
+     */
+    Deskew() {
+      start_column = 0;
+      descending   = false;
+    }
+  };
+
+  /**
+   * @brief Type of an axis-aligned box of the sensor frame.
+   *
+   */
+  struct CropBox {
+    /**
+     * @brief The minimum corner of the box.
+     *
+     */
+    Eigen::Vector3d min_point;
+
+    /**
+     * @brief The maximum corner of the box.
+     *
+     */
+    Eigen::Vector3d max_point;
+
+    /**
+     * @brief Construct a new RangeImage::CropBox object.
+     *
+     * @param min_point The minimum corner of the box.
+     * @param max_point The maximum corner of the box.
+     */
+    CropBox(const Eigen::Vector3d &min_point, const Eigen::Vector3d &max_point)
+        : min_point(min_point),
+          max_point(max_point) {}
+  };
+
+  /**
+   * @brief Type of the filter of points applied by the projection, where
+   * rejected points are left out of the range image (and its sequences).
+   * Points are tested in the sensor frame as measured, i.e., before deskewing.
+   * The default filter keeps all points.
+   *
+   */
+  struct Filter {
+    /**
+     * @brief Points inside any of the boxes are rejected, e.g., returns from
+     * the ego vehicle. Default by none.
+     *
+     */
+    std::vector<CropBox> crop_boxes;
+
+    /**
+     * @brief Points closer than the range are rejected. Default by 0.
+     *
+     */
+    double min_range;
+
+    /**
+     * @brief Points farther than the range are rejected. Default by infinity.
+     *
+     */
+    double max_range;
+
+    /**
+     * @brief Points whose z coordinates are less than the value are rejected.
+     * Default by -infinity.
+     *
+     */
+    double min_z;
+
+    /**
+     * @brief Points whose z coordinates are greater than the value are
+     * rejected. Default by infinity.
+     *
+     */
+    double max_z;
+
+    /**
+     * @brief The number of channels where ground points are removed, i.e.,
+     * channels ``0`` to ``n_ground_channels - 1``. Default by 0.
+     *
+     * @details These are the lowest channels (which reach the ground near the
+     * sensor) only if channel indices ascend with elevation. It holds for the
+     * spherical projection, whose channels follow the SensorModel. For given
+     * rings and organized point clouds, the caller has to ensure it, e.g.,
+     * the ring 0 of Ouster sensors is the highest beam, so pass
+     * ``n_channels - 1 - ring`` (or flip the rows) instead.
+     *
+     */
+    int n_ground_channels;
+
+    /**
+     * @brief Points of the first ``n_ground_channels`` channels whose z
+     * coordinates are at most the value are rejected as ground points, e.g.,
+     * slightly above the ground in the sensor frame. Default by 0.
+     *
+     */
+    double ground_z;
+
+    /**
+     * @brief Construct a new RangeImage::Filter object.
+     *
+     */
+    Filter() {
+      min_range         = 0;
+      max_range         = std::numeric_limits<double>::infinity();
+      min_z             = -std::numeric_limits<double>::infinity();
+      max_z             = std::numeric_limits<double>::infinity();
+      n_ground_channels = 0;
+      ground_z          = 0;
+    }
+
+    /**
+     * @brief Whether a point is rejected.
+     *
+     * @param channel The channel of the point.
+     * @param x The x coordinate.
+     * @param y The y coordinate.
+     * @param z The z coordinate.
+     * @param depth The depth of the point.
+     * @return bool
+     */
+    bool rejects(int channel, double x, double y, double z, double depth) const {
+      if (depth < this->min_range || depth > this->max_range || z < this->min_z || z > this->max_z) return true;
+      if (channel < this->n_ground_channels && z <= this->ground_z) return true;
+      for (const CropBox &box : this->crop_boxes) {
+        if (x >= box.min_point.x() && x <= box.max_point.x() && y >= box.min_point.y() && y <= box.max_point.y() &&
+            z >= box.min_point.z() && z <= box.max_point.z()) {
+          return true;
+        }
+      }
+      return false;
+    }
+  };
+};
+
 /**
  * @brief A range image of a point cloud based on the spherical projection.
- * 
+ *
+ * @tparam Scalar The scalar type of the point cloud, i.e., ``double`` or
+ * ``float``. Depths are always computed in single precision.
  */
-class RangeImage {
+template <typename Scalar>
+class BasicRangeImage : public RangeImageBase {
+ public:
+  /**
+   * @brief Type of the point cloud.
+   *
+   */
+  using CloudMatrix = Eigen::Matrix<Scalar, Eigen::Dynamic, 3>;
+
+  /**
+   * @brief Type of the read-only view of a point cloud with arbitrary strides,
+   * where the coordinate ``j`` of the point ``i`` is stored at ``data[i *
+   * inner + j * outer]``. It views column-major matrices (``inner = 1``) as
+   * well as interleaved buffers (``outer = 1``), e.g., row-major matrices,
+   * NumPy arrays in C order, and x, y, z fields of ``sensor_msgs/PointCloud2``.
+   *
+   */
+  using CloudView = Eigen::Map<const CloudMatrix, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+
+  /**
+   * @brief Create a view of interleaved points, whose x, y and z coordinates
+   * are contiguous.
+   *
+   * @param data Pointer to the x coordinate of the first point.
+   * @param n_points The number of points.
+   * @param point_stride The distance between two points in scalars, e.g., 3
+   * for packed points, and 4 (or 8) for float points with a 16-byte (or
+   * 32-byte) point step.
+   * @return CloudView
+   */
+  static CloudView interleaved_view(const Scalar *data, Eigen::Index n_points, Eigen::Index point_stride = 3) {
+    return CloudView(data, n_points, 3, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(1, point_stride));
+  }
+
  protected:
   /**
-   * @brief The point cloud.
+   * @brief The owned point cloud, which is in use only if ``cloud_data``
+   * points to it. It is kept (rather than freed) while the range image views a
+   * point cloud owned by the caller.
+   *
+   */
+  CloudMatrix cloud_storage;
+
+  /**
+   * @brief Pointer to the first coefficient of the point cloud.
    * 
    */
-  Eigen::MatrixX3d cloud;
+  const Scalar *cloud_data;
 
   /**
-   * @brief Channel indices of raw points.
+   * @brief The number of points of the point cloud.
    * 
    */
-  std::vector<int> channel;
+  Eigen::Index cloud_rows;
 
   /**
-   * @brief The number of channels (height of the range image). It is usually
-   * set to be the number of LiDAR beams.
+   * @brief The outer stride (distance between two coordinates of a point) of
+   * the point cloud.
    *
    */
-  int n_channels;
+  Eigen::Index cloud_outer_stride;
 
   /**
-   * @brief The minimum vertical field of view (V-FOV) of the given point cloud.
-   * 
+   * @brief The inner stride (distance between two points) of the point cloud.
+   *
    */
-  float min_vfov_deg;
+  Eigen::Index cloud_inner_stride;
 
   /**
-   * @brief The maximum vertical field of view (V-FOV) of the given point cloud.
+   * @brief The beam layout used to compute the channel index of each point.
    * 
    */
-  float max_vfov_deg;
+  SensorModel sensor_model;
+
+  /**
+   * @brief The number of channels (height of the range image). It is usually
+   * set to be the number of LiDAR beams.
+   *
+   */
+  int n_channels;
 
   /**
    * @brief The resolution of 360-degree horizontal field of view.
@@ -63,6 +325,13 @@ class RangeImage {
    */
   Eigen::MatrixXi image_indices;
 
+  /**
+   * @brief The range image whose entry indicates the depth of the point stored
+   * in ``image_indices``.
+   *
+   */
+  Eigen::MatrixXf image_depths;
+
   /**
    * @brief The depths of points ordered by channels.
    * 
@@ -94,18 +363,149 @@ class RangeImage {
   std::vector<int> channel_end_indices;
 
   /**
-   * @brief Compute the polar index of each point.
-   * 
+   * @brief The timing and counters of the latest projection.
+   *
    */
-  void calculate_point_cloud_properties();
+  Profile profile;
+
+  /**
+   * @brief The motion of the sensor over a sweep, which is the identity if
+   * deskewing is disabled.
+   *
+   */
+  Eigen::Matrix4d deskew_motion;
+
+  /**
+   * @brief The layout of the sweep for deskewing.
+   *
+   */
+  Deskew deskew;
+
+  /**
+   * @brief The transformation of each column from the sensor frame at its
+   * capture time to the one at the start of the sweep, stored as row-major
+   * 3x4 matrices.
+   *
+   */
+  std::vector<Scalar> deskew_transforms;
+
+  /**
+   * @brief The deskewed point cloud (column-major) of a point cloud not owned
+   * by the range image, whose capacity is kept across projections.
+   *
+   */
+  std::vector<Scalar> deskewed_storage;
+
+  /**
+   * @brief The filter of points applied by the projection.
+   *
+   */
+  Filter filter;
+
+  /**
+   * @brief Whether the filter may reject any point, so that the default
+   * filter costs nothing.
+   *
+   */
+  bool filtering;
+
+  /**
+   * @brief Point the range image to the given point cloud buffer.
+   *
+   * @param data Pointer to the first coefficient of the point cloud.
+   * @param rows The number of points.
+   * @param outer_stride The distance between two coordinates of a point.
+   * @param inner_stride The distance between two points.
+   */
+  void bind_cloud(const Scalar *data, Eigen::Index rows, Eigen::Index outer_stride, Eigen::Index inner_stride);
 
   /**
    * @brief Compute the corresponding range image of the given point cloud.
-   * 
+   *
+   * @details The spherical projection and the depth of each point are computed
+   * in a single pass over the point cloud, and the sequences are then gathered
+   * from the image row by row. All buffers keep their capacity across calls.
+   *
    */
   void calculate_range_image();
 
+  /**
+   * @brief Compute the range image of the given point cloud whose pixel
+   * coordinates are provided by the LiDAR driver. No spherical projection is
+   * performed, and the sensor model is not used.
+   *
+   * @param rings The channel (row) index of each point.
+   * @param columns The column index of each point.
+   */
+  void calculate_range_image(const int *rings, const int *columns);
+
+  /**
+   * @brief Compute the range image of the given organized point cloud, whose
+   * point at row ``r`` and column ``c`` is stored at ``r * hfov_resolution +
+   * c``. The sequences are emitted in the storage order within a single pass.
+   *
+   */
+  void calculate_organized_range_image();
+
+  /**
+   * @brief Gather the sequences and the channel ranges from the range image.
+   * 
+   */
+  void gather_sequences();
+
+  /**
+   * @brief Whether the range image owns its point cloud.
+   *
+   * @return bool
+   */
+  bool owns_cloud() const { return this->cloud_storage.size() > 0 && this->cloud_data == this->cloud_storage.data(); }
+
+  /**
+   * @brief Prepare the owned point cloud receiving deskewed points, which is
+   * the given point cloud itself if the range image owns it.
+   *
+   * @return Scalar* Pointer to the owned point cloud (column-major), or
+   * ``nullptr`` if deskewing is disabled.
+   */
+  Scalar *prepare_deskewed_cloud();
+
+  /**
+   * @brief Deskew a point captured at a column in place.
+   *
+   * @param column The column of the point.
+   * @param x The x coordinate.
+   * @param y The y coordinate.
+   * @param z The z coordinate.
+   */
+  void deskew_point(int column, Scalar &x, Scalar &y, Scalar &z) const {
+    const Scalar *transform = this->deskew_transforms.data() + 12 * column;
+    const Scalar deskewed_x = transform[0] * x + transform[1] * y + transform[2] * z + transform[3];
+    const Scalar deskewed_y = transform[4] * x + transform[5] * y + transform[6] * z + transform[7];
+    const Scalar deskewed_z = transform[8] * x + transform[9] * y + transform[10] * z + transform[11];
+    x                       = deskewed_x;
+    y                       = deskewed_y;
+    z                       = deskewed_z;
+  }
+
  public:
+  /**
+   * @brief Construct an empty RangeImage object. Use reset() to feed point
+   * clouds into it.
+   *
+   * @param n_channels The number of channels (height of the range image). It is
+   * usually set to be the number of LiDAR beams.
+   * @param min_vfov_deg The minimum vertical field of view (V-FOV) of the given
+   * point cloud.
+   * @param max_vfov_deg The maximum vertical field of view (V-FOV) of the given
+   * point cloud.
+   * @param hfov_resolution The resolution of 360-degree horizontal field of
+   * view.
+   */
+  BasicRangeImage(int n_channels      = 32,
+                  float min_vfov_deg  = -30.0,
+                  float max_vfov_deg  = 10.0,
+                  int hfov_resolution = 1800);
+
   /**
    * @brief Construct a new RangeImage object.
    *
@@ -119,18 +519,342 @@ class RangeImage {
    * @param hfov_resolution The resolution of 360-degree horizontal field of
    * view.
    */
-  RangeImage(Eigen::MatrixX3d cloud,
-             int n_channels      = 32,
-             float min_vfov_deg  = -30.0,
-             float max_vfov_deg  = 10.0,
-             int hfov_resolution = 1800);
+  BasicRangeImage(CloudMatrix cloud,
+                  int n_channels      = 32,
+                  float min_vfov_deg  = -30.0,
+                  float max_vfov_deg  = 10.0,
+                  int hfov_resolution = 1800);
+
+  /**
+   * @brief Construct an empty RangeImage object with a sensor model. Use
+   * reset() to feed point clouds into it.
+   *
+   * @param sensor_model The beam layout of the LiDAR, which determines the
+   * number of channels.
+   * @param hfov_resolution The resolution of 360-degree horizontal field of
+   * view.
+   */
+  BasicRangeImage(const SensorModel &sensor_model, int hfov_resolution = 1800);
+
+  /**
+   * @brief Construct a new RangeImage object with a sensor model.
+   *
+   * @param cloud The point cloud.
+   * @param sensor_model The beam layout of the LiDAR, which determines the
+   * number of channels.
+   * @param hfov_resolution The resolution of 360-degree horizontal field of
+   * view.
+   */
+  BasicRangeImage(CloudMatrix cloud, const SensorModel &sensor_model, int hfov_resolution = 1800);
+
+  /**
+   * @brief Construct a new RangeImage object viewing a point cloud owned by
+   * the caller, which is not copied.
+   *
+   * @warning The caller has to keep the point cloud alive (and unchanged) as
+   * long as the range image, or any MultiScaleCurvature built from it, is in
+   * use.
+   *
+   * @param cloud The view of the point cloud.
+   * @param n_channels The number of channels (height of the range image). It is
+   * usually set to be the number of LiDAR beams.
+   * @param min_vfov_deg The minimum vertical field of view (V-FOV) of the given
+   * point cloud.
+   * @param max_vfov_deg The maximum vertical field of view (V-FOV) of the given
+   * point cloud.
+   * @param hfov_resolution The resolution of 360-degree horizontal field of
+   * view.
+   */
+  BasicRangeImage(const CloudView &cloud,
+                  int n_channels      = 32,
+                  float min_vfov_deg  = -30.0,
+                  float max_vfov_deg  = 10.0,
+                  int hfov_resolution = 1800);
+
+  /**
+   * @brief Construct a new RangeImage object with a sensor model viewing a
+   * point cloud owned by the caller, which is not copied.
+   *
+   * @see BasicRangeImage(const CloudView &, int, float, float, int)
+   *
+   * @param cloud The view of the point cloud.
+   * @param sensor_model The beam layout of the LiDAR, which determines the
+   * number of channels.
+   * @param hfov_resolution The resolution of 360-degree horizontal field of
+   * view.
+   */
+  BasicRangeImage(const CloudView &cloud, const SensorModel &sensor_model, int hfov_resolution = 1800);
+
+  /**
+   * @brief Construct a new RangeImage object with the pixel coordinates of
+   * points provided by the LiDAR driver (e.g., ring and column fields), which
+   * skips the spherical projection entirely. Points with out-of-range pixel
+   * coordinates or invalid depths are ignored.
+   *
+   * @param cloud The point cloud.
+   * @param rings The channel (row) index of each point.
+   * @param columns The column index of each point.
+   * @param n_channels The number of channels (height of the range image).
+   * @param hfov_resolution The number of columns (width of the range image).
+   */
+  BasicRangeImage(CloudMatrix cloud,
+                  const Eigen::Ref<const Eigen::VectorXi> &rings,
+                  const Eigen::Ref<const Eigen::VectorXi> &columns,
+                  int n_channels,
+                  int hfov_resolution);
+
+  /**
+   * @brief Construct a new RangeImage object with the pixel coordinates of
+   * points, viewing a point cloud owned by the caller, which is not copied.
+   *
+   * @see BasicRangeImage(const CloudView &, int, float, float, int)
+   *
+   * @param cloud The view of the point cloud.
+   * @param rings The channel (row) index of each point.
+   * @param columns The column index of each point.
+   * @param n_channels The number of channels (height of the range image).
+   * @param hfov_resolution The number of columns (width of the range image).
+   */
+  BasicRangeImage(const CloudView &cloud,
+                  const Eigen::Ref<const Eigen::VectorXi> &rings,
+                  const Eigen::Ref<const Eigen::VectorXi> &columns,
+                  int n_channels,
+                  int hfov_resolution);
+
+  /**
+   * @brief Create a RangeImage object from an organized point cloud of size
+   * ``height * width``, whose point at row ``r`` and column ``c`` is stored at
+   * ``r * width + c``. Points with invalid depths (NaN or zero) are ignored.
+   *
+   * @param cloud The organized point cloud.
+   * @param height The number of channels (height of the range image).
+   * @param width The number of columns (width of the range image).
+   * @return BasicRangeImage
+   *
+   * @throw std::invalid_argument if the size of the cloud is not ``height *
+   * width``.
+   */
+  static BasicRangeImage from_organized(CloudMatrix cloud, int height, int width);
+
+  /**
+   * @brief Create a RangeImage object viewing an organized point cloud owned
+   * by the caller, which is not copied.
+   *
+   * @see from_organized(CloudMatrix, int, int)
+   *
+   * @param cloud The view of the organized point cloud.
+   * @param height The number of channels (height of the range image).
+   * @param width The number of columns (width of the range image).
+   * @return BasicRangeImage
+   *
+   * @throw std::invalid_argument if the size of the cloud is not ``height *
+   * width``.
+   */
+  static BasicRangeImage from_organized(const CloudView &cloud, int height, int width);
+
+  /**
+   * @brief Copy constructor. The copy views its own point cloud if the given
+   * range image owns one, and shares the caller's point cloud otherwise.
+   *
+   * @param other The range image to be copied.
+   */
+  BasicRangeImage(const BasicRangeImage &other);
+
+  /**
+   * @brief Copy assignment.
+   *
+   * @see BasicRangeImage(const BasicRangeImage &)
+   *
+   * @param other The range image to be copied.
+   * @return BasicRangeImage&
+   */
+  BasicRangeImage &operator=(const BasicRangeImage &other);
+
+  BasicRangeImage(BasicRangeImage &&other) = default;
+  BasicRangeImage &operator=(BasicRangeImage &&other) = default;
+
+  /**
+   * @brief Recompute the range image with a point cloud owned by the caller.
+   * The point cloud is not copied, and buffers allocated by previous calls are
+   * reused, so that feeding clouds of similar sizes does not allocate.
+   *
+   * @warning The caller has to keep the point cloud alive (and unchanged) as
+   * long as the range image, or any MultiScaleCurvature built from it, is in
+   * use. Temporaries and other expressions (e.g., row-major matrices or
+   * blocks) are evaluated and moved by reset(CloudMatrix &&) instead; pass a
+   * CloudView to read them in place.
+   *
+   * @param cloud The point cloud.
+   */
+  void reset(const CloudMatrix &cloud);
+
+  /**
+   * @brief Recompute the range image with a strided view of a point cloud
+   * owned by the caller (e.g., from interleaved_view()). Points are read in
+   * place, so interleaved buffers are projected with sequential reads and
+   * without a transposing copy.
+   *
+   * @see reset(const CloudMatrix &)
+   *
+   * @param cloud The view of the point cloud.
+   */
+  void reset(const CloudView &cloud);
 
   /**
-   * @brief Get the point cloud.
+   * @brief Recompute the range image with a point cloud whose ownership is
+   * transferred to the range image.
+   *
+   * @param cloud The point cloud.
+   */
+  void reset(CloudMatrix &&cloud);
+
+  /**
+   * @brief Recompute the range image with a point cloud owned by the caller
+   * and the pixel coordinates of its points.
+   *
+   * @see reset(const CloudMatrix &)
+   *
+   * @param cloud The point cloud.
+   * @param rings The channel (row) index of each point.
+   * @param columns The column index of each point.
+   *
+   * @throw std::invalid_argument if the sizes of the inputs mismatch.
+   */
+  void reset(const CloudMatrix &cloud,
+             const Eigen::Ref<const Eigen::VectorXi> &rings,
+             const Eigen::Ref<const Eigen::VectorXi> &columns);
+
+  /**
+   * @brief Recompute the range image with a strided view of a point cloud
+   * owned by the caller and the pixel coordinates of its points.
+   *
+   * @see reset(const CloudView &)
+   *
+   * @param cloud The view of the point cloud.
+   * @param rings The channel (row) index of each point.
+   * @param columns The column index of each point.
+   *
+   * @throw std::invalid_argument if the sizes of the inputs mismatch.
+   */
+  void reset(const CloudView &cloud,
+             const Eigen::Ref<const Eigen::VectorXi> &rings,
+             const Eigen::Ref<const Eigen::VectorXi> &columns);
+
+  /**
+   * @brief Recompute the range image with a point cloud whose ownership is
+   * transferred to the range image and the pixel coordinates of its points.
+   *
+   * @param cloud The point cloud.
+   * @param rings The channel (row) index of each point.
+   * @param columns The column index of each point.
+   *
+   * @throw std::invalid_argument if the sizes of the inputs mismatch.
+   */
+  void reset(CloudMatrix &&cloud,
+             const Eigen::Ref<const Eigen::VectorXi> &rings,
+             const Eigen::Ref<const Eigen::VectorXi> &columns);
+
+  /**
+   * @brief Recompute the range image with an organized point cloud owned by
+   * the caller, whose size must be ``n_channels * hfov_resolution``.
+   *
+   * @see reset(const CloudMatrix &)
+   *
+   * @param cloud The organized point cloud.
+   *
+   * @throw std::invalid_argument if the size of the cloud mismatches.
+   */
+  void reset_organized(const CloudMatrix &cloud);
+
+  /**
+   * @brief Recompute the range image with a strided view of an organized point
+   * cloud owned by the caller, whose size must be ``n_channels *
+   * hfov_resolution``.
+   *
+   * @see reset(const CloudView &)
+   *
+   * @param cloud The view of the organized point cloud.
+   *
+   * @throw std::invalid_argument if the size of the cloud mismatches.
+   */
+  void reset_organized(const CloudView &cloud);
+
+  /**
+   * @brief Recompute the range image with an organized point cloud whose
+   * ownership is transferred to the range image.
+   *
+   * @param cloud The organized point cloud.
+   *
+   * @throw std::invalid_argument if the size of the cloud mismatches.
+   */
+  void reset_organized(CloudMatrix &&cloud);
+
+  /**
+   * @brief Enable deskewing for the following projections, which corrects the
+   * motion distortion of points within the projection pass. Each point is
+   * transformed to the sensor frame at the start of the sweep, assuming a
+   * constant velocity over the sweep, by the transformation of its column
+   * (precomputed here). Pixels are kept, while depths and get_cloud() are
+   * deskewed. The range image owns the deskewed point cloud, or deskews the
+   * point cloud in place if it owns the given one.
+   *
+   * @param motion The pose of the sensor at the end of the sweep with respect
+   * to the start of the sweep, e.g., the latest KCP solution from the current
+   * scan to the previous one. The identity disables deskewing.
+   * @param deskew The layout of the sweep.
+   */
+  void set_deskew(const Eigen::Matrix4d &motion, const Deskew &deskew = Deskew());
+
+  /**
+   * @brief Get the motion of the sensor over a sweep used by deskewing, which
+   * is the identity if deskewing is disabled.
+   *
+   * @return const Eigen::Matrix4d&
+   */
+  const Eigen::Matrix4d &get_deskew_motion() const { return this->deskew_motion; }
+
+  /**
+   * @brief Get the layout of the sweep used by deskewing.
+   *
+   * @return const RangeImageBase::Deskew&
+   */
+  const Deskew &get_deskew() const { return this->deskew; }
+
+  /**
+   * @brief Set the filter of points for the following projections, which
+   * rejects points while projecting them, so no filtered point cloud is
+   * materialized. Rejected points are kept in get_cloud(), but never enter the
+   * range image.
+   *
+   * @param filter The filter of points.
+   */
+  void set_filter(const Filter &filter);
+
+  /**
+   * @brief Get the filter of points.
+   *
+   * @return const RangeImageBase::Filter&
+   */
+  const Filter &get_filter() const { return this->filter; }
+
+  /**
+   * @brief Get the point cloud, which is deskewed if deskewing is enabled.
+   * 
+   * @return CloudView
+   */
+  CloudView get_cloud() const {
+    return CloudView(this->cloud_data,
+                     this->cloud_rows,
+                     3,
+                     Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(this->cloud_outer_stride, this->cloud_inner_stride));
+  }
+
+  /**
+   * @brief Get the sensor model.
    * 
-   * @return const Eigen::MatrixX3d& 
+   * @return const SensorModel& 
    */
-  const Eigen::MatrixX3d &get_cloud() const { return this->cloud; }
+  const SensorModel &get_sensor_model() const { return this->sensor_model; }
 
   /**
    * @brief Get the number of channels.
@@ -139,6 +863,13 @@ class RangeImage {
    */
   int get_n_channels() const { return this->n_channels; }
 
+  /**
+   * @brief Get the resolution of 360-degree horizontal field of view (H-FOV).
+   * 
+   * @return int
+   */
+  int get_hfov_resolution() const { return this->hfov_resolution; }
+
   /**
    * @brief Get the size of parameterized points for the range image.
    * 
@@ -187,16 +918,33 @@ class RangeImage {
    * @return const std::vector<int>& 
    */
   const std::vector<int> &get_channel_end_indices() const { return this->channel_end_indices; }
+
+  /**
+   * @brief Get the timing and counters of the latest projection.
+   *
+   * @return const RangeImageBase::Profile&
+   */
+  const Profile &get_profile() const { return this->profile; }
 };
 
 /**
- * @brief The multi-scale curvature class for extracting corner points and plane
- * points based on the range image.
- * 
- * @see RangeImage The range image class.
+ * @brief The range image of a point cloud in double precision.
  *
  */
-class MultiScaleCurvature {
+using RangeImage = BasicRangeImage<double>;
+
+/**
+ * @brief The range image of a point cloud in single precision, which halves
+ * the memory traffic of the projection and of gathering keypoints.
+ *
+ */
+using RangeImageF = BasicRangeImage<float>;
+
+/**
+ * @brief Types shared by multi-scale curvatures of all scalar types.
+ *
+ */
+class MultiScaleCurvatureBase {
  public:
   /**
    * @brief Enum class of point labels.
@@ -212,18 +960,186 @@ class MultiScaleCurvature {
     AMBIGUOUS
   };
 
+  /**
+   * @brief Enum class of feature selection strategies within a segment.
+   *
+   * @details Both strategies visit candidates in the same order (descending
+   * curvature, ties broken by descending sequence index), so they yield
+   * identical keypoints.
+   *
+   */
+  enum class Selection {
+    /**
+     * @brief Sort all points of a segment.
+     * 
+     */
+    SORT,
+
+    /**
+     * @brief Partition points by the thresholds first. Corner candidates are
+     * popped from a heap until the per-segment cap is reached, and only plane
+     * candidates are sorted.
+     *
+     */
+    PARTIAL
+  };
+
+  /**
+   * @brief Type of parameters for the multi-scale curvature.
+   * 
+   */
+  struct Params {
+    /**
+     * @brief The threshold (lower-bound of multi-scale curvature) to determine
+     * if the point is a corner point. Default by 30.
+     *
+     */
+    float corner_threshold;
+
+    /**
+     * @brief The threshold (upper-bound of multi-scale curvature) to determine
+     * if the point is a plane point. Default by 0.1.
+     *
+     */
+    float plane_threshold;
+
+    /**
+     * @brief The number of segments of each channel. Features are selected
+     * independently within each segment. Default by 6.
+     *
+     */
+    int n_segments;
+
+    /**
+     * @brief The maximum number of corner points of each segment. Default by
+     * 12.
+     *
+     */
+    int max_corners_per_segment;
+
+    /**
+     * @brief The feature selection strategy. Default by
+     * ``Selection::PARTIAL``.
+     *
+     */
+    Selection selection;
+
+    /**
+     * @brief The kernel computing the multi-scale curvature. Default by
+     * ``CurvatureKernel::AUTO``.
+     *
+     */
+    CurvatureKernel curvature_kernel;
+
+    /**
+     * @brief The number of threads processing channels in parallel, where 0
+     * means the number of hardware threads. The thread pool is created by the
+     * first computation and reused by later ones (e.g., by ``reset``). It is
+     * ignored if ``executor`` is given. Default by 1.
+     *
+     */
+    int n_threads;
+
+    /**
+     * @brief An external executor processing channels in parallel, e.g., a
+     * thread pool shared by many sensor streams. Default by ``nullptr``.
+     *
+     */
+    std::shared_ptr<Executor> executor;
+
+    /**
+     * @brief Construct a new MultiScaleCurvature::Params object.
+     * 
+     */
+    Params() {
+      corner_threshold        = 30.0;
+      plane_threshold         = 0.1;
+      n_segments              = 6;
+      max_corners_per_segment = 12;
+      selection               = Selection::PARTIAL;
+      curvature_kernel        = CurvatureKernel::AUTO;
+      n_threads               = 1;
+      executor                = nullptr;
+    }
+  };
+
+  /**
+   * @brief Type of per-stage timings (in seconds) and counters of the
+   * extraction. Timings are zero unless KCP is built with
+   * ``KCP_ENABLE_PROFILING``. The projection is profiled by the range image.
+   *
+   */
+  struct Profile {
+    /**
+     * @brief The number of corner points.
+     *
+     */
+    size_t n_corner_points;
+
+    /**
+     * @brief The number of plane points.
+     *
+     */
+    size_t n_plane_points;
+
+    /**
+     * @brief The time of computing multi-scale curvatures.
+     *
+     */
+    double curvature_time;
+
+    /**
+     * @brief The time of selecting and gathering corner and plane points.
+     *
+     */
+    double selection_time;
+
+    /**
+     * @brief Construct a new MultiScaleCurvature::Profile object.
+     *
+     */
+    Profile() : n_corner_points(0), n_plane_points(0), curvature_time(0), selection_time(0) {}
+  };
+};
+
+/**
+ * @brief The multi-scale curvature class for extracting corner points and plane
+ * points based on the range image.
+ *
+ * @see BasicRangeImage The range image class.
+ *
+ * @tparam Scalar The scalar type of the point cloud, i.e., ``double`` or
+ * ``float``.
+ */
+template <typename Scalar>
+class BasicMultiScaleCurvature : public MultiScaleCurvatureBase {
+ public:
+  /**
+   * @brief Type of the point cloud and of the keypoints.
+   *
+   */
+  using CloudMatrix = typename BasicRangeImage<Scalar>::CloudMatrix;
+
  protected:
   /**
    * @brief The range image.
    * 
    */
-  RangeImage range_image;
+  BasicRangeImage<Scalar> range_image;
 
   /**
-   * @brief Multi-scale curvatures stored as a vector of {kappa, index}.
+   * @brief Parameters for the multi-scale curvature.
    * 
    */
-  std::vector<std::pair<float, int>> curvature;
+  Params params;
+
+  /**
+   * @brief Multi-scale curvatures of points ordered by channels (aligned with
+   * the sequences of the range image). Points of channels too short to be
+   * evaluated have the maximum float value.
+   *
+   */
+  std::vector<float> curvature;
 
   /**
    * @brief Labels of the points.
@@ -232,30 +1148,77 @@ class MultiScaleCurvature {
   std::vector<Label> label;
 
   /**
-   * @brief The threshold (lower-bound of multi-scale curvature) to determine if
-   * the point is a corner point.
-   * 
+   * @brief Buffers owned by a worker.
+   *
    */
-  float corner_threshold;
+  struct Workspace {
+    /**
+     * @brief Buffer of the depth row of a channel padded with cyclic halo
+     * elements.
+     *
+     */
+    std::vector<float> padded_depth;
+
+    /**
+     * @brief Buffer of candidates within a segment, where each candidate is
+     * packed as ``(curvature bits << 32) | sequence index`` so that the integer
+     * order matches the order of {curvature, index}.
+     *
+     */
+    std::vector<uint64_t> candidates;
+  };
 
   /**
-   * @brief The threshold (upper-bound of multi-scale curvature) to determine if
-   * the point is a plane point.
-   * 
+   * @brief Buffers of workers.
+   *
    */
-  float plane_threshold;
+  std::vector<Workspace> workspaces;
+
+  /**
+   * @brief The thread pool owned by the multi-scale curvature, which is created
+   * on demand if no external executor is given and kept across computations.
+   *
+   */
+  std::shared_ptr<ThreadPool> thread_pool;
+
+  /**
+   * @brief Sequence indices of points arranged for the feature selection. The
+   * selection of a segment may permute its own slots.
+   *
+   */
+  std::vector<int> segment_order;
+
+  /**
+   * @brief Timings and counters of the extraction.
+   *
+   */
+  Profile profile;
+
+  /**
+   * @brief Sequence indices of corner points selected in each channel, which
+   * are merged in channel order.
+   *
+   */
+  std::vector<std::vector<int>> channel_corner_point_indices;
+
+  /**
+   * @brief Sequence indices of plane points selected in each channel, which
+   * are merged in channel order.
+   *
+   */
+  std::vector<std::vector<int>> channel_plane_point_indices;
 
   /**
    * @brief Corner points in terms of position.
    * 
    */
-  Eigen::MatrixX3d corner_points;
+  CloudMatrix corner_points;
 
   /**
    * @brief Plane points in terms of position.
    * 
    */
-  Eigen::MatrixX3d plane_points;
+  CloudMatrix plane_points;
 
   /**
    * @brief Corner points in terms of their indices.
@@ -269,6 +1232,19 @@ class MultiScaleCurvature {
    */
   std::vector<int> plane_point_indices;
 
+  /**
+   * @brief Multi-scale curvatures of corner points.
+   *
+   */
+  std::vector<float> corner_point_curvatures;
+
+  /**
+   * @brief Get the executor processing channels in parallel.
+   *
+   * @return The executor, or ``nullptr`` for running in the calling thread.
+   */
+  Executor *get_executor();
+
   /**
    * @brief Compute the multi-scale curvature and choose corner points and plane
    * points.
@@ -276,6 +1252,44 @@ class MultiScaleCurvature {
    */
   void calculate_multi_scale_curvature();
 
+  /**
+   * @brief Choose corner points and plane points of a channel.
+   *
+   * @param channel The channel index.
+   * @param workspace Buffers of the calling worker.
+   */
+  void select_channel_features(int channel, Workspace &workspace);
+
+  /**
+   * @brief Choose corner points and plane points within a segment.
+   *
+   * @param sp The starting slot of the segment in ``segment_order``.
+   * @param ep The past-the-end slot of the segment in ``segment_order``.
+   * @param sc The first sequence index of the channel.
+   * @param ec The last sequence index of the channel.
+   * @param workspace Buffers of the calling worker.
+   * @param corner_indices Output sequence indices of corner points.
+   * @param plane_indices Output sequence indices of plane points.
+   */
+  void select_segment_features(int sp,
+                               int ep,
+                               int sc,
+                               int ec,
+                               Workspace &workspace,
+                               std::vector<int> &corner_indices,
+                               std::vector<int> &plane_indices);
+
+  /**
+   * @brief Mark at most five neighbors on each side of a selected point as
+   * ambiguous. The marking stops at a gap of more than ten columns and at the
+   * ends of the channel.
+   *
+   * @param idx The sequence index of the selected point.
+   * @param sc The first sequence index of the channel.
+   * @param ec The last sequence index of the channel.
+   */
+  void mark_ambiguous_neighbors(int idx, int sc, int ec);
+
  public:
   /**
    * @brief Construct a new MultiScaleCurvature object.
@@ -286,7 +1300,17 @@ class MultiScaleCurvature {
    * @param plane_threshold The threshold (upper-bound of multi-scale curvature)
    * to determine if the point is a plane point.
    */
-  MultiScaleCurvature(RangeImage range_image, float corner_threshold = 30.0, float plane_threshold = 0.1);
+  BasicMultiScaleCurvature(BasicRangeImage<Scalar> range_image,
+                           float corner_threshold = 30.0,
+                           float plane_threshold  = 0.1);
+
+  /**
+   * @brief Construct a new MultiScaleCurvature object.
+   *
+   * @param range_image The pre-computed range image.
+   * @param params Parameters for the multi-scale curvature.
+   */
+  BasicMultiScaleCurvature(BasicRangeImage<Scalar> range_image, const Params &params);
 
   /**
    * @brief Construct a new MultiScaleCurvature object. The corresponding range
@@ -306,34 +1330,74 @@ class MultiScaleCurvature {
    * @param plane_threshold The threshold (upper-bound of multi-scale curvature)
    * to determine if the point is a plane point.
    */
-  MultiScaleCurvature(Eigen::MatrixX3d cloud,
-                      int n_channels         = 32,
-                      float min_vfov_deg     = -30.0,
-                      float max_vfov_deg     = 10.0,
-                      int hfov_resolution    = 1800,
-                      float corner_threshold = 30.0,
-                      float plane_threshold  = 0.1);
+  BasicMultiScaleCurvature(CloudMatrix cloud,
+                           int n_channels         = 32,
+                           float min_vfov_deg     = -30.0,
+                           float max_vfov_deg     = 10.0,
+                           int hfov_resolution    = 1800,
+                           float corner_threshold = 30.0,
+                           float plane_threshold  = 0.1);
+
+  /**
+   * @brief Construct a new MultiScaleCurvature object with a sensor model. The
+   * corresponding range image will be computed within the constructor.
+   *
+   * @param cloud The point cloud.
+   * @param sensor_model The beam layout of the LiDAR, which determines the
+   * number of channels.
+   * @param hfov_resolution The resolution of 360-degree horizontal field of
+   * view.
+   * @param corner_threshold The threshold (lower-bound of multi-scale
+   * curvature) to determine if the point is a corner point.
+   * @param plane_threshold The threshold (upper-bound of multi-scale curvature)
+   * to determine if the point is a plane point.
+   */
+  BasicMultiScaleCurvature(CloudMatrix cloud,
+                           const SensorModel &sensor_model,
+                           int hfov_resolution    = 1800,
+                           float corner_threshold = 30.0,
+                           float plane_threshold  = 0.1);
+
+  /**
+   * @brief Recompute the multi-scale curvature with another range image,
+   * reusing the buffers of the previous computation.
+   *
+   * @details The range images are swapped, i.e., the previous range image is
+   * handed back through the argument. A streaming caller can reset it with the
+   * next scan without reallocating its buffers.
+   *
+   * @param range_image The pre-computed range image, which receives the
+   * previous range image.
+   */
+  void reset(BasicRangeImage<Scalar> &range_image);
+
+  /**
+   * @brief Get the parameters.
+   * 
+   * @return const MultiScaleCurvatureBase::Params& 
+   */
+  const Params &get_params() const { return this->params; }
 
   /**
    * @brief Get the range image.
    * 
-   * @return const RangeImage& 
+   * @return const BasicRangeImage<Scalar>& 
    */
-  const RangeImage &get_range_image() const { return this->range_image; }
+  const BasicRangeImage<Scalar> &get_range_image() const { return this->range_image; }
 
   /**
    * @brief Get the corner points in terms of position.
    * 
-   * @return const Eigen::MatrixX3d& 
+   * @return const CloudMatrix& 
    */
-  const Eigen::MatrixX3d &get_corner_points() const { return this->corner_points; }
+  const CloudMatrix &get_corner_points() const { return this->corner_points; }
 
   /**
    * @brief Get the plane points in terms of position.
    * 
-   * @return const Eigen::MatrixX3d& 
+   * @return const CloudMatrix& 
    */
-  const Eigen::MatrixX3d &get_plane_points() const { return this->plane_points; }
+  const CloudMatrix &get_plane_points() const { return this->plane_points; }
 
   /**
    * @brief Get the corner points in terms of their indices.
@@ -350,13 +1414,40 @@ class MultiScaleCurvature {
   const std::vector<int> &get_plane_point_indices() const { return this->plane_point_indices; }
 
   /**
-   * @brief Get the multi-scale curvatures.
-   * 
-   * @return const std::vector<std::pair<float, int>>& 
+   * @brief Get the multi-scale curvatures of corner points, which are aligned
+   * with the corner points.
+   *
+   * @return const std::vector<float>&
    */
-  const std::vector<std::pair<float, int>> &get_curvature() const { return this->curvature; }
+  const std::vector<float> &get_corner_point_curvatures() const { return this->corner_point_curvatures; }
+
+  /**
+   * @brief Get the multi-scale curvatures of points ordered by channels.
+   *
+   * @return const std::vector<float>&
+   */
+  const std::vector<float> &get_curvature() const { return this->curvature; }
+
+  /**
+   * @brief Get timings and counters of the extraction.
+   *
+   * @return const MultiScaleCurvatureBase::Profile&
+   */
+  const Profile &get_profile() const { return this->profile; }
 };
 
+/**
+ * @brief The multi-scale curvature of a point cloud in double precision.
+ *
+ */
+using MultiScaleCurvature = BasicMultiScaleCurvature<double>;
+
+/**
+ * @brief The multi-scale curvature of a point cloud in single precision.
+ *
+ */
+using MultiScaleCurvatureF = BasicMultiScaleCurvature<float>;
+
 };  // namespace keypoint
 
 };  // namespace kcp
@@ -0,0 +1,297 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "kcp/common.hpp"
+#include "kcp/target.hpp"
+
+#include <unordered_map>
+
+namespace kcp {
+
+/**
+ * @brief A local map of keypoints for scan-to-map registration, stored in a
+ * voxel hash.
+ *
+ * @details Keypoints of each scan are transformed into the map frame and
+ * inserted into their voxels. Points farther than ``radius`` from the latest
+ * sensor position, or older than ``max_age`` insertions, are evicted. Queries
+ * visit voxels ring by ring around the query point, so neither insertions nor
+ * queries rebuild any tree, and the maintenance cost of a frame is bounded by
+ * the size of the map rather than the length of the trajectory.
+ *
+ * The features of the map are the map points themselves, so the source
+ * features should be the source points transformed by the predicted pose.
+ * A typical loop of scan-to-map odometry is
+ *
+ * ```cpp
+ * Eigen::MatrixX3d guess = transform(scan, predicted_pose);
+ * solver.solve(guess, guess, local_map);
+ * pose = solver.get_solution() * predicted_pose;
+ * local_map.insert(scan, pose);
+ * ```
+ *
+ * Target indices reported by queries refer to ``get_points()`` and are valid
+ * until the next insertion. The map must not be modified during queries.
+ *
+ */
+class LocalMap : public Target {
+ public:
+  /**
+   * @brief Type of parameters for the local map.
+   *
+   */
+  struct Params {
+    /**
+     * @brief The edge length of voxels in meters. Default by 1.
+     *
+     */
+    double voxel_size;
+
+    /**
+     * @brief The maximum number of points of a voxel. New points falling into
+     * a full voxel are dropped. Default by 20.
+     *
+     */
+    int max_points_per_voxel;
+
+    /**
+     * @brief Points farther than the radius (in meters) from the latest sensor
+     * position are evicted. Default by 100.
+     *
+     */
+    double radius;
+
+    /**
+     * @brief Points inserted more than ``max_age`` insertions ago are evicted,
+     * where 0 keeps points regardless of their ages. Default by 0.
+     *
+     */
+    int max_age;
+
+    /**
+     * @brief Construct a new LocalMap::Params object.
+     *
+     */
+    Params() {
+      voxel_size           = 1.0;
+      max_points_per_voxel = 20;
+      radius               = 100.0;
+      max_age              = 0;
+    }
+  };
+
+ protected:
+  /**
+   * @brief Type of voxel coordinates.
+   *
+   */
+  using VoxelKey = Eigen::Vector3i;
+
+  /**
+   * @brief Hash function of voxel coordinates.
+   *
+   */
+  struct VoxelHash {
+    size_t operator()(const VoxelKey &key) const {
+      return (static_cast<size_t>(key.x()) * 73856093) ^
+             (static_cast<size_t>(key.y()) * 19349669) ^
+             (static_cast<size_t>(key.z()) * 83492791);
+    }
+  };
+
+  /**
+   * @brief Points of a voxel.
+   *
+   */
+  struct Voxel {
+    /**
+     * @brief Points in the map frame.
+     *
+     */
+    std::vector<Eigen::Vector3d> points;
+
+    /**
+     * @brief The insertion count when each point is inserted.
+     *
+     */
+    std::vector<size_t> stamps;
+
+    /**
+     * @brief The index of the first point of the voxel in ``points`` of the
+     * map.
+     *
+     */
+    size_t offset;
+  };
+
+  /**
+   * @brief Parameters for the local map.
+   *
+   */
+  LocalMap::Params params;
+
+  /**
+   * @brief Voxels indexed by their coordinates.
+   *
+   */
+  std::unordered_map<VoxelKey, Voxel, VoxelHash> voxels;
+
+  /**
+   * @brief All points of the map, ordered by voxels.
+   *
+   */
+  Eigen::MatrixX3d points;
+
+  /**
+   * @brief The lower bound of coordinates of occupied voxels.
+   *
+   */
+  VoxelKey min_key;
+
+  /**
+   * @brief The upper bound of coordinates of occupied voxels.
+   *
+   */
+  VoxelKey max_key;
+
+  /**
+   * @brief The number of insertions.
+   *
+   */
+  size_t n_insertions;
+
+  /**
+   * @brief Get the coordinates of the voxel containing a point.
+   *
+   * @param point The point.
+   * @return VoxelKey
+   */
+  VoxelKey get_voxel_key(const Eigen::Vector3d &point) const;
+
+  /**
+   * @brief Evict points out of the radius or the age limit, and gather all
+   * points into ``points``.
+   *
+   * @param position The latest sensor position.
+   */
+  void update(const Eigen::Vector3d &position);
+
+  /**
+   * @brief Query k closest points of a point.
+   *
+   * @param query The query point.
+   * @param k The number of closest points.
+   * @param neighbors Output pairs of {squared distance, index} sorted by
+   * squared distances, which is also used as a heap during the search.
+   */
+  void search_k_closest_points(const Eigen::Vector3d &query,
+                               size_t k,
+                               std::vector<std::pair<double, int>> &neighbors) const;
+
+  /**
+   * @brief Query k closest points of each source point.
+   *
+   * @param src The source point cloud.
+   * @param src_feature The source points in the map frame.
+   * @param k The number of closest points.
+   * @param correspondences The output set of correspondences.
+   * @param squared_distances The output squared distances, or ``nullptr``.
+   * @param executor The executor running queries in parallel, or ``nullptr``.
+   */
+  void search_points(const Eigen::MatrixX3d &src,
+                     const Eigen::MatrixXd &src_feature,
+                     size_t k,
+                     Correspondences &correspondences,
+                     std::vector<double> *squared_distances,
+                     Executor *executor) const;
+
+ public:
+  /**
+   * @brief Construct a new LocalMap object.
+   *
+   * @param params Parameters for the local map.
+   *
+   * @throw std::invalid_argument if the voxel size is not positive or the
+   * maximum number of points of a voxel is not positive.
+   */
+  explicit LocalMap(const LocalMap::Params &params = LocalMap::Params());
+
+  /**
+   * @brief Insert points of a scan into the map and evict stale points.
+   *
+   * @param scan Points in the sensor frame.
+   * @param pose The pose of the sensor in the map frame.
+   */
+  void insert(const Eigen::MatrixX3d &scan, const Eigen::Matrix4d &pose);
+
+  /**
+   * @brief Remove all points.
+   *
+   */
+  void clear();
+
+  /**
+   * @brief Get the parameters.
+   *
+   * @return const LocalMap::Params&
+   */
+  const LocalMap::Params &get_params() const { return this->params; }
+
+  /**
+   * @brief Get all points of the map.
+   *
+   * @return const Eigen::MatrixX3d&
+   */
+  const Eigen::MatrixX3d &get_points() const { return this->points; }
+
+  /**
+   * @brief Get the number of occupied voxels.
+   *
+   * @return size_t
+   */
+  size_t get_n_voxels() const { return this->voxels.size(); }
+
+  size_t get_size() const override { return this->points.rows(); }
+
+  int get_feature_dim() const override { return 3; }
+
+  Eigen::Vector3d get_point(size_t index) const override { return this->points.row(index).transpose(); }
+
+  using Target::search;
+
+  /**
+   * @brief Query k closest points of each source point.
+   *
+   * @see Target::search
+   *
+   * @param src The source point cloud.
+   * @param src_feature The source points in the map frame, which are used to
+   * compute distances.
+   * @param k The number of closest points, which must not exceed the size of
+   * the map.
+   * @param correspondences The output set of correspondences, whose size must
+   * be ``src.rows() * k``.
+   * @param executor The executor running queries in parallel, or ``nullptr``
+   * to run them in the calling thread.
+   *
+   * @throw std::invalid_argument if features are not 3-dimensional or ``k``
+   * exceeds the size of the map.
+   */
+  void search(const Eigen::MatrixX3d &src,
+              const Eigen::MatrixXd &src_feature,
+              size_t k,
+              Correspondences &correspondences,
+              Executor *executor = nullptr) const override;
+
+  void search(const Eigen::MatrixX3d &src,
+              const Eigen::MatrixXd &src_feature,
+              size_t k,
+              Correspondences &correspondences,
+              std::vector<double> &squared_distances,
+              Executor *executor = nullptr) const override;
+};
+
+};  // namespace kcp
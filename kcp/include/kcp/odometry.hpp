@@ -0,0 +1,336 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "kcp/common.hpp"
+#include "kcp/keypoint.hpp"
+#include "kcp/parallel.hpp"
+#include "kcp/sampler.hpp"
+#include "kcp/sensor.hpp"
+#include "kcp/solver.hpp"
+#include "kcp/target.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace kcp {
+
+/**
+ * @brief A streaming LiDAR odometry pipeline, where scans are pushed one by
+ * one and each scan is registered to the previous one.
+ *
+ * @details The pipeline runs two stages on two threads. The keypoint stage
+ * extracts corner and plane points of a scan with the multi-scale curvature
+ * and builds the kd-tree of its corner points, while the solver stage
+ * registers the previous scan with KCP-TEASER. Since both stages overlap, the
+ * throughput approaches the slower stage rather than the sum of them. The
+ * keypoints and the kd-tree of each scan are computed exactly once and kept
+ * until the next scan is registered against them.
+ *
+ * Results are emitted in order through the callback, which is called by the
+ * solver thread.
+ *
+ */
+class StreamingOdometry {
+ public:
+  /**
+   * @brief Type of parameters for the streaming odometry.
+   *
+   */
+  struct Params {
+    /**
+     * @brief Parameters for the KCP-TEASER solver. Plane points are used for
+     * the refinement if ``kcp.refinement_iterations`` is positive.
+     *
+     */
+    KCP::Params kcp;
+
+    /**
+     * @brief Parameters for the multi-scale curvature.
+     *
+     */
+    keypoint::MultiScaleCurvature::Params keypoint;
+
+    /**
+     * @brief The maximum number of corner points of a scan, which are reduced
+     * by a voxel sampler scored by multi-scale curvatures, where 0 keeps all
+     * corner points. Default by 0.
+     *
+     */
+    size_t max_corner_points;
+
+    /**
+     * @brief Whether to deskew scans during their projection, where the motion
+     * over a sweep is the latest solution of the solver stage (i.e., a
+     * constant velocity prior). Default by false.
+     *
+     */
+    bool deskew;
+
+    /**
+     * @brief The layout of sweeps for deskewing. Default by sweeps starting
+     * at column 0 in ascending order.
+     *
+     */
+    keypoint::RangeImageBase::Deskew deskew_layout;
+
+    /**
+     * @brief The filter of points applied while projecting scans, e.g.,
+     * removing the ego vehicle and ground points. Default by keeping all
+     * points.
+     *
+     */
+    keypoint::RangeImageBase::Filter filter;
+
+    /**
+     * @brief The beam layout of the LiDAR. Default by a uniform layout of 32
+     * channels from -30 to 10 degrees.
+     *
+     */
+    SensorModel sensor_model;
+
+    /**
+     * @brief The resolution of 360-degree horizontal field of view (H-FOV).
+     * Default by 1800.
+     *
+     */
+    int hfov_resolution;
+
+    /**
+     * @brief The maximum number of scans (and frames) waiting for each stage.
+     * Pushing blocks while the keypoint stage is full. Default by 2.
+     *
+     */
+    size_t queue_capacity;
+
+    /**
+     * @brief Construct a new StreamingOdometry::Params object.
+     *
+     */
+    Params() : sensor_model(SensorModel::uniform(32, -30, 10)) {
+      max_corner_points = 0;
+      deskew            = false;
+      hfov_resolution   = 1800;
+      queue_capacity    = 2;
+    }
+  };
+
+  /**
+   * @brief Type of the result of a scan.
+   *
+   */
+  struct Result {
+    /**
+     * @brief The index of the scan in the stream.
+     *
+     */
+    size_t index;
+
+    /**
+     * @brief The pose of the scan with respect to the first scan.
+     *
+     */
+    Eigen::Matrix4d pose;
+
+    /**
+     * @brief The transformation from the scan to the previous scan, which is
+     * the identity for the first scan.
+     *
+     */
+    Eigen::Matrix4d solution;
+
+    /**
+     * @brief The number of corner points of the scan.
+     *
+     */
+    size_t n_corner_points;
+
+    /**
+     * @brief The number of plane points of the scan.
+     *
+     */
+    size_t n_plane_points;
+  };
+
+  /**
+   * @brief Type of the callback receiving results.
+   *
+   */
+  using Callback = std::function<void(const Result &)>;
+
+ protected:
+  /**
+   * @brief Keypoints and the kd-tree of a scan.
+   *
+   */
+  struct Frame {
+    size_t index;
+    std::shared_ptr<const TargetIndex> corner_index;
+    Eigen::MatrixX3d plane_points;
+  };
+
+  /**
+   * @brief A pushed scan.
+   *
+   */
+  struct Scan {
+    size_t index;
+    Eigen::MatrixX3d cloud;
+  };
+
+  /**
+   * @brief Parameters for the streaming odometry.
+   *
+   */
+  StreamingOdometry::Params params;
+
+  /**
+   * @brief The callback receiving results.
+   *
+   */
+  Callback callback;
+
+  /**
+   * @brief The KCP-TEASER solver, which is only used by the solver thread.
+   *
+   */
+  KCP solver;
+
+  /**
+   * @brief Scans waiting for the keypoint stage.
+   *
+   */
+  BoundedQueue<Scan> scans;
+
+  /**
+   * @brief Frames waiting for the solver stage.
+   *
+   */
+  BoundedQueue<Frame> frames;
+
+  /**
+   * @brief The number of pushed scans.
+   *
+   */
+  size_t n_pushed;
+
+  /**
+   * @brief The number of scans whose results are emitted.
+   *
+   */
+  size_t n_finished;
+
+  /**
+   * @brief The latest solution of the solver stage, which is the motion used
+   * by deskewing.
+   *
+   */
+  Eigen::Matrix4d latest_solution;
+
+  /**
+   * @brief The first exception thrown by the stages.
+   *
+   */
+  std::exception_ptr error;
+
+  /**
+   * @brief Mutex guarding the counters, the latest solution and the
+   * exception.
+   *
+   */
+  std::mutex mutex;
+
+  /**
+   * @brief Condition variable notifying of finished scans.
+   *
+   */
+  std::condition_variable finished;
+
+  /**
+   * @brief The thread of the keypoint stage.
+   *
+   */
+  std::thread keypoint_thread;
+
+  /**
+   * @brief The thread of the solver stage.
+   *
+   */
+  std::thread solver_thread;
+
+  /**
+   * @brief The loop of the keypoint stage.
+   *
+   */
+  void run_keypoint_stage();
+
+  /**
+   * @brief The loop of the solver stage.
+   *
+   */
+  void run_solver_stage();
+
+  /**
+   * @brief Record the exception of a stage, and stop the pipeline.
+   *
+   */
+  void fail(std::exception_ptr exception);
+
+  /**
+   * @brief Rethrow the recorded exception if any.
+   *
+   */
+  void rethrow_error();
+
+ public:
+  /**
+   * @brief Construct a new StreamingOdometry object, where the threads of both
+   * stages are started.
+   *
+   * @param params Parameters for the streaming odometry.
+   * @param callback The callback receiving results.
+   */
+  StreamingOdometry(const StreamingOdometry::Params &params, Callback callback);
+
+  StreamingOdometry(const StreamingOdometry &) = delete;
+  StreamingOdometry &operator=(const StreamingOdometry &) = delete;
+
+  /**
+   * @brief Destroy the StreamingOdometry object, which closes the pipeline.
+   *
+   */
+  ~StreamingOdometry();
+
+  /**
+   * @brief Close the pipeline. Pushed scans are processed before the threads
+   * are joined, and later pushes throw. Closing twice has no effect.
+   *
+   */
+  void close();
+
+  /**
+   * @brief Push a scan, which blocks while the keypoint stage is full.
+   *
+   * @param cloud The point cloud of the scan.
+   * @return size_t The index of the scan in the stream.
+   *
+   * @throw The exception thrown by a stage (e.g., by the callback), after
+   * which the pipeline is stopped.
+   */
+  size_t push(Eigen::MatrixX3d cloud);
+
+  /**
+   * @brief Wait until the results of all pushed scans are emitted.
+   *
+   * @throw The exception thrown by a stage.
+   */
+  void flush();
+};
+
+};  // namespace kcp
@@ -0,0 +1,268 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kcp {
+
+/**
+ * @brief Interface of executors running data-parallel loops.
+ *
+ * @details An executor runs ``n_tasks`` independent tasks and returns after
+ * all of them are finished. Each task receives its own index and the index of
+ * the worker running it, which is in ``[0, get_n_workers())`` and is unique
+ * among the workers of a single ``run`` call, so that callers can keep
+ * per-worker buffers without locking.
+ *
+ * Applications owning their own thread pool can implement this interface to
+ * share it with KCP instead of letting KCP spawn threads.
+ *
+ */
+class Executor {
+ public:
+  /**
+   * @brief Type of a task, which is called as ``task(task_index,
+   * worker_index)``.
+   *
+   */
+  using Task = std::function<void(size_t, size_t)>;
+
+  virtual ~Executor() = default;
+
+  /**
+   * @brief Get the maximum number of workers running tasks concurrently.
+   *
+   * @return size_t
+   */
+  virtual size_t get_n_workers() const = 0;
+
+  /**
+   * @brief Run tasks and block until all of them are finished.
+   *
+   * @param n_tasks The number of tasks.
+   * @param task The task.
+   */
+  virtual void run(size_t n_tasks, const Task &task) = 0;
+};
+
+/**
+ * @brief A fixed-size thread pool.
+ *
+ * @details The thread calling ``run`` takes part in its own tasks as the
+ * worker 0, so a pool of ``n`` workers spawns ``n - 1`` threads. Multiple
+ * threads may call ``run`` concurrently, and tasks may call ``run`` again
+ * (nested loops) without deadlock.
+ *
+ */
+class ThreadPool : public Executor {
+ protected:
+  struct Job;
+
+  /**
+   * @brief Background threads.
+   *
+   */
+  std::vector<std::thread> threads;
+
+  /**
+   * @brief Jobs which still have unclaimed tasks.
+   *
+   */
+  std::deque<std::shared_ptr<Job>> jobs;
+
+  /**
+   * @brief Mutex guarding the job queue and the job states.
+   *
+   */
+  std::mutex mutex;
+
+  /**
+   * @brief Condition variable notifying background threads of new jobs.
+   *
+   */
+  std::condition_variable job_available;
+
+  /**
+   * @brief Condition variable notifying callers of finished jobs.
+   *
+   */
+  std::condition_variable job_finished;
+
+  /**
+   * @brief Whether the pool is being destroyed.
+   *
+   */
+  bool stopping;
+
+  /**
+   * @brief The loop of a background thread.
+   *
+   * @param worker The worker index of the thread.
+   */
+  void work(size_t worker);
+
+  /**
+   * @brief Claim and run tasks of a job until no task is left.
+   *
+   * @param job The job.
+   * @param worker The worker index of the calling thread.
+   */
+  void participate(Job &job, size_t worker);
+
+ public:
+  /**
+   * @brief Construct a new ThreadPool object.
+   *
+   * @param n_workers The number of workers including the calling thread. Zero
+   * means the number of hardware threads.
+   */
+  explicit ThreadPool(size_t n_workers = 0);
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * @brief Destroy the ThreadPool object. Background threads are joined.
+   *
+   */
+  ~ThreadPool() override;
+
+  size_t get_n_workers() const override { return this->threads.size() + 1; }
+
+  /**
+   * @brief Run tasks and block until all of them are finished.
+   *
+   * @param n_tasks The number of tasks.
+   * @param task The task.
+   *
+   * @throw The first exception thrown by tasks, which is rethrown after all
+   * claimed tasks are finished.
+   */
+  void run(size_t n_tasks, const Task &task) override;
+};
+
+/**
+ * @brief A bounded blocking queue connecting pipeline stages, which are run by
+ * different threads.
+ *
+ * @tparam T The type of items.
+ */
+template <typename T>
+class BoundedQueue {
+ protected:
+  /**
+   * @brief Queued items.
+   *
+   */
+  std::deque<T> items;
+
+  /**
+   * @brief The maximum number of queued items.
+   *
+   */
+  size_t capacity;
+
+  /**
+   * @brief Whether the queue is closed.
+   *
+   */
+  bool closed;
+
+  /**
+   * @brief Mutex guarding the queue.
+   *
+   */
+  std::mutex mutex;
+
+  /**
+   * @brief Condition variable notifying consumers of new items.
+   *
+   */
+  std::condition_variable not_empty;
+
+  /**
+   * @brief Condition variable notifying producers of free slots.
+   *
+   */
+  std::condition_variable not_full;
+
+ public:
+  /**
+   * @brief Construct a new BoundedQueue object.
+   *
+   * @param capacity The maximum number of queued items (at least 1).
+   */
+  explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1), closed(false) {}
+
+  /**
+   * @brief Push an item, which blocks while the queue is full.
+   *
+   * @param item The item.
+   * @return bool ``false`` if the queue is closed (and the item is dropped).
+   */
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->not_full.wait(lock, [this] { return this->closed || this->items.size() < this->capacity; });
+    if (this->closed)
+      return false;
+
+    this->items.push_back(std::move(item));
+    lock.unlock();
+    this->not_empty.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Pop an item, which blocks while the queue is empty and open.
+   *
+   * @param item The popped item.
+   * @return bool ``false`` if the queue is closed and empty.
+   */
+  bool pop(T &item) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->not_empty.wait(lock, [this] { return this->closed || !this->items.empty(); });
+    if (this->items.empty())
+      return false;
+
+    item = std::move(this->items.front());
+    this->items.pop_front();
+    lock.unlock();
+    this->not_full.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Close the queue. Queued items can still be popped.
+   *
+   */
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->closed = true;
+    }
+    this->not_empty.notify_all();
+    this->not_full.notify_all();
+  }
+};
+
+/**
+ * @brief Run tasks on the executor if it is given and otherwise in the calling
+ * thread (as the worker 0).
+ *
+ * @param executor The executor, or ``nullptr``.
+ * @param n_tasks The number of tasks.
+ * @param task The task.
+ */
+void run_tasks(Executor *executor, size_t n_tasks, const Executor::Task &task);
+
+};  // namespace kcp
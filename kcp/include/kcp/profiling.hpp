@@ -0,0 +1,66 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+
+namespace kcp {
+
+/**
+ * @brief Whether per-stage timings are collected, which is controlled by the
+ * CMake option ``KCP_ENABLE_PROFILING``. Counters are always collected.
+ *
+ */
+#ifdef KCP_ENABLE_PROFILING
+constexpr bool PROFILING_ENABLED = true;
+#else
+constexpr bool PROFILING_ENABLED = false;
+#endif
+
+/**
+ * @brief A timer adding the wall time of its scope (in seconds) to a
+ * variable. It compiles to nothing if profiling is disabled.
+ *
+ */
+class ScopedTimer {
+#ifdef KCP_ENABLE_PROFILING
+ protected:
+  /**
+   * @brief The variable accumulating the elapsed time.
+   *
+   */
+  double &seconds;
+
+  /**
+   * @brief The time when the timer is constructed.
+   *
+   */
+  std::chrono::steady_clock::time_point start;
+
+ public:
+  /**
+   * @brief Construct a new ScopedTimer object, which starts timing.
+   *
+   * @param seconds The variable accumulating the elapsed time.
+   */
+  explicit ScopedTimer(double &seconds) : seconds(seconds), start(std::chrono::steady_clock::now()) {}
+
+  /**
+   * @brief Destroy the ScopedTimer object, which adds the elapsed time.
+   *
+   */
+  ~ScopedTimer() {
+    this->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+  }
+#else
+ public:
+  explicit ScopedTimer(double &) {}
+#endif
+
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+};
+
+};  // namespace kcp
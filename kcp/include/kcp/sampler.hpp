@@ -0,0 +1,286 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "kcp/common.hpp"
+#include "kcp/keypoint.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace kcp {
+
+namespace keypoint {
+
+/**
+ * @brief Types shared by voxel samplers of all scalar types.
+ *
+ */
+class VoxelSamplerBase {
+ public:
+  /**
+   * @brief Type of parameters for the voxel sampler.
+   *
+   */
+  struct Params {
+    /**
+     * @brief The maximum number of sampled points. Default by 500.
+     *
+     */
+    size_t max_points;
+
+    /**
+     * @brief The maximum number of voxel sizes tried by the search. Default by
+     * 16.
+     *
+     */
+    int max_iterations;
+
+    /**
+     * @brief The search stops once a voxel size yields at least
+     * ``max_points`` and at most ``(1 + tolerance) * max_points`` voxels, and
+     * the extra voxels are dropped. No voxel size is searched if there are at
+     * most ``(1 + tolerance) * max_points`` points. Default by 0.1.
+     *
+     */
+    double tolerance;
+
+    /**
+     * @brief Construct a new VoxelSampler::Params object.
+     *
+     */
+    Params() {
+      max_points     = 500;
+      max_iterations = 16;
+      tolerance      = 0.1;
+    }
+  };
+
+  /**
+   * @brief Type of the timing (in seconds) and counters of the latest
+   * sampling. The timing is zero unless KCP is built with
+   * ``KCP_ENABLE_PROFILING``.
+   *
+   */
+  struct Profile {
+    /**
+     * @brief The number of input points.
+     *
+     */
+    size_t n_points;
+
+    /**
+     * @brief The number of sampled points.
+     *
+     */
+    size_t n_sampled_points;
+
+    /**
+     * @brief The number of occupied voxels of the chosen voxel size.
+     *
+     */
+    size_t n_voxels;
+
+    /**
+     * @brief The number of voxel sizes tried by the search.
+     *
+     */
+    int n_iterations;
+
+    /**
+     * @brief The time of the sampling.
+     *
+     */
+    double sampling_time;
+
+    /**
+     * @brief Construct a new VoxelSampler::Profile object.
+     *
+     */
+    Profile() : n_points(0), n_sampled_points(0), n_voxels(0), n_iterations(0), sampling_time(0) {}
+  };
+};
+
+/**
+ * @brief A sampler reducing keypoints to a bounded number with a voxel grid,
+ * which controls the cost of the k closest points search and the maximum
+ * clique pruning downstream.
+ *
+ * @details The voxel size is searched such that the number of occupied voxels
+ * slightly exceeds ``max_points``. Each voxel keeps its highest scored point
+ * (e.g., the point of the largest multi-scale curvature), and the lowest
+ * scored representatives are dropped down to ``max_points``. Without scores,
+ * each voxel keeps its first point and representatives are dropped evenly.
+ * Voxels are stored in an open addressing hash table, so each voxel size is
+ * evaluated in linear time.
+ *
+ * Sampled points keep their input order, and the result is deterministic.
+ *
+ * @tparam Scalar The scalar type of points, i.e., ``double`` or ``float``.
+ */
+template <typename Scalar>
+class BasicVoxelSampler : public VoxelSamplerBase {
+ public:
+  /**
+   * @brief Type of the point cloud and of the sampled points.
+   *
+   */
+  using CloudMatrix = Eigen::Matrix<Scalar, Eigen::Dynamic, 3>;
+
+ protected:
+  /**
+   * @brief Parameters for the voxel sampler.
+   *
+   */
+  Params params;
+
+  /**
+   * @brief Timings and counters of the latest sampling.
+   *
+   */
+  Profile profile;
+
+  /**
+   * @brief The sampled points.
+   *
+   */
+  CloudMatrix points;
+
+  /**
+   * @brief Indices of the sampled points in the input.
+   *
+   */
+  std::vector<int> indices;
+
+  /**
+   * @brief The chosen voxel size, which is zero if all points are kept.
+   *
+   */
+  double voxel_size;
+
+  /**
+   * @brief Indices of finite input points.
+   *
+   */
+  std::vector<int> valid_indices;
+
+  /**
+   * @brief Keys of the slots of the hash table, where empty slots have the
+   * maximum value.
+   *
+   */
+  std::vector<uint64_t> slot_keys;
+
+  /**
+   * @brief The voxel of each non-empty slot of the hash table.
+   *
+   */
+  std::vector<int> slot_voxels;
+
+  /**
+   * @brief The representative point of each voxel of the latest evaluated
+   * voxel size, and of the chosen one so far.
+   *
+   */
+  std::vector<int> representatives, best_representatives;
+
+  /**
+   * @brief Collect the representative point of each occupied voxel of a voxel
+   * size into ``representatives``.
+   *
+   * @param cloud The input points.
+   * @param scores The scores of input points, or empty.
+   * @param origin The lower bound of coordinates of finite points.
+   * @param size The voxel size.
+   */
+  void collect_representatives(const CloudMatrix &cloud,
+                               const std::vector<float> &scores,
+                               const Eigen::Vector3d &origin,
+                               double size);
+
+ public:
+  /**
+   * @brief Construct a new VoxelSampler object.
+   *
+   * @param params Parameters for the voxel sampler.
+   *
+   * @throw std::invalid_argument if ``max_points`` is zero.
+   */
+  explicit BasicVoxelSampler(const Params &params = Params());
+
+  /**
+   * @brief Sample points, replacing the previous result. Non-finite points are
+   * never sampled.
+   *
+   * @param cloud The input points.
+   * @param scores The scores of input points, where higher scored points are
+   * preferred, or empty.
+   *
+   * @throw std::invalid_argument if the numbers of scores and points mismatch.
+   */
+  void sample(const CloudMatrix &cloud, const std::vector<float> &scores = std::vector<float>());
+
+  /**
+   * @brief Sample corner points of a multi-scale curvature, which are scored
+   * by their multi-scale curvatures.
+   *
+   * @param msc The multi-scale curvature.
+   */
+  void sample(const BasicMultiScaleCurvature<Scalar> &msc) {
+    this->sample(msc.get_corner_points(), msc.get_corner_point_curvatures());
+  }
+
+  /**
+   * @brief Get the parameters.
+   *
+   * @return const VoxelSamplerBase::Params&
+   */
+  const Params &get_params() const { return this->params; }
+
+  /**
+   * @brief Get the sampled points.
+   *
+   * @return const CloudMatrix&
+   */
+  const CloudMatrix &get_points() const { return this->points; }
+
+  /**
+   * @brief Get indices of the sampled points in the input, in ascending
+   * order.
+   *
+   * @return const std::vector<int>&
+   */
+  const std::vector<int> &get_indices() const { return this->indices; }
+
+  /**
+   * @brief Get the chosen voxel size, which is zero if all points are kept.
+   *
+   * @return double
+   */
+  double get_voxel_size() const { return this->voxel_size; }
+
+  /**
+   * @brief Get timings and counters of the latest sampling.
+   *
+   * @return const VoxelSamplerBase::Profile&
+   */
+  const Profile &get_profile() const { return this->profile; }
+};
+
+/**
+ * @brief The voxel sampler of points in double precision.
+ *
+ */
+using VoxelSampler = BasicVoxelSampler<double>;
+
+/**
+ * @brief The voxel sampler of points in single precision.
+ *
+ */
+using VoxelSamplerF = BasicVoxelSampler<float>;
+
+};  // namespace keypoint
+
+};  // namespace kcp
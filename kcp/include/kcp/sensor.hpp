@@ -0,0 +1,117 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "kcp/common.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+namespace kcp {
+
+/**
+ * @brief The beam layout of a spinning LiDAR, described by the elevation angle
+ * of each channel.
+ *
+ * @details Channels are sorted by their elevation angles in ascending order, so
+ * that the channel 0 is the lowest beam. The boundary between two adjacent
+ * channels is the middle of their elevation angles, and the tangent of all
+ * boundaries is pre-computed as a sorted lookup table. A point is binned into
+ * a channel by searching its slope ``z / sqrt(x^2 + y^2)`` in the table, which
+ * requires no trigonometric function.
+ *
+ */
+class SensorModel {
+ protected:
+  /**
+   * @brief Elevation angles of channels in degrees (sorted in ascending order).
+   * 
+   */
+  std::vector<float> elevations_deg;
+
+  /**
+   * @brief Tangents of the boundaries between adjacent channels (sorted in
+   * ascending order). Its size is the number of channels minus one.
+   *
+   */
+  std::vector<double> boundary_slopes;
+
+ public:
+  /**
+   * @brief Construct a new SensorModel object.
+   *
+   * @param elevations_deg Elevation angles of all channels in degrees. The
+   * order of angles is irrelevant.
+   *
+   * @throw std::invalid_argument if no angle is given or an angle is not in
+   * the open interval (-90, 90).
+   */
+  explicit SensorModel(std::vector<float> elevations_deg);
+
+  /**
+   * @brief Create a sensor model whose channels are uniformly distributed in
+   * the given vertical field of view (V-FOV).
+   *
+   * @param n_channels The number of channels.
+   * @param min_vfov_deg The minimum vertical field of view (V-FOV).
+   * @param max_vfov_deg The maximum vertical field of view (V-FOV).
+   * @return SensorModel
+   */
+  static SensorModel uniform(int n_channels, float min_vfov_deg, float max_vfov_deg);
+
+  /**
+   * @brief Load a sensor model from a text file, which lists elevation angles
+   * of all channels in degrees separated by whitespaces or newlines. Texts
+   * after ``#`` in a line are treated as comments.
+   *
+   * @param filename The path of the file.
+   * @return SensorModel
+   *
+   * @throw std::runtime_error if the file cannot be read or parsed.
+   */
+  static SensorModel from_file(const std::string &filename);
+
+  /**
+   * @brief Get the number of channels.
+   * 
+   * @return int 
+   */
+  int get_n_channels() const { return static_cast<int>(this->elevations_deg.size()); }
+
+  /**
+   * @brief Get the elevation angles of channels in degrees.
+   * 
+   * @return const std::vector<float>& 
+   */
+  const std::vector<float> &get_elevations_deg() const { return this->elevations_deg; }
+
+  /**
+   * @brief Get the tangents of the boundaries between adjacent channels.
+   * 
+   * @return const std::vector<double>& 
+   */
+  const std::vector<double> &get_boundary_slopes() const { return this->boundary_slopes; }
+
+  /**
+   * @brief Get the channel index of a point.
+   *
+   * @param z The z coordinate of the point.
+   * @param xy_norm The horizontal distance ``sqrt(x^2 + y^2)`` of the point.
+   * @return int
+   */
+  int get_channel(double z, double xy_norm) const {
+    double slope;
+    if (xy_norm > 0) {
+      slope = z / xy_norm;
+    } else {
+      slope = (z > 0) ? std::numeric_limits<double>::infinity() : ((z < 0) ? -std::numeric_limits<double>::infinity() : 0);
+    }
+    return static_cast<int>(std::upper_bound(this->boundary_slopes.begin(), this->boundary_slopes.end(), slope) -
+                            this->boundary_slopes.begin());
+  }
+};
+
+};  // namespace kcp
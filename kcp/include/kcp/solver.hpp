@@ -4,12 +4,32 @@
 
 #pragma once
 
+#include "kcp/clique.hpp"
 #include "kcp/common.hpp"
+#include "kcp/parallel.hpp"
+#include "kcp/profiling.hpp"
+#include "kcp/target.hpp"
 
 #include <teaser/registration.h>
 
+#include <memory>
+#include <vector>
+
 namespace kcp {
 
+/**
+ * @brief Route ``std::cout`` through a filter dropping messages of threads in
+ * a non-verbose solve (see ``KCP::Params::verbose``), e.g., diagnostics of
+ * TEASER++. It is called by the constructor of a non-verbose KCP solver.
+ *
+ * @details The filter is installed once by the first call, and later calls
+ * have no effect. It forwards output to the buffer of ``std::cout`` at that
+ * time, so an application replacing the buffer of ``std::cout`` should do so
+ * before, or call it explicitly at startup after doing so.
+ *
+ */
+void install_output_filter();
+
 /**
  * @brief Abstract class for point cloud registration solvers.
  * 
@@ -60,6 +80,10 @@ class AbstractSolver {
  * point in the beginning, and outlier correspondences are mainly rejected by
  * the maximum clique pruning method (provided by TEASER++).
  *
+ * A KCP object is not thread-safe, but distinct objects share no mutable
+ * state, so they can solve concurrently in different threads (e.g., one solver
+ * per thread, as done by ``BatchKCP``).
+ *
  * @see Yu-Kai Lin, Wen-Chieh Lin, Chieh-Chih Wang, **KCP: k-Closest Points and
  * Maximum Clique Pruning for Efficient and Effective 3D Laser Scan Matching**.
  * To appear in _IEEE Robotics and Automation Letters (RA-L)_, 2022.
@@ -73,6 +97,28 @@ class KCP : public AbstractSolver {
    */
   using TEASER = teaser::RobustRegistrationSolver;
 
+  /**
+   * @brief Enum class of backends of the maximum clique pruning.
+   *
+   */
+  enum class MaxCliqueBackend {
+    /**
+     * @brief The pairwise consistency graph and the maximum clique solver of
+     * TEASER++.
+     *
+     */
+    TEASER,
+
+    /**
+     * @brief ``ConsistencyGraph`` and ``find_max_clique``, which exploit that
+     * the k closest points of a source point are mutually exclusive. Only the
+     * inliers of the clique are handed to TEASER++ for the rotation and
+     * translation estimation.
+     *
+     */
+    BUILTIN
+  };
+
   /**
    * @brief Type of parameters for the KCP-TEASER solver.
    * 
@@ -96,11 +142,99 @@ class KCP : public AbstractSolver {
     /**
      * @brief Enabling debug messages. Default by ``false``.
      *
-     * @warning It will mute all messages in TEASER++ if it is set to ``false``.
+     * @details If it is set to ``false``, messages written to ``std::cout`` by
+     * the calling thread during the TEASER++ solve are dropped. Other threads
+     * and the state of ``std::cout`` are not affected. The output filter
+     * doing so is installed by the first non-verbose KCP solver (see
+     * install_output_filter()).
      *
      */
     bool verbose;
 
+    /**
+     * @brief Searching k closest points with single precision features.
+     * Default by ``false``.
+     *
+     */
+    bool single_precision_features;
+
+    /**
+     * @brief The number of threads searching k closest points (and the
+     * built-in maximum clique pruning) in parallel, where 0 (or a negative
+     * value) means the number of hardware threads. It is ignored if
+     * ``executor`` is given. Default by 1.
+     *
+     */
+    int n_threads;
+
+    /**
+     * @brief An external executor searching k closest points in parallel.
+     * Default by ``nullptr``.
+     *
+     */
+    std::shared_ptr<Executor> executor;
+
+    /**
+     * @brief The budget of correspondences passed to the maximum clique
+     * pruning, where 0 means no budget. If there are more correspondences, k
+     * is lowered until they fit, and if one correspondence per source point
+     * still exceeds the budget, only the source points whose closest features
+     * are the nearest are kept. Default by 0.
+     *
+     */
+    size_t max_correspondences;
+
+    /**
+     * @brief The limit of the density of the pairwise consistency graph
+     * (estimated by sampling) to use the exact maximum clique solver. A denser
+     * graph falls back to the heuristic solver for that solve. Values not less
+     * than 1 disable the fallback. Default by 1.
+     *
+     */
+    double max_clique_density;
+
+    /**
+     * @brief The backend of the maximum clique pruning, which is used if
+     * ``teaser.use_max_clique`` is set. The built-in backend honors
+     * ``teaser.max_clique_exact_solution``, ``teaser.max_clique_time_limit``
+     * and the density fallback. Default by ``TEASER``.
+     *
+     */
+    KCP::MaxCliqueBackend max_clique_backend;
+
+    /**
+     * @brief Whether the built-in backend never connects correspondences of
+     * the same source point, which bounds cliques by the number of source
+     * points. If it is set to ``false``, the built-in backend builds the same
+     * graph as TEASER++, so both find maximum cliques of the same size.
+     * Default by ``true``.
+     *
+     */
+    bool exclude_same_source;
+
+    /**
+     * @brief The maximum number of point-to-plane refinement iterations after
+     * the maximum clique pruning, where 0 disables the refinement. The
+     * refinement requires plane points. Default by 0.
+     *
+     */
+    int refinement_iterations;
+
+    /**
+     * @brief The maximum distance between a transformed source plane point
+     * and its closest target plane point to be used in the refinement.
+     * Default by 1.
+     *
+     */
+    double refinement_max_distance;
+
+    /**
+     * @brief The number of target plane points used to estimate the normal of
+     * each target plane point. Default by 5.
+     *
+     */
+    size_t refinement_normal_neighbors;
+
     /**
      * @brief Construct a new KCP::Params object.
      * 
@@ -108,6 +242,16 @@ class KCP : public AbstractSolver {
     Params() {
       k                                    = 2;
       verbose                              = false;
+      single_precision_features            = false;
+      n_threads                            = 1;
+      executor                             = nullptr;
+      max_correspondences                  = 0;
+      max_clique_density                   = 1.0;
+      max_clique_backend                   = KCP::MaxCliqueBackend::TEASER;
+      exclude_same_source                  = true;
+      refinement_iterations                = 0;
+      refinement_max_distance              = 1.0;
+      refinement_normal_neighbors          = 5;
       teaser.noise_bound                   = 0.06;
       teaser.cbar2                         = 1;
       teaser.estimate_scaling              = false;
@@ -122,6 +266,190 @@ class KCP : public AbstractSolver {
     }
   };
 
+  /**
+   * @brief Type of the report of correspondence budgeting, which tells the
+   * policies taken by the latest solve.
+   *
+   */
+  struct BudgetReport {
+    /**
+     * @brief The number of correspondences before budgeting.
+     *
+     */
+    size_t n_candidates;
+
+    /**
+     * @brief The number of correspondences passed to the maximum clique
+     * pruning.
+     *
+     */
+    size_t n_correspondences;
+
+    /**
+     * @brief The number of closest points of each source point after
+     * budgeting.
+     *
+     */
+    size_t k;
+
+    /**
+     * @brief Whether k is lowered to fit the budget.
+     *
+     */
+    bool reduced_k;
+
+    /**
+     * @brief Whether source points are subsampled to fit the budget. The
+     * source points with the smallest feature distances to their closest target
+     * points are kept, which are the source indices of the initial
+     * correspondences (``get_initial_correspondences().indices.first``).
+     *
+     */
+    bool subsampled;
+
+    /**
+     * @brief The estimated density of the pairwise consistency graph, or -1 if
+     * it is not estimated.
+     *
+     */
+    double estimated_density;
+
+    /**
+     * @brief Whether the heuristic maximum clique solver is used instead of the
+     * exact one.
+     *
+     */
+    bool heuristic_clique;
+
+    /**
+     * @brief Construct a new KCP::BudgetReport object.
+     *
+     */
+    BudgetReport()
+        : n_candidates(0),
+          n_correspondences(0),
+          k(0),
+          reduced_k(false),
+          subsampled(false),
+          estimated_density(-1),
+          heuristic_clique(false) {}
+  };
+
+  /**
+   * @brief Type of per-stage timings (in seconds) and counters of the latest
+   * solve. Timings are zero unless KCP is built with ``KCP_ENABLE_PROFILING``.
+   *
+   */
+  struct Profile {
+    /**
+     * @brief The number of source points.
+     *
+     */
+    size_t n_src_points;
+
+    /**
+     * @brief The number of target points.
+     *
+     */
+    size_t n_dst_points;
+
+    /**
+     * @brief The number of initial correspondences.
+     *
+     */
+    size_t n_correspondences;
+
+    /**
+     * @brief The size of the maximum clique.
+     *
+     */
+    size_t n_inliers;
+
+    /**
+     * @brief The number of refinement iterations.
+     *
+     */
+    int n_refinement_iterations;
+
+    /**
+     * @brief The time of building the target kd-tree, which is zero if the
+     * cached tree is reused.
+     *
+     */
+    double index_time;
+
+    /**
+     * @brief The time of the k closest points search, including budgeting and
+     * the density estimation.
+     *
+     */
+    double correspondence_time;
+
+    /**
+     * @brief The time of the TEASER++ solver, including the maximum clique
+     * pruning and the rotation and translation estimation.
+     *
+     */
+    double registration_time;
+
+    /**
+     * @brief The time of building the pairwise consistency graph and
+     * searching the maximum clique by the built-in backend, which is included
+     * in ``registration_time``. It is zero with the TEASER++ backend.
+     *
+     */
+    double clique_time;
+
+    /**
+     * @brief The time of the point-to-plane refinement, including building
+     * the kd-tree and the normals of target plane points.
+     *
+     */
+    double refinement_time;
+
+    /**
+     * @brief Construct a new KCP::Profile object.
+     *
+     */
+    Profile()
+        : n_src_points(0),
+          n_dst_points(0),
+          n_correspondences(0),
+          n_inliers(0),
+          n_refinement_iterations(0),
+          index_time(0),
+          correspondence_time(0),
+          registration_time(0),
+          clique_time(0),
+          refinement_time(0) {}
+  };
+
+  /**
+   * @brief Type of counters of target index reuse.
+   *
+   */
+  struct CacheCounters {
+    /**
+     * @brief The number of solves (with a target point cloud) reusing an
+     * existing target index.
+     *
+     */
+    size_t hits;
+
+    /**
+     * @brief The number of solves (with a target point cloud) building a new
+     * target index.
+     *
+     */
+    size_t misses;
+
+    /**
+     * @brief Construct a new KCP::CacheCounters object.
+     *
+     */
+    CacheCounters() : hits(0), misses(0) {}
+  };
+
  protected:
   /**
    * @brief The TEASER++ solver.
@@ -136,11 +464,25 @@ class KCP : public AbstractSolver {
   KCP::Params params;
 
   /**
-   * @brief The initial set of k-closest-points correspondences.
+   * @brief The initial set of k-closest-points correspondences. It is
+   * generated in place by each solve and handed to TEASER++ by reference.
    * 
    */
   Correspondences initial_correspondences;
 
+  /**
+   * @brief Buffer of squared feature distances of the closest points of source
+   * points, which rank source points exceeding the budget.
+   *
+   */
+  std::vector<double> candidate_distances;
+
+  /**
+   * @brief Buffer of source points ordered by ``candidate_distances``.
+   *
+   */
+  std::vector<int> candidate_order;
+
   /**
    * @brief The inlier correspondence indices with respect to
    * ``initial_correspondences``. The set is estimated by the maximum clique
@@ -149,13 +491,127 @@ class KCP : public AbstractSolver {
    */
   std::vector<int> inlier_correspondence_indices;
 
+  /**
+   * @brief The thread pool owned by the solver, which is created on demand if
+   * no external executor is given.
+   *
+   */
+  std::shared_ptr<ThreadPool> thread_pool;
+
+  /**
+   * @brief The index of the most recent target, which is reused if the next
+   * target is identical.
+   *
+   */
+  std::shared_ptr<const TargetIndex> target_index;
+
+  /**
+   * @brief Counters of target index reuse.
+   *
+   */
+  KCP::CacheCounters target_index_counters;
+
+  /**
+   * @brief The index of target plane points for the refinement, which is
+   * reused if the next target plane points are identical.
+   *
+   */
+  std::shared_ptr<const TargetIndex> plane_index;
+
+  /**
+   * @brief Normals of target plane points, where rows of non-planar points
+   * are zero.
+   *
+   */
+  Eigen::MatrixX3d plane_normals;
+
+  /**
+   * @brief Buffer of source plane points transformed by the current estimate.
+   *
+   */
+  Eigen::MatrixX3d transformed_plane_points;
+
+  /**
+   * @brief Buffer of closest point pairs of the refinement.
+   *
+   */
+  Correspondences plane_correspondences;
+
+  /**
+   * @brief The report of correspondence budgeting of the latest solve.
+   *
+   */
+  KCP::BudgetReport budget_report;
+
+  /**
+   * @brief Timings and counters of the latest solve.
+   *
+   */
+  KCP::Profile profile;
+
+  /**
+   * @brief The pairwise consistency graph of the built-in maximum clique
+   * pruning.
+   *
+   */
+  ConsistencyGraph consistency_graph;
+
+  /**
+   * @brief Buffer of inlier correspondences handed to TEASER++ by the
+   * built-in maximum clique pruning.
+   *
+   */
+  Correspondences inlier_correspondences;
+
+  /**
+   * @brief Whether the TEASER++ solver is currently configured with the
+   * heuristic maximum clique solver by the density fallback.
+   *
+   */
+  bool heuristic_clique_active;
+
+  /**
+   * @brief Whether the TEASER++ solver is currently configured without its
+   * maximum clique solver for the built-in backend.
+   *
+   */
+  bool builtin_clique_active;
+
+  /**
+   * @brief Get the executor for parallel stages.
+   *
+   * @return The executor, or ``nullptr`` for running in the calling thread.
+   */
+  Executor* get_executor();
+
+  /**
+   * @brief Generate ``initial_correspondences`` within the budget, and
+   * estimate the density of their pairwise consistency graph.
+   *
+   * @tparam Scalar The scalar type of the source cloud.
+   * @param src The source point cloud.
+   * @param src_feature The source feature cloud.
+   * @param dst The target.
+   */
+  template <typename Scalar>
+  void find_correspondences(const Eigen::Matrix<Scalar, Eigen::Dynamic, 3>& src,
+                            const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>& src_feature,
+                            const Target& dst);
+
+  /**
+   * @brief Estimate the transformation from ``initial_correspondences``.
+   *
+   */
+  void solve_initial_correspondences();
+
  public:
   /**
-   * @brief Construct a new KCP object.
+   * @brief Construct a new KCP object. The first non-verbose one installs the
+   * output filter (see install_output_filter()).
    * 
    * @param params KCP-TEASER parameters.
    */
-  KCP(KCP::Params params) : params(params), solver(params.teaser) {}
+  KCP(KCP::Params params);
 
   /**
    * @brief Get the parameters.
@@ -178,9 +634,48 @@ class KCP : public AbstractSolver {
    */
   const std::vector<int>& get_inlier_correspondence_indices() const { return this->inlier_correspondence_indices; }
 
+  /**
+   * @brief Get the report of correspondence budgeting of the latest solve.
+   *
+   * @return const KCP::BudgetReport&
+   */
+  const KCP::BudgetReport& get_budget_report() const { return this->budget_report; }
+
+  /**
+   * @brief Get timings and counters of the latest solve (and refinement).
+   *
+   * @return const KCP::Profile&
+   */
+  const KCP::Profile& get_profile() const { return this->profile; }
+
+  /**
+   * @brief Get the index of the most recent target built by the solver.
+   *
+   * @return std::shared_ptr<const TargetIndex> The index, or ``nullptr`` if
+   * no index has been built.
+   */
+  std::shared_ptr<const TargetIndex> get_target_index() const { return this->target_index; }
+
+  /**
+   * @brief Get the counters of target index reuse.
+   *
+   * @return const KCP::CacheCounters&
+   */
+  const KCP::CacheCounters& get_target_index_counters() const { return this->target_index_counters; }
+
+  /**
+   * @brief Reset the counters of target index reuse.
+   *
+   */
+  void reset_target_index_counters() { this->target_index_counters = KCP::CacheCounters(); }
+
   /**
    * @brief The main function to trigger the KCP-TEASER registration approach.
-   * 
+   *
+   * @details The kd-tree of the target is cached. If the target is identical
+   * to the previous one (compared by contents), the tree is reused instead of
+   * rebuilt.
+   *
    * @param src The source point cloud.
    * @param dst The target point cloud.
    * @param src_feature The source feature cloud.
@@ -190,6 +685,293 @@ class KCP : public AbstractSolver {
                      const Eigen::MatrixX3d& dst,
                      const Eigen::MatrixXd& src_feature,
                      const Eigen::MatrixXd& dst_feature) override;
+
+  /**
+   * @brief Trigger the KCP-TEASER registration approach, followed by the
+   * point-to-plane refinement with plane points (e.g., from
+   * ``MultiScaleCurvature::get_plane_points``).
+   *
+   * @param src The source point cloud.
+   * @param dst The target point cloud.
+   * @param src_feature The source feature cloud.
+   * @param dst_feature The target feature cloud.
+   * @param src_plane_points Plane points of the source.
+   * @param dst_plane_points Plane points of the target.
+   */
+  void solve(const Eigen::MatrixX3d& src,
+             const Eigen::MatrixX3d& dst,
+             const Eigen::MatrixXd& src_feature,
+             const Eigen::MatrixXd& dst_feature,
+             const Eigen::MatrixX3d& src_plane_points,
+             const Eigen::MatrixX3d& dst_plane_points);
+
+  /**
+   * @brief Refine the solution of the latest solve by minimizing
+   * point-to-plane distances of plane points and point-to-point distances of
+   * the inlier correspondences of the maximum clique, which is done by at most
+   * ``refinement_iterations`` Gauss-Newton iterations.
+   *
+   * @details The kd-tree and the normals of target plane points are kept and
+   * reused if the next target plane points are identical.
+   *
+   * @param src_plane_points Plane points of the source.
+   * @param dst_plane_points Plane points of the target.
+   * @return int The number of performed iterations.
+   */
+  int refine(const Eigen::MatrixX3d& src_plane_points, const Eigen::MatrixX3d& dst_plane_points);
+
+  /**
+   * @brief Trigger the KCP-TEASER registration approach against a prebuilt
+   * target (e.g., a ``TargetIndex`` or a ``LocalMap``). The target is not
+   * looked up in the cache, so the cache counters are left untouched.
+   *
+   * @param src The source point cloud.
+   * @param src_feature The source feature cloud.
+   * @param dst The target.
+   */
+  void solve(const Eigen::MatrixX3d& src, const Eigen::MatrixXd& src_feature, const Target& dst);
+
+  /**
+   * @brief Trigger the KCP-TEASER registration approach with single precision
+   * clouds (e.g., keypoints of ``MultiScaleCurvatureF``). The kd-tree is built
+   * and searched in single precision regardless of
+   * ``single_precision_features``, and only the correspondences handed to
+   * TEASER++ are in double precision. The kd-tree is cached as in the double
+   * precision solve.
+   *
+   * @param src The source point cloud.
+   * @param dst The target point cloud.
+   * @param src_feature The source feature cloud.
+   * @param dst_feature The target feature cloud.
+   */
+  void solve(const Eigen::MatrixX3f& src,
+             const Eigen::MatrixX3f& dst,
+             const Eigen::MatrixXf& src_feature,
+             const Eigen::MatrixXf& dst_feature);
+
+  /**
+   * @brief Trigger the KCP-TEASER registration approach with a single
+   * precision source cloud against a prebuilt target. The target is not
+   * looked up in the cache, so the cache counters are left untouched.
+   *
+   * @param src The source point cloud.
+   * @param src_feature The source feature cloud.
+   * @param dst The target.
+   */
+  void solve(const Eigen::MatrixX3f& src, const Eigen::MatrixXf& src_feature, const Target& dst);
+};
+
+/**
+ * @brief A helper of sequential (odometry) registration, where each frame is
+ * registered to the previous one.
+ *
+ * @details The target index of a frame is built once when the frame is pushed,
+ * and kept alive until the next frame is registered against it, so no
+ * kd-tree is built twice.
+ *
+ */
+class SequentialKCP {
+ protected:
+  /**
+   * @brief The KCP-TEASER solver.
+   *
+   */
+  KCP solver;
+
+  /**
+   * @brief The index of the previous frame.
+   *
+   */
+  std::shared_ptr<const TargetIndex> previous_index;
+
+  /**
+   * @brief The pose of the latest frame with respect to the first frame.
+   *
+   */
+  Eigen::Matrix4d pose;
+
+ public:
+  /**
+   * @brief Construct a new SequentialKCP object.
+   *
+   * @param params KCP-TEASER parameters.
+   */
+  SequentialKCP(KCP::Params params) : solver(params), pose(Eigen::Matrix4d::Identity()) {}
+
+  /**
+   * @brief Push a new frame, which is registered to the previous frame.
+   *
+   * @param points The point cloud of the frame.
+   * @param features The feature cloud of the frame.
+   * @return bool ``false`` if it is the first frame (nothing is registered),
+   * and ``true`` otherwise.
+   */
+  bool push(Eigen::MatrixX3d points, const Eigen::MatrixXd& features);
+
+  /**
+   * @brief Forget the previous frame and the pose. The next pushed frame will
+   * be the first frame.
+   *
+   */
+  void reset();
+
+  /**
+   * @brief Get the underlying solver.
+   *
+   * @return KCP&
+   */
+  KCP& get_solver() { return this->solver; }
+
+  /**
+   * @brief Get the transformation from the latest frame to the previous frame.
+   *
+   * @return const Eigen::Matrix4d&
+   */
+  const Eigen::Matrix4d& get_solution() const { return this->solver.get_solution(); }
+
+  /**
+   * @brief Get the pose of the latest frame with respect to the first frame.
+   *
+   * @return const Eigen::Matrix4d&
+   */
+  const Eigen::Matrix4d& get_pose() const { return this->pose; }
+};
+
+/**
+ * @brief A batch solver registering many independent pairs of point clouds
+ * (e.g., loop closure candidates) in parallel.
+ *
+ * @details Jobs are distributed over the executor given by ``executor`` (or a
+ * pool of ``n_threads`` workers owned by the batch solver), where each worker
+ * claims the next unfinished job, so long and short jobs are balanced
+ * dynamically. Each worker keeps its own ``KCP`` solver, which is reused
+ * across jobs and batches, so the TEASER++ state is not rebuilt per pair.
+ * Solvers of workers run single-threaded.
+ *
+ * The jobs vector must not be modified during ``solve``, and a BatchKCP object
+ * must not run two batches concurrently.
+ *
+ */
+class BatchKCP {
+ public:
+  /**
+   * @brief Type of a registration job.
+   *
+   */
+  struct Job {
+    /**
+     * @brief The source point cloud.
+     *
+     */
+    Eigen::MatrixX3d src;
+
+    /**
+     * @brief The target point cloud.
+     *
+     */
+    Eigen::MatrixX3d dst;
+
+    /**
+     * @brief The source feature cloud.
+     *
+     */
+    Eigen::MatrixXd src_feature;
+
+    /**
+     * @brief The target feature cloud.
+     *
+     */
+    Eigen::MatrixXd dst_feature;
+  };
+
+  /**
+   * @brief Type of the result of a job.
+   *
+   */
+  struct Result {
+    /**
+     * @brief The transformation from the source to the target.
+     *
+     */
+    Eigen::Matrix4d solution;
+
+    /**
+     * @brief The number of initial correspondences.
+     *
+     */
+    size_t n_correspondences;
+
+    /**
+     * @brief The number of inlier correspondences of the maximum clique.
+     *
+     */
+    size_t n_inliers;
+
+    /**
+     * @brief The wall time of the job in seconds.
+     *
+     */
+    double time;
+
+    /**
+     * @brief Per-stage timings and counters of the job.
+     *
+     */
+    KCP::Profile profile;
+  };
+
+ protected:
+  /**
+   * @brief KCP-TEASER parameters of the batch.
+   *
+   */
+  KCP::Params params;
+
+  /**
+   * @brief The thread pool owned by the batch solver, which is created unless
+   * an external executor is given.
+   *
+   */
+  std::shared_ptr<Executor> thread_pool;
+
+  /**
+   * @brief Solvers indexed by workers, which are created on demand.
+   *
+   */
+  std::vector<std::unique_ptr<KCP>> solvers;
+
+ public:
+  /**
+   * @brief Construct a new BatchKCP object.
+   *
+   * @param params KCP-TEASER parameters, where ``n_threads`` and ``executor``
+   * control the parallelism across jobs.
+   */
+  BatchKCP(KCP::Params params);
+
+  /**
+   * @brief Get the parameters.
+   *
+   * @return const KCP::Params&
+   */
+  const KCP::Params& get_params() const { return this->params; }
+
+  /**
+   * @brief Get the number of workers solving jobs concurrently.
+   *
+   * @return size_t
+   */
+  size_t get_n_workers() const;
+
+  /**
+   * @brief Register all jobs and block until all of them are finished.
+   *
+   * @param jobs The jobs.
+   * @return std::vector<BatchKCP::Result> Results in the order of jobs.
+   *
+   * @throw The first exception thrown by jobs.
+   */
+  std::vector<BatchKCP::Result> solve(const std::vector<BatchKCP::Job>& jobs);
 };
 
 };  // namespace kcp
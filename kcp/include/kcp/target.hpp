@@ -0,0 +1,332 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "kcp/common.hpp"
+#include "kcp/parallel.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace kcp {
+
+/**
+ * @brief Interface of targets answering k-closest-points queries, e.g., a
+ * prebuilt kd-tree or a local map.
+ *
+ */
+class Target {
+ public:
+  virtual ~Target() = default;
+
+  /**
+   * @brief Get the number of target points.
+   *
+   * @return size_t
+   */
+  virtual size_t get_size() const = 0;
+
+  /**
+   * @brief Get the dimension of features.
+   *
+   * @return int
+   */
+  virtual int get_feature_dim() const = 0;
+
+  /**
+   * @brief Get a target point.
+   *
+   * @param index The index of the point in ``[0, get_size())``.
+   * @return Eigen::Vector3d
+   */
+  virtual Eigen::Vector3d get_point(size_t index) const = 0;
+
+  /**
+   * @brief Query k closest points of each source point, where the i-th
+   * closest point of the source point ``s`` is written into the column (and
+   * the index) ``s * k + i`` of the preallocated correspondences.
+   *
+   * @param src The source point cloud.
+   * @param src_feature The source feature cloud used to compute distances.
+   * @param k The number of closest points, which must be less than the size
+   * of the target.
+   * @param correspondences The output set of correspondences, whose size must
+   * be ``src.rows() * k``.
+   * @param executor The executor running queries in parallel, or ``nullptr``
+   * to run them in the calling thread.
+   */
+  virtual void search(const Eigen::MatrixX3d& src,
+                      const Eigen::MatrixXd& src_feature,
+                      size_t k,
+                      Correspondences& correspondences,
+                      Executor* executor = nullptr) const = 0;
+
+  /**
+   * @brief Query k closest points of each source point given in single
+   * precision. The layout of the output is the same as the double precision
+   * query, and correspondences are stored in double precision.
+   *
+   * @details The default implementation converts the source to double
+   * precision. Targets searching in single precision natively override it.
+   *
+   * @param src The source point cloud.
+   * @param src_feature The source feature cloud used to compute distances.
+   * @param k The number of closest points, which must be less than the size
+   * of the target.
+   * @param correspondences The output set of correspondences, whose size must
+   * be ``src.rows() * k``.
+   * @param executor The executor running queries in parallel, or ``nullptr``
+   * to run them in the calling thread.
+   */
+  virtual void search(const Eigen::MatrixX3f& src,
+                      const Eigen::MatrixXf& src_feature,
+                      size_t k,
+                      Correspondences& correspondences,
+                      Executor* executor = nullptr) const;
+
+  /**
+   * @brief Query k closest points of each source point, and report the squared
+   * feature distance of each correspondence, e.g., for ranking source points.
+   *
+   * @details The default implementation reports zero distances, i.e., no
+   * preference among correspondences. Targets computing distances override
+   * it.
+   *
+   * @param src The source point cloud.
+   * @param src_feature The source feature cloud used to compute distances.
+   * @param k The number of closest points, which must be less than the size
+   * of the target.
+   * @param correspondences The output set of correspondences, whose size must
+   * be ``src.rows() * k``.
+   * @param squared_distances The output squared feature distances aligned with
+   * the correspondences, which is resized to ``src.rows() * k``.
+   * @param executor The executor running queries in parallel, or ``nullptr``
+   * to run them in the calling thread.
+   */
+  virtual void search(const Eigen::MatrixX3d& src,
+                      const Eigen::MatrixXd& src_feature,
+                      size_t k,
+                      Correspondences& correspondences,
+                      std::vector<double>& squared_distances,
+                      Executor* executor = nullptr) const;
+
+  /**
+   * @brief Query k closest points of each source point given in single
+   * precision, and report the squared feature distance of each
+   * correspondence.
+   *
+   * @details The default implementation converts the source to double
+   * precision.
+   *
+   * @param src The source point cloud.
+   * @param src_feature The source feature cloud used to compute distances.
+   * @param k The number of closest points, which must be less than the size
+   * of the target.
+   * @param correspondences The output set of correspondences, whose size must
+   * be ``src.rows() * k``.
+   * @param squared_distances The output squared feature distances aligned with
+   * the correspondences, which is resized to ``src.rows() * k``.
+   * @param executor The executor running queries in parallel, or ``nullptr``
+   * to run them in the calling thread.
+   */
+  virtual void search(const Eigen::MatrixX3f& src,
+                      const Eigen::MatrixXf& src_feature,
+                      size_t k,
+                      Correspondences& correspondences,
+                      std::vector<double>& squared_distances,
+                      Executor* executor = nullptr) const;
+};
+
+/**
+ * @brief A target point cloud with a prebuilt kd-tree of its features.
+ *
+ * @details Building the kd-tree is the most expensive part of finding k
+ * closest points. An index built once can be reused by all registrations
+ * against the same target, e.g., the previous frame in odometry or a submap in
+ * relocalization. The index keeps copies of the points and the features, so
+ * it stays valid after the caller's matrices are gone. It is immutable, and
+ * can be shared by multiple threads.
+ *
+ */
+class TargetIndex : public Target {
+ public:
+  /**
+   * @brief Implementation holding the features and the kd-tree.
+   *
+   */
+  struct Impl;
+
+  /**
+   * @brief Type of a view of contiguous row-major source features in double
+   * precision, e.g., a NumPy array or the buffer of a descriptor network.
+   *
+   */
+  using FeatureView = Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>;
+
+  /**
+   * @brief Type of a view of contiguous row-major source features in single
+   * precision.
+   *
+   */
+  using FeatureViewF = Eigen::Map<const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>;
+
+ protected:
+  /**
+   * @brief The target point cloud.
+   *
+   */
+  Eigen::MatrixX3d points;
+
+  /**
+   * @brief The features and the kd-tree.
+   *
+   */
+  std::unique_ptr<Impl> impl;
+
+ public:
+  /**
+   * @brief Construct a new TargetIndex object, where the kd-tree is built.
+   *
+   * @param points The target point cloud.
+   * @param features The target feature cloud used to compute distances.
+   * @param single_precision Whether to store and search features in single
+   * precision.
+   *
+   * @throw std::invalid_argument if the sizes of points and features mismatch.
+   */
+  TargetIndex(Eigen::MatrixX3d points, const Eigen::MatrixXd& features, bool single_precision = false);
+
+  /**
+   * @brief Construct a new TargetIndex object from single precision points and
+   * features, where the kd-tree is built in single precision without a double
+   * precision copy of the features.
+   *
+   * @param points The target point cloud.
+   * @param features The target feature cloud used to compute distances.
+   *
+   * @throw std::invalid_argument if the sizes of points and features mismatch.
+   */
+  TargetIndex(const Eigen::MatrixX3f& points, const Eigen::MatrixXf& features);
+
+  TargetIndex(TargetIndex&& other) noexcept;
+  TargetIndex& operator=(TargetIndex&& other) noexcept;
+
+  /**
+   * @brief Destroy the TargetIndex object.
+   *
+   */
+  ~TargetIndex() override;
+
+  /**
+   * @brief Get the target point cloud.
+   *
+   * @return const Eigen::MatrixX3d&
+   */
+  const Eigen::MatrixX3d& get_points() const { return this->points; }
+
+  size_t get_size() const override { return this->points.rows(); }
+
+  int get_feature_dim() const override;
+
+  Eigen::Vector3d get_point(size_t index) const override { return this->points.row(index).transpose(); }
+
+  /**
+   * @brief Whether features are stored and searched in single precision.
+   *
+   * @return bool
+   */
+  bool is_single_precision() const;
+
+  /**
+   * @brief Check if the index is built from the given target, so that it can
+   * be reused. It compares the contents, which is much cheaper than building a
+   * kd-tree.
+   *
+   * @param points The target point cloud.
+   * @param features The target feature cloud.
+   * @param single_precision Whether features are searched in single precision.
+   * @return bool
+   */
+  bool matches(const Eigen::MatrixX3d& points, const Eigen::MatrixXd& features, bool single_precision) const;
+
+  /**
+   * @brief Check if the index is built in single precision from the given
+   * single precision target.
+   *
+   * @param points The target point cloud.
+   * @param features The target feature cloud.
+   * @return bool
+   */
+  bool matches(const Eigen::MatrixX3f& points, const Eigen::MatrixXf& features) const;
+
+  void search(const Eigen::MatrixX3d& src,
+              const Eigen::MatrixXd& src_feature,
+              size_t k,
+              Correspondences& correspondences,
+              Executor* executor = nullptr) const override;
+
+  void search(const Eigen::MatrixX3f& src,
+              const Eigen::MatrixXf& src_feature,
+              size_t k,
+              Correspondences& correspondences,
+              Executor* executor = nullptr) const override;
+
+  void search(const Eigen::MatrixX3d& src,
+              const Eigen::MatrixXd& src_feature,
+              size_t k,
+              Correspondences& correspondences,
+              std::vector<double>& squared_distances,
+              Executor* executor = nullptr) const override;
+
+  void search(const Eigen::MatrixX3f& src,
+              const Eigen::MatrixXf& src_feature,
+              size_t k,
+              Correspondences& correspondences,
+              std::vector<double>& squared_distances,
+              Executor* executor = nullptr) const override;
+
+  /**
+   * @brief Query k closest points of each source point with row-major source
+   * features. Features in the precision of the index are queried in place
+   * without being copied. The layout of the output is the same as ``search``.
+   *
+   * @param src The source point cloud.
+   * @param src_feature The source feature cloud used to compute distances.
+   * @param k The number of closest points, which must be less than the size
+   * of the target.
+   * @param correspondences The output set of correspondences, whose size must
+   * be ``src.rows() * k``.
+   * @param executor The executor running queries in parallel, or ``nullptr``
+   * to run them in the calling thread.
+   */
+  void search(const Eigen::MatrixX3d& src,
+              const FeatureView& src_feature,
+              size_t k,
+              Correspondences& correspondences,
+              Executor* executor = nullptr) const;
+
+  /**
+   * @brief Query k closest points of each source point with row-major single
+   * precision source features.
+   *
+   * @see search(const Eigen::MatrixX3d&, const FeatureView&, size_t, Correspondences&, Executor*) const
+   *
+   * @param src The source point cloud.
+   * @param src_feature The source feature cloud used to compute distances.
+   * @param k The number of closest points, which must be less than the size
+   * of the target.
+   * @param correspondences The output set of correspondences, whose size must
+   * be ``src.rows() * k``.
+   * @param executor The executor running queries in parallel, or ``nullptr``
+   * to run them in the calling thread.
+   */
+  void search(const Eigen::MatrixX3f& src,
+              const FeatureViewF& src_feature,
+              size_t k,
+              Correspondences& correspondences,
+              Executor* executor = nullptr) const;
+};
+
+};  // namespace kcp
@@ -5,6 +5,8 @@
 #pragma once
 
 #include "kcp/common.hpp"
+#include "kcp/parallel.hpp"
+#include "kcp/target.hpp"
 
 #include <Eigen/Core>
 
@@ -49,4 +51,100 @@ get_kcp_correspondences(const Eigen::MatrixX3d& src,
                         const Eigen::MatrixXd& dst_feature,
                         size_t k);
 
+/**
+ * @brief Get the set of k-closest-points correspondences with kd-tree, which
+ * are written into the given set.
+ *
+ * @details The i-th closest point of the source point ``s`` is stored at the
+ * column (and the index) ``s * min(k, dst.rows()) + i``, so source points are
+ * split across workers of the executor and written into preallocated slots.
+ * Column-major features are gathered row by row into per-worker buffers (see
+ * ``TargetIndex::search`` for querying row-major features in place). The
+ * storage of ``correspondences`` is reused if it already has the required
+ * size.
+ *
+ * @param src The source point cloud.
+ * @param dst The target point cloud.
+ * @param src_feature The source feature cloud used to compute distances.
+ * @param dst_feature The target feature cloud used to compute distances.
+ * @param k The number of closest points for each source point.
+ * @param correspondences The output set of correspondences.
+ * @param single_precision Whether to search features in single precision. It
+ * is faster for high-dimensional features, while the order of neighbors with
+ * nearly identical distances may differ from the double precision search.
+ * @param executor The executor running queries in parallel, or ``nullptr`` to
+ * run them in the calling thread.
+ */
+void get_kcp_correspondences(const Eigen::MatrixX3d& src,
+                             const Eigen::MatrixX3d& dst,
+                             const Eigen::MatrixXd& src_feature,
+                             const Eigen::MatrixXd& dst_feature,
+                             size_t k,
+                             Correspondences& correspondences,
+                             bool single_precision = false,
+                             Executor* executor    = nullptr);
+
+/**
+ * @brief Get the set of k-closest-points correspondences against a target
+ * (e.g., a prebuilt index or a local map), which are written into the given
+ * set. The layout of the output is the same as the one built from target
+ * matrices.
+ *
+ * @param src The source point cloud.
+ * @param src_feature The source feature cloud used to compute distances.
+ * @param dst The target.
+ * @param k The number of closest points for each source point.
+ * @param correspondences The output set of correspondences.
+ * @param executor The executor running queries in parallel, or ``nullptr`` to
+ * run them in the calling thread.
+ */
+void get_kcp_correspondences(const Eigen::MatrixX3d& src,
+                             const Eigen::MatrixXd& src_feature,
+                             const Target& dst,
+                             size_t k,
+                             Correspondences& correspondences,
+                             Executor* executor = nullptr);
+
+/**
+ * @brief Get the set of k-closest-points correspondences of single precision
+ * clouds (e.g., keypoints of ``MultiScaleCurvatureF``), where the kd-tree is
+ * built and searched in single precision. Only the correspondences are stored
+ * in double precision, which is what TEASER++ takes.
+ *
+ * @param src The source point cloud.
+ * @param dst The target point cloud.
+ * @param src_feature The source feature cloud used to compute distances.
+ * @param dst_feature The target feature cloud used to compute distances.
+ * @param k The number of closest points for each source point.
+ * @param correspondences The output set of correspondences.
+ * @param executor The executor running queries in parallel, or ``nullptr`` to
+ * run them in the calling thread.
+ */
+void get_kcp_correspondences(const Eigen::MatrixX3f& src,
+                             const Eigen::MatrixX3f& dst,
+                             const Eigen::MatrixXf& src_feature,
+                             const Eigen::MatrixXf& dst_feature,
+                             size_t k,
+                             Correspondences& correspondences,
+                             Executor* executor = nullptr);
+
+/**
+ * @brief Get the set of k-closest-points correspondences of a single precision
+ * source cloud against a target.
+ *
+ * @param src The source point cloud.
+ * @param src_feature The source feature cloud used to compute distances.
+ * @param dst The target.
+ * @param k The number of closest points for each source point.
+ * @param correspondences The output set of correspondences.
+ * @param executor The executor running queries in parallel, or ``nullptr`` to
+ * run them in the calling thread.
+ */
+void get_kcp_correspondences(const Eigen::MatrixX3f& src,
+                             const Eigen::MatrixXf& src_feature,
+                             const Target& dst,
+                             size_t k,
+                             Correspondences& correspondences,
+                             Executor* executor = nullptr);
+
 };  // namespace kcp
@@ -0,0 +1,842 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "kcp/clique.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+
+namespace kcp {
+
+namespace {
+
+/**
+ * @brief The number of bits of a word of bitsets.
+ *
+ */
+constexpr size_t WORD_BITS = 64;
+
+/**
+ * @brief Time limits (in seconds) from which the exact search is not limited,
+ * which also keeps the deadline within the range of the clock.
+ *
+ */
+constexpr double MAX_TIME_LIMIT = 1e9;
+
+/**
+ * @brief The relative margin of the bounds of the squared distance test,
+ * which covers rounding errors, so undecided pairs are always settled by the
+ * exact test.
+ *
+ */
+constexpr double BOUND_MARGIN = 1e-6;
+
+/**
+ * @brief The number of branches of the clique search claimed by a task.
+ *
+ */
+constexpr size_t SEARCH_CHUNK_SIZE = 16;
+
+/**
+ * @brief Count set bits of a word.
+ *
+ */
+inline int count_bits(uint64_t word) {
+#ifdef __GNUC__
+  return __builtin_popcountll(word);
+#else
+  int count = 0;
+  for (; word != 0; word &= word - 1) ++count;
+  return count;
+#endif
+}
+
+/**
+ * @brief Get the index of the lowest set bit of a non-zero word.
+ *
+ */
+inline int lowest_bit(uint64_t word) {
+#ifdef __GNUC__
+  return __builtin_ctzll(word);
+#else
+  int index = 0;
+  for (; (word & 1) == 0; word >>= 1) ++index;
+  return index;
+#endif
+}
+
+/**
+ * @brief Count set bits of a bitset.
+ *
+ */
+size_t count_bits(const uint64_t *bits, size_t n_words) {
+  size_t count = 0;
+  for (size_t word = 0; word < n_words; ++word) count += count_bits(bits[word]);
+  return count;
+}
+
+/**
+ * @brief Transpose a 64x64 bit matrix in place, where bit ``j`` of word ``i``
+ * is entry ``(i, j)``.
+ *
+ */
+void transpose_bits(uint64_t *bits) {
+  uint64_t mask = 0x00000000FFFFFFFFull;
+  for (size_t width = WORD_BITS / 2; width != 0; width >>= 1, mask ^= mask << width) {
+    for (size_t k = 0; k < WORD_BITS; k = ((k | width) + 1) & ~width) {
+      const uint64_t swapped = ((bits[k] >> width) ^ bits[k | width]) & mask;
+      bits[k] ^= swapped << width;
+      bits[k | width] ^= swapped;
+    }
+  }
+}
+
+/**
+ * @brief Call a function with each set bit of a bitset in ascending order.
+ *
+ */
+template <typename Function>
+void for_each_bit(const uint64_t *bits, size_t n_words, Function function) {
+  for (size_t word = 0; word < n_words; ++word) {
+    for (uint64_t remaining = bits[word]; remaining != 0; remaining &= remaining - 1) {
+      function(word * WORD_BITS + lowest_bit(remaining));
+    }
+  }
+}
+
+/**
+ * @brief The best clique found so far, shared by all branches.
+ *
+ * @details A clique is ranked by its size and then by the rank of the branch
+ * finding it (smaller is better), which are packed into a key so that the
+ * bound of a branch is read by a single atomic load.
+ *
+ */
+class BestClique {
+ protected:
+  static constexpr uint64_t RANK_MASK = 0xFFFFFFFFull;
+
+  std::atomic<uint64_t> key;
+  std::mutex mutex;
+  std::vector<int> clique;
+
+  static uint64_t make_key(size_t size, size_t rank) {
+    return (static_cast<uint64_t>(size) << 32) | (RANK_MASK - static_cast<uint64_t>(rank));
+  }
+
+ public:
+  /**
+   * @brief Construct a new BestClique object with a lower bound of the size,
+   * which is reached by any branch.
+   *
+   */
+  explicit BestClique(size_t lower_bound) : key(static_cast<uint64_t>(lower_bound) << 32) {}
+
+  /**
+   * @brief Get the smallest size of a clique of the branch to be better than
+   * the best one.
+   *
+   */
+  size_t get_required_size(size_t rank) const {
+    const uint64_t key = this->key.load(std::memory_order_relaxed);
+    const size_t size  = static_cast<size_t>(key >> 32);
+    return RANK_MASK - static_cast<uint64_t>(rank) > (key & RANK_MASK) ? size : size + 1;
+  }
+
+  /**
+   * @brief Replace the best clique if the given one is better.
+   *
+   */
+  void offer(const std::vector<int> &clique, size_t rank) {
+    const uint64_t key = make_key(clique.size(), rank);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (key > this->key.load(std::memory_order_relaxed)) {
+      this->clique = clique;
+      this->key.store(key, std::memory_order_relaxed);
+    }
+  }
+
+  std::vector<int> &get_clique() { return this->clique; }
+};
+
+/**
+ * @brief The deadline of the exact search, shared by all branches. Once it is
+ * found to be reached, it stays reached without reading the clock again.
+ *
+ */
+class Deadline {
+ protected:
+  bool limited;
+  std::chrono::steady_clock::time_point time;
+  std::atomic<bool> reached;
+
+ public:
+  /**
+   * @brief Construct a new Deadline object from now, where a non-finite (or
+   * absurdly long) time limit never expires.
+   *
+   */
+  explicit Deadline(double time_limit) : limited(time_limit < MAX_TIME_LIMIT), reached(false) {
+    if (this->limited) {
+      this->time = std::chrono::steady_clock::now() +
+                   std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                       std::chrono::duration<double>(std::max(time_limit, 0.0)));
+    }
+  }
+
+  bool is_reached() {
+    if (!this->limited) return false;
+    if (this->reached.load(std::memory_order_relaxed)) return true;
+    if (std::chrono::steady_clock::now() < this->time) return false;
+    this->reached.store(true, std::memory_order_relaxed);
+    return true;
+  }
+};
+
+/**
+ * @brief The branch and bound search of cliques within the later neighbors of
+ * a vertex, where buffers are kept by each worker.
+ *
+ */
+class BranchSearch {
+ protected:
+  const ConsistencyGraph &graph;
+  BestClique &best;
+  Deadline &deadline;
+
+  /**
+   * @brief The rank of the current branch.
+   *
+   */
+  size_t rank;
+
+  /**
+   * @brief Vertices of the candidate subgraph.
+   *
+   */
+  std::vector<int> vertices;
+
+  /**
+   * @brief Buffer of vertices of the candidate subgraph being reordered.
+   *
+   */
+  std::vector<int> ordered_vertices;
+
+  /**
+   * @brief The bitset of vertices of the candidate subgraph over the graph.
+   *
+   */
+  std::vector<uint64_t> members;
+
+  /**
+   * @brief Indices of vertices of the graph in the candidate subgraph.
+   *
+   */
+  std::vector<int> local_indices;
+
+  /**
+   * @brief The number of words of bitsets over the candidate subgraph.
+   *
+   */
+  size_t n_words;
+
+  /**
+   * @brief The adjacency matrix of the candidate subgraph.
+   *
+   */
+  std::vector<uint64_t> adjacency;
+
+  /**
+   * @brief Degrees of candidates and the largest degrees of their source
+   * points among the candidates.
+   *
+   */
+  std::vector<int> degrees, group_degrees;
+
+  /**
+   * @brief Stack of candidates to be peeled.
+   *
+   */
+  std::vector<int> peeled;
+
+  /**
+   * @brief The order of vertices of the candidate subgraph.
+   *
+   */
+  std::vector<int> permutation;
+
+  /**
+   * @brief Bit ``a`` is set if vertices ``a - 1`` and ``a`` of the candidate
+   * subgraph share a source point.
+   *
+   */
+  std::vector<uint64_t> same_group;
+
+  /**
+   * @brief Candidate sets of each depth.
+   *
+   */
+  std::vector<std::vector<uint64_t>> candidates;
+
+  /**
+   * @brief Vertices of candidate sets of each depth in the order of colors.
+   *
+   */
+  std::vector<std::vector<int>> orders;
+
+  /**
+   * @brief Colors of ``orders``, which are non-decreasing.
+   *
+   */
+  std::vector<std::vector<int>> colors;
+
+  /**
+   * @brief Scratch bitsets of the coloring.
+   *
+   */
+  std::vector<uint64_t> uncolored, colorable;
+
+  /**
+   * @brief The current clique.
+   *
+   */
+  std::vector<int> clique;
+
+  /**
+   * @brief Get an upper bound of the size of cliques within a candidate set,
+   * which is the number of runs of vertices sharing a source point.
+   *
+   */
+  size_t count_groups(const uint64_t *bits) const {
+    size_t n_repeats = 0;
+    uint64_t carry   = 0;
+    for (size_t word = 0; word < this->n_words; ++word) {
+      const uint64_t previous = (bits[word] << 1) | carry;
+      carry                   = bits[word] >> (WORD_BITS - 1);
+      n_repeats += count_bits(bits[word] & previous & this->same_group[word]);
+    }
+    return count_bits(bits, this->n_words) - n_repeats;
+  }
+
+  /**
+   * @brief Greedily color a candidate set, where vertices of a color are
+   * pairwise non-adjacent.
+   *
+   * @return size_t The number of vertices.
+   */
+  size_t color(const uint64_t *bits, int *order, int *colors) {
+    std::copy(bits, bits + this->n_words, this->uncolored.begin());
+
+    size_t n_colored = 0;
+    int color        = 0;
+    while (count_bits(this->uncolored.data(), this->n_words) > 0) {
+      ++color;
+      this->colorable = this->uncolored;
+      for (size_t word = 0; word < this->n_words; ++word) {
+        while (this->colorable[word] != 0) {
+          const size_t vertex = word * WORD_BITS + lowest_bit(this->colorable[word]);
+          const uint64_t bit  = uint64_t(1) << (vertex % WORD_BITS);
+          this->uncolored[word] &= ~bit;
+          this->colorable[word] &= ~bit;
+
+          // Later words of the row are excluded as well
+          const uint64_t *row = this->adjacency.data() + vertex * this->n_words;
+          for (size_t other = word; other < this->n_words; ++other) this->colorable[other] &= ~row[other];
+
+          order[n_colored]  = static_cast<int>(vertex);
+          colors[n_colored] = color;
+          ++n_colored;
+        }
+      }
+    }
+    return n_colored;
+  }
+
+  /**
+   * @brief Extend the current clique by cliques of the candidate set of the
+   * depth.
+   *
+   */
+  void expand(size_t depth) {
+    if (this->candidates.size() <= depth + 1) {
+      this->candidates.resize(depth + 2, std::vector<uint64_t>(this->n_words));
+      this->orders.resize(depth + 2);
+      this->colors.resize(depth + 2);
+    }
+    for (size_t level = depth; level <= depth + 1; ++level) {
+      this->candidates[level].resize(this->n_words);
+    }
+    this->orders[depth].resize(this->vertices.size());
+    this->colors[depth].resize(this->vertices.size());
+
+    if (this->deadline.is_reached())
+      return;
+
+    uint64_t *bits   = this->candidates[depth].data();
+    const size_t size = this->clique.size();
+
+    // A clique takes at most one correspondence of each source point
+    if (size + this->count_groups(bits) < this->best.get_required_size(this->rank))
+      return;
+
+    int *order             = this->orders[depth].data();
+    int *colors            = this->colors[depth].data();
+    const size_t n_colored = this->color(bits, order, colors);
+
+    // Vertices of the largest color come first, and the search stops as soon
+    // as the colors cannot reach the required size
+    for (size_t idx = n_colored; idx-- > 0;) {
+      if (size + colors[idx] < this->best.get_required_size(this->rank))
+        return;
+
+      const int vertex    = order[idx];
+      const uint64_t *row = this->adjacency.data() + vertex * this->n_words;
+      uint64_t *next      = this->candidates[depth + 1].data();
+
+      bool empty = true;
+      for (size_t word = 0; word < this->n_words; ++word) {
+        next[word] = bits[word] & row[word];
+        empty      = empty && next[word] == 0;
+      }
+
+      this->clique.push_back(this->vertices[vertex]);
+      if (!empty) {
+        this->expand(depth + 1);
+      } else if (this->clique.size() >= this->best.get_required_size(this->rank)) {
+        this->best.offer(this->clique, this->rank);
+      }
+      this->clique.pop_back();
+
+      bits[vertex / WORD_BITS] &= ~(uint64_t(1) << (vertex % WORD_BITS));
+    }
+  }
+
+ public:
+  BranchSearch(const ConsistencyGraph &graph, BestClique &best, Deadline &deadline)
+      : graph(graph), best(best), deadline(deadline), rank(0), n_words(0) {}
+
+  /**
+   * @brief Search cliques containing a vertex and its later neighbors.
+   *
+   * @param root The vertex.
+   * @param positions Positions of vertices in the core ordering.
+   * @param core The core number of the vertex, which bounds the number of its
+   * later neighbors.
+   * @param rank The rank of the branch.
+   */
+  void search(int root, const std::vector<int> &positions, int core, size_t rank) {
+    this->rank = rank;
+    if (static_cast<size_t>(core) + 1 < this->best.get_required_size(rank))
+      return;
+
+    // Gather later neighbors, which are in ascending order as the rows
+    const std::vector<int> &groups = this->graph.get_groups();
+    const size_t n_graph_words     = this->graph.get_n_words();
+    this->vertices.clear();
+    this->members.assign(n_graph_words, 0);
+    this->local_indices.resize(this->graph.get_n_vertices());
+    for_each_bit(this->graph.get_row(root), n_graph_words, [&](size_t vertex) {
+      if (positions[vertex] > positions[root]) {
+        this->members[vertex / WORD_BITS] |= uint64_t(1) << (vertex % WORD_BITS);
+        this->local_indices[vertex] = static_cast<int>(this->vertices.size());
+        this->vertices.push_back(static_cast<int>(vertex));
+      }
+    });
+
+    if (this->vertices.size() + 1 < this->best.get_required_size(rank))
+      return;
+
+    // Peel candidates which cannot be in a clique of the required size with
+    // the root, i.e., those with less than ``required - 2`` neighbors among
+    // the candidates
+    const size_t required = this->best.get_required_size(rank);
+    this->degrees.resize(this->vertices.size());
+    this->peeled.clear();
+    for (size_t a = 0; a < this->vertices.size(); ++a) {
+      const uint64_t *graph_row = this->graph.get_row(this->vertices[a]);
+      size_t degree             = 0;
+      for (size_t word = 0; word < n_graph_words; ++word) degree += count_bits(graph_row[word] & this->members[word]);
+      this->degrees[a] = static_cast<int>(degree);
+      if (degree + 2 < required) this->peeled.push_back(static_cast<int>(a));
+    }
+    for (const int a : this->peeled) {
+      this->members[this->vertices[a] / WORD_BITS] &= ~(uint64_t(1) << (this->vertices[a] % WORD_BITS));
+    }
+    while (!this->peeled.empty()) {
+      const int a = this->peeled.back();
+      this->peeled.pop_back();
+      const uint64_t *graph_row = this->graph.get_row(this->vertices[a]);
+      for (size_t word = 0; word < n_graph_words; ++word) {
+        for (uint64_t remaining = graph_row[word] & this->members[word]; remaining != 0; remaining &= remaining - 1) {
+          const size_t vertex = word * WORD_BITS + lowest_bit(remaining);
+          const int b         = this->local_indices[vertex];
+          if (static_cast<size_t>(--this->degrees[b]) + 2 < required) {
+            this->members[word] &= ~(uint64_t(1) << (vertex % WORD_BITS));
+            this->peeled.push_back(b);
+          }
+        }
+      }
+    }
+
+    // Keep the remaining candidates
+    size_t n_vertices = 0;
+    for (size_t a = 0; a < this->vertices.size(); ++a) {
+      const int vertex = this->vertices[a];
+      if (((this->members[vertex / WORD_BITS] >> (vertex % WORD_BITS)) & 1) == 0) continue;
+      this->degrees[n_vertices]    = this->degrees[a];
+      this->vertices[n_vertices++] = vertex;
+    }
+    this->vertices.resize(n_vertices);
+
+    // Count their source points, which bound the size of cliques. Candidates
+    // are grouped by source point first, since correspondences of a source
+    // point need not be contiguous
+    this->permutation.resize(n_vertices);
+    std::iota(this->permutation.begin(), this->permutation.end(), 0);
+    std::sort(this->permutation.begin(), this->permutation.end(), [&](int a, int b) {
+      if (groups[this->vertices[a]] != groups[this->vertices[b]]) return groups[this->vertices[a]] < groups[this->vertices[b]];
+      return a < b;
+    });
+
+    size_t n_groups = 0;
+    this->group_degrees.resize(n_vertices);
+    for (size_t first = 0, last = 0; first < n_vertices; first = last, ++n_groups) {
+      const int group = groups[this->vertices[this->permutation[first]]];
+      int degree      = 0;
+      for (last = first; last < n_vertices && groups[this->vertices[this->permutation[last]]] == group; ++last) {
+        degree = std::max(degree, this->degrees[this->permutation[last]]);
+      }
+      for (size_t idx = first; idx < last; ++idx) this->group_degrees[this->permutation[idx]] = degree;
+    }
+    if (n_groups + 1 < required)
+      return;
+
+    // The greedy coloring visits vertices in the order of the subgraph, which
+    // gives tighter bounds if dense vertices come first. Source points are
+    // ordered by their densest correspondences, and correspondences of a
+    // source point are kept contiguous for count_groups()
+    std::sort(this->permutation.begin(), this->permutation.end(), [&](int a, int b) {
+      if (this->group_degrees[a] != this->group_degrees[b]) return this->group_degrees[a] > this->group_degrees[b];
+      if (groups[this->vertices[a]] != groups[this->vertices[b]]) return groups[this->vertices[a]] < groups[this->vertices[b]];
+      if (this->degrees[a] != this->degrees[b]) return this->degrees[a] > this->degrees[b];
+      return a < b;
+    });
+
+    this->ordered_vertices.resize(n_vertices);
+    for (size_t a = 0; a < n_vertices; ++a) {
+      this->ordered_vertices[a]                      = this->vertices[this->permutation[a]];
+      this->local_indices[this->ordered_vertices[a]] = static_cast<int>(a);
+    }
+    std::swap(this->vertices, this->ordered_vertices);
+
+    // Build the candidate subgraph, where only entries of ``local_indices``
+    // of members are valid
+    this->n_words = (n_vertices + WORD_BITS - 1) / WORD_BITS;
+    this->adjacency.assign(n_vertices * this->n_words, 0);
+    this->same_group.assign(this->n_words, 0);
+    for (size_t a = 0; a < n_vertices; ++a) {
+      uint64_t *row             = this->adjacency.data() + a * this->n_words;
+      const uint64_t *graph_row = this->graph.get_row(this->vertices[a]);
+      for (size_t word = 0; word < n_graph_words; ++word) {
+        for (uint64_t remaining = graph_row[word] & this->members[word]; remaining != 0; remaining &= remaining - 1) {
+          const int b = this->local_indices[word * WORD_BITS + lowest_bit(remaining)];
+          row[b / WORD_BITS] |= uint64_t(1) << (b % WORD_BITS);
+        }
+      }
+      if (a > 0 && groups[this->vertices[a]] == groups[this->vertices[a - 1]]) {
+        this->same_group[a / WORD_BITS] |= uint64_t(1) << (a % WORD_BITS);
+      }
+    }
+    this->uncolored.resize(this->n_words);
+    this->colorable.resize(this->n_words);
+
+    this->candidates.resize(std::max<size_t>(this->candidates.size(), 1));
+    this->candidates[0].assign(this->n_words, 0);
+    for (size_t a = 0; a < n_vertices; ++a) this->candidates[0][a / WORD_BITS] |= uint64_t(1) << (a % WORD_BITS);
+
+    this->clique.assign(1, root);
+    if (n_vertices == 0) {
+      if (this->best.get_required_size(rank) <= 1) this->best.offer(this->clique, rank);
+      return;
+    }
+    this->expand(0);
+  }
+};
+
+};  // namespace
+
+/* ---------------------------- ConsistencyGraph ---------------------------- */
+
+void ConsistencyGraph::build(const Correspondences &correspondences,
+                             double bound,
+                             Executor *executor,
+                             bool exclude_same_source) {
+  const Eigen::Matrix3Xd &src = correspondences.points.first;
+  const Eigen::Matrix3Xd &dst = correspondences.points.second;
+
+  const size_t n_vertices = src.cols();
+  this->n_vertices        = n_vertices;
+  this->n_words           = (n_vertices + WORD_BITS - 1) / WORD_BITS;
+  this->adjacency.assign(n_vertices * this->n_words, 0);
+
+  if (exclude_same_source && correspondences.indices.first.size() == n_vertices) {
+    this->groups = correspondences.indices.first;
+  } else {
+    this->groups.resize(n_vertices);
+    std::iota(this->groups.begin(), this->groups.end(), 0);
+  }
+
+  // Coordinates are stored axis by axis and padded to whole words, so a word
+  // of the adjacency matrix is computed by a vectorizable loop. Padded
+  // vertices have NaN coordinates, which fail the test
+  const size_t stride = this->n_words * WORD_BITS;
+  this->coordinates.assign(6 * stride, std::numeric_limits<double>::quiet_NaN());
+  for (size_t vertex = 0; vertex < n_vertices; ++vertex) {
+    for (int axis = 0; axis < 3; ++axis) {
+      this->coordinates[axis * stride + vertex]       = src(axis, vertex);
+      this->coordinates[(3 + axis) * stride + vertex] = dst(axis, vertex);
+    }
+  }
+
+  const size_t n_words           = this->n_words;
+  const double *src_x            = this->coordinates.data();
+  const double *src_y            = src_x + stride;
+  const double *src_z            = src_y + stride;
+  const double *dst_x            = src_z + stride;
+  const double *dst_y            = dst_x + stride;
+  const double *dst_z            = dst_y + stride;
+  const std::vector<int> &groups = this->groups;
+
+  // Instead of comparing distances, which takes two square roots, squared
+  // distances ``a^2`` and ``b^2`` are compared first. As
+  // ``a^2 + b^2 <= (a + b)^2 <= 2 (a^2 + b^2)``, the test
+  // ``(a^2 - b^2)^2 <= bound^2 (a + b)^2`` is settled without square roots
+  // unless ``(a^2 - b^2)^2`` lies between ``bound^2 (a^2 + b^2)`` and twice of
+  // it, which holds for a small fraction of pairs
+  const double lower_bound = bound * bound * (1 - BOUND_MARGIN);
+  const double upper_bound = 2 * bound * bound * (1 + BOUND_MARGIN);
+
+  // The matrix is symmetric, so a task builds the words on and above the
+  // diagonal of a block of rows, and the rest are transposed from them
+  run_tasks(executor, n_words, [&](size_t block, size_t) {
+    const size_t begin = block * WORD_BITS;
+    const size_t end   = std::min(begin + WORD_BITS, n_vertices);
+
+    double consistent_scores[WORD_BITS], candidate_scores[WORD_BITS];
+    for (size_t i = begin; i < end; ++i) {
+      uint64_t *row = this->adjacency.data() + i * n_words;
+      const double src_xi = src_x[i], src_yi = src_y[i], src_zi = src_z[i];
+      const double dst_xi = dst_x[i], dst_yi = dst_y[i], dst_zi = dst_z[i];
+
+      for (size_t word = block; word < n_words; ++word) {
+        const size_t offset = word * WORD_BITS;
+        for (size_t bit = 0; bit < WORD_BITS; ++bit) {
+          const size_t j           = offset + bit;
+          const double src_dx      = src_x[j] - src_xi;
+          const double src_dy      = src_y[j] - src_yi;
+          const double src_dz      = src_z[j] - src_zi;
+          const double dst_dx      = dst_x[j] - dst_xi;
+          const double dst_dy      = dst_y[j] - dst_yi;
+          const double dst_dz      = dst_z[j] - dst_zi;
+          const double src_squared = src_dx * src_dx + src_dy * src_dy + src_dz * src_dz;
+          const double dst_squared = dst_dx * dst_dx + dst_dy * dst_dy + dst_dz * dst_dz;
+          const double difference  = src_squared - dst_squared;
+          const double sum         = src_squared + dst_squared;
+          consistent_scores[bit]   = difference * difference - lower_bound * sum;
+          candidate_scores[bit]    = difference * difference - upper_bound * sum;
+        }
+
+        // Padded vertices have NaN scores, which are never candidates
+        uint64_t candidates = 0;
+        for (size_t bit = 0; bit < WORD_BITS; ++bit) {
+          candidates |= static_cast<uint64_t>(candidate_scores[bit] <= 0) << bit;
+        }
+
+        uint64_t consistent = 0;
+        for (; candidates != 0; candidates &= candidates - 1) {
+          const size_t bit = lowest_bit(candidates);
+          if (consistent_scores[bit] <= 0) {
+            consistent |= uint64_t(1) << bit;
+            continue;
+          }
+
+          const size_t j            = offset + bit;
+          const double src_dx       = src_x[j] - src_xi;
+          const double src_dy       = src_y[j] - src_yi;
+          const double src_dz       = src_z[j] - src_zi;
+          const double dst_dx       = dst_x[j] - dst_xi;
+          const double dst_dy       = dst_y[j] - dst_yi;
+          const double dst_dz       = dst_z[j] - dst_zi;
+          const double src_distance = std::sqrt(src_dx * src_dx + src_dy * src_dy + src_dz * src_dz);
+          const double dst_distance = std::sqrt(dst_dx * dst_dx + dst_dy * dst_dy + dst_dz * dst_dz);
+          if (std::abs(src_distance - dst_distance) <= bound) consistent |= uint64_t(1) << bit;
+        }
+        row[word] = consistent;
+      }
+
+      // Exclude the vertex itself
+      row[i / WORD_BITS] &= ~(uint64_t(1) << (i % WORD_BITS));
+    }
+  });
+
+  // Blocks above the diagonal are full, so their transposes fill the rows of
+  // the block below them, except the rows of padded vertices
+  run_tasks(executor, n_words, [&](size_t block, size_t) {
+    const size_t begin = block * WORD_BITS;
+    const size_t end   = std::min(begin + WORD_BITS, n_vertices);
+
+    uint64_t bits[WORD_BITS];
+    for (size_t word = 0; word < block; ++word) {
+      for (size_t bit = 0; bit < WORD_BITS; ++bit) bits[bit] = this->get_row(word * WORD_BITS + bit)[block];
+      transpose_bits(bits);
+      for (size_t i = begin; i < end; ++i) this->adjacency[i * n_words + word] = bits[i - begin];
+    }
+  });
+
+  // Exclude correspondences of the same source point, which need not be
+  // contiguous
+  this->group_order.resize(n_vertices);
+  std::iota(this->group_order.begin(), this->group_order.end(), 0);
+  std::stable_sort(this->group_order.begin(), this->group_order.end(),
+                   [&](int a, int b) { return groups[a] < groups[b]; });
+  for (size_t first = 0, last = 0; first < n_vertices; first = last) {
+    const int group = groups[this->group_order[first]];
+    while (last < n_vertices && groups[this->group_order[last]] == group) ++last;
+    for (size_t a = first; a < last; ++a) {
+      for (size_t b = first; b < last; ++b) {
+        const int j = this->group_order[b];
+        this->adjacency[this->group_order[a] * n_words + j / WORD_BITS] &= ~(uint64_t(1) << (j % WORD_BITS));
+      }
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+size_t ConsistencyGraph::get_n_edges() const {
+  return count_bits(this->adjacency.data(), this->adjacency.size()) / 2;
+}
+
+/* ----------------------------- find_max_clique ---------------------------- */
+
+std::vector<int> find_max_clique(const ConsistencyGraph &graph, bool exact, Executor *executor, double time_limit) {
+  Deadline deadline(time_limit);
+  const size_t n_vertices = graph.get_n_vertices();
+  const size_t n_words    = graph.get_n_words();
+  if (n_vertices == 0)
+    return std::vector<int>();
+
+  // Order vertices by the core decomposition (Batagelj and Zaversnik), where
+  // each vertex has at most ``cores[vertex]`` later neighbors
+  std::vector<int> cores(n_vertices), order(n_vertices), positions(n_vertices);
+  int max_degree = 0;
+  for (size_t vertex = 0; vertex < n_vertices; ++vertex) {
+    cores[vertex] = static_cast<int>(count_bits(graph.get_row(vertex), n_words));
+    max_degree    = std::max(max_degree, cores[vertex]);
+  }
+
+  std::vector<int> bins(max_degree + 1, 0);
+  for (const int degree : cores) ++bins[degree];
+  for (int degree = 0, start = 0; degree <= max_degree; ++degree) {
+    const int count = bins[degree];
+    bins[degree]    = start;
+    start += count;
+  }
+  for (size_t vertex = 0; vertex < n_vertices; ++vertex) {
+    positions[vertex]        = bins[cores[vertex]]++;
+    order[positions[vertex]] = static_cast<int>(vertex);
+  }
+  for (int degree = max_degree; degree > 0; --degree) bins[degree] = bins[degree - 1];
+  bins[0] = 0;
+
+  for (size_t position = 0; position < n_vertices; ++position) {
+    const int vertex = order[position];
+    for_each_bit(graph.get_row(vertex), n_words, [&](size_t neighbor) {
+      if (cores[neighbor] > cores[vertex]) {
+        const int degree       = cores[neighbor];
+        const int first        = order[bins[degree]];
+        const int neighbor_pos = positions[neighbor];
+        if (first != static_cast<int>(neighbor)) {
+          std::swap(order[bins[degree]], order[neighbor_pos]);
+          positions[first]    = neighbor_pos;
+          positions[neighbor] = bins[degree];
+        }
+        ++bins[degree];
+        --cores[neighbor];
+      }
+    });
+  }
+
+  const size_t n_workers = executor != nullptr ? executor->get_n_workers() : 1;
+  const size_t n_chunks  = (n_vertices + SEARCH_CHUNK_SIZE - 1) / SEARCH_CHUNK_SIZE;
+
+  // Grow a greedy clique from each vertex, preferring candidates of larger
+  // core numbers. Vertices are ranked from the last of the core ordering,
+  // where the densest cores are
+  BestClique greedy(1);
+  {
+    std::vector<std::vector<uint64_t>> buffers(n_workers, std::vector<uint64_t>(n_words));
+    std::vector<std::vector<int>> cliques(n_workers);
+    run_tasks(executor, n_chunks, [&](size_t chunk, size_t worker) {
+      std::vector<uint64_t> &bits = buffers[worker];
+      std::vector<int> &clique    = cliques[worker];
+
+      for (size_t rank = chunk * SEARCH_CHUNK_SIZE; rank < std::min((chunk + 1) * SEARCH_CHUNK_SIZE, n_vertices); ++rank) {
+        const int root = order[n_vertices - 1 - rank];
+        if (static_cast<size_t>(cores[root]) + 1 < greedy.get_required_size(rank))
+          continue;
+
+        clique.assign(1, root);
+        std::copy(graph.get_row(root), graph.get_row(root) + n_words, bits.begin());
+        while (true) {
+          int next = -1;
+          for_each_bit(bits.data(), n_words, [&](size_t vertex) {
+            if (next < 0 || cores[vertex] > cores[next]) next = static_cast<int>(vertex);
+          });
+          if (next < 0) break;
+
+          clique.push_back(next);
+          const uint64_t *row = graph.get_row(next);
+          for (size_t word = 0; word < n_words; ++word) bits[word] &= row[word];
+        }
+
+        if (clique.size() >= greedy.get_required_size(rank)) greedy.offer(clique, rank);
+      }
+    });
+  }
+
+  std::vector<int> clique;
+  if (!exact) {
+    clique = std::move(greedy.get_clique());
+  } else {
+    // Any branch reaching the size of the greedy clique replaces it, so the
+    // result only depends on the branch order. Branches stop at the deadline,
+    // keeping the greedy clique if none has replaced it
+    BestClique best(greedy.get_clique().size());
+    std::vector<std::unique_ptr<BranchSearch>> searches(n_workers);
+    run_tasks(executor, n_chunks, [&](size_t chunk, size_t worker) {
+      auto &search = searches[worker];
+      if (search == nullptr) search.reset(new BranchSearch(graph, best, deadline));
+
+      for (size_t rank = chunk * SEARCH_CHUNK_SIZE; rank < std::min((chunk + 1) * SEARCH_CHUNK_SIZE, n_vertices); ++rank) {
+        if (deadline.is_reached()) break;
+        const int root = order[n_vertices - 1 - rank];
+        search->search(root, positions, cores[root], rank);
+      }
+    });
+    clique = best.get_clique().empty() ? std::move(greedy.get_clique()) : std::move(best.get_clique());
+  }
+
+  std::sort(clique.begin(), clique.end());
+  return clique;
+}
+
+};  // namespace kcp
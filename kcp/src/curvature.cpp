@@ -0,0 +1,155 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "kcp/curvature.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define KCP_CURVATURE_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace kcp {
+
+namespace keypoint {
+
+namespace {
+
+// Weights of the stencil from the left-most tap to the right-most tap. The
+// weight of the center is -2 * (1 + 1/2 + 1/3 + 1/4 + 1/5).
+const float CENTER_WEIGHT = -2 * static_cast<float>(1 + .5 + 1. / 3. + .25 + .2);
+const float W1            = 1.0f;
+const float W2            = 1.0f / 2;
+const float W3            = 1.0f / 3;
+const float W4            = 1.0f / 4;
+const float W5            = 1.0f / 5;
+
+void calculate_curvature_scalar(const float *p, int size, float *curvature) {
+  for (int j = 0; j < size; ++j) {
+    // clang-format off
+    float c = p[j] * W5 + p[j + 1] * W4 + p[j + 2] * W3 + p[j + 3] * W2 + p[j + 4] * W1
+            + p[j + 5] * CENTER_WEIGHT
+            + p[j + 6] * W1 + p[j + 7] * W2 + p[j + 8] * W3 + p[j + 9] * W4 + p[j + 10] * W5;
+    // clang-format on
+    curvature[j] = std::abs(c);
+  }
+}
+
+#ifdef KCP_CURVATURE_X86_DISPATCH
+
+__attribute__((target("avx2"))) void calculate_curvature_avx2(const float *p, int size, float *curvature) {
+  const __m256 w1     = _mm256_set1_ps(W1);
+  const __m256 w2     = _mm256_set1_ps(W2);
+  const __m256 w3     = _mm256_set1_ps(W3);
+  const __m256 w4     = _mm256_set1_ps(W4);
+  const __m256 w5     = _mm256_set1_ps(W5);
+  const __m256 center = _mm256_set1_ps(CENTER_WEIGHT);
+  const __m256 sign   = _mm256_set1_ps(-0.0f);
+
+  int j = 0;
+  for (; j + 8 <= size; j += 8) {
+    const float *q = p + j;
+    __m256 c       = _mm256_mul_ps(_mm256_loadu_ps(q), w5);
+    c              = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(q + 1), w4));
+    c              = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(q + 2), w3));
+    c              = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(q + 3), w2));
+    c              = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(q + 4), w1));
+    c              = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(q + 5), center));
+    c              = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(q + 6), w1));
+    c              = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(q + 7), w2));
+    c              = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(q + 8), w3));
+    c              = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(q + 9), w4));
+    c              = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(q + 10), w5));
+    _mm256_storeu_ps(curvature + j, _mm256_andnot_ps(sign, c));
+  }
+  calculate_curvature_scalar(p + j, size - j, curvature + j);
+}
+
+__attribute__((target("avx512f"))) void calculate_curvature_avx512(const float *p, int size, float *curvature) {
+  const __m512 w1     = _mm512_set1_ps(W1);
+  const __m512 w2     = _mm512_set1_ps(W2);
+  const __m512 w3     = _mm512_set1_ps(W3);
+  const __m512 w4     = _mm512_set1_ps(W4);
+  const __m512 w5     = _mm512_set1_ps(W5);
+  const __m512 center = _mm512_set1_ps(CENTER_WEIGHT);
+
+  for (int j = 0; j < size; j += 16) {
+    // the tail is handled by masked loads and stores
+    const __mmask16 mask = (size - j >= 16) ? static_cast<__mmask16>(0xFFFF)
+                                            : static_cast<__mmask16>((1u << (size - j)) - 1);
+    const float *q = p + j;
+    __m512 c       = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q), w5);
+    c              = _mm512_add_ps(c, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q + 1), w4));
+    c              = _mm512_add_ps(c, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q + 2), w3));
+    c              = _mm512_add_ps(c, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q + 3), w2));
+    c              = _mm512_add_ps(c, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q + 4), w1));
+    c              = _mm512_add_ps(c, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q + 5), center));
+    c              = _mm512_add_ps(c, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q + 6), w1));
+    c              = _mm512_add_ps(c, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q + 7), w2));
+    c              = _mm512_add_ps(c, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q + 8), w3));
+    c              = _mm512_add_ps(c, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q + 9), w4));
+    c              = _mm512_add_ps(c, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, q + 10), w5));
+    _mm512_mask_storeu_ps(curvature + j, mask, _mm512_abs_ps(c));
+  }
+}
+
+#endif
+
+}  // namespace
+
+/* ----------------------------- CurvatureKernel ---------------------------- */
+
+CurvatureKernel resolve_curvature_kernel(CurvatureKernel kernel) {
+#ifdef KCP_CURVATURE_X86_DISPATCH
+  static const bool has_avx2   = __builtin_cpu_supports("avx2");
+  static const bool has_avx512 = __builtin_cpu_supports("avx512f");
+
+  switch (kernel) {
+    case CurvatureKernel::AUTO:
+      return has_avx512 ? CurvatureKernel::AVX512 : (has_avx2 ? CurvatureKernel::AVX2 : CurvatureKernel::SCALAR);
+    case CurvatureKernel::AVX512:
+      return has_avx512 ? kernel : CurvatureKernel::SCALAR;
+    case CurvatureKernel::AVX2:
+      return has_avx2 ? kernel : CurvatureKernel::SCALAR;
+    default:
+      return CurvatureKernel::SCALAR;
+  }
+#else
+  return CurvatureKernel::SCALAR;
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+void pad_cyclic_depth(const float *depth, int size, float *padded) {
+  for (int m = 1; m <= CURVATURE_HALO; ++m) {
+    padded[CURVATURE_HALO - m]            = depth[size - 1 - m];
+    padded[CURVATURE_HALO + size - 1 + m] = depth[m];
+  }
+  std::copy(depth, depth + size, padded + CURVATURE_HALO);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void calculate_curvature(const float *padded, int size, float *curvature, CurvatureKernel kernel) {
+  switch (kernel) {
+#ifdef KCP_CURVATURE_X86_DISPATCH
+    case CurvatureKernel::AVX512:
+      calculate_curvature_avx512(padded, size, curvature);
+      break;
+    case CurvatureKernel::AVX2:
+      calculate_curvature_avx2(padded, size, curvature);
+      break;
+#endif
+    default:
+      calculate_curvature_scalar(padded, size, curvature);
+      break;
+  }
+}
+
+};  // namespace keypoint
+
+};  // namespace kcp
@@ -3,86 +3,566 @@
 // license that can be found in the LICENSE file.
 
 #include "kcp/keypoint.hpp"
+#include "kcp/curvature.hpp"
+#include "kcp/parallel.hpp"
 #include "kcp/utility.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
 
 namespace kcp {
 
 namespace keypoint {
 
-/* ------------------------------- RangeImage ------------------------------- */
-
-RangeImage::RangeImage(Eigen::MatrixX3d cloud,
-                       int n_channels,
-                       float min_vfov_deg,
-                       float max_vfov_deg,
-                       int hfov_resolution)
-    : cloud(cloud),
-      n_channels(n_channels),
-      min_vfov_deg(min_vfov_deg),
-      max_vfov_deg(max_vfov_deg),
-      hfov_resolution(hfov_resolution) {
-  this->channel.reserve(cloud.rows());
-
-  this->image_indices = Eigen::MatrixXi::Ones(n_channels, hfov_resolution) * -1;
-  this->image_depth_sequence.reserve(this->cloud.rows());
-  this->image_point_indices_sequence.reserve(this->cloud.rows());
-  this->image_col_indices_sequence.reserve(this->cloud.rows());
-
-  this->calculate_point_cloud_properties();
+/* ----------------------------- BasicRangeImage ---------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar>::BasicRangeImage(int n_channels,
+                                         float min_vfov_deg,
+                                         float max_vfov_deg,
+                                         int hfov_resolution)
+    : BasicRangeImage(SensorModel::uniform(n_channels, min_vfov_deg, max_vfov_deg), hfov_resolution) {}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar>::BasicRangeImage(CloudMatrix cloud,
+                                         int n_channels,
+                                         float min_vfov_deg,
+                                         float max_vfov_deg,
+                                         int hfov_resolution)
+    : BasicRangeImage(n_channels, min_vfov_deg, max_vfov_deg, hfov_resolution) {
+  this->reset(std::move(cloud));
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar>::BasicRangeImage(const SensorModel &sensor_model, int hfov_resolution)
+    : cloud_data(nullptr),
+      cloud_rows(0),
+      cloud_outer_stride(0),
+      cloud_inner_stride(1),
+      sensor_model(sensor_model),
+      n_channels(sensor_model.get_n_channels()),
+      hfov_resolution(hfov_resolution),
+      deskew_motion(Eigen::Matrix4d::Identity()),
+      filtering(false) {
+  this->image_indices = Eigen::MatrixXi::Constant(this->n_channels, hfov_resolution, -1);
+  this->image_depths.resize(this->n_channels, hfov_resolution);
+  this->channel_start_indices.reserve(this->n_channels);
+  this->channel_end_indices.reserve(this->n_channels);
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar>::BasicRangeImage(CloudMatrix cloud, const SensorModel &sensor_model, int hfov_resolution)
+    : BasicRangeImage(sensor_model, hfov_resolution) {
+  this->reset(std::move(cloud));
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar>::BasicRangeImage(const CloudView &cloud,
+                                         int n_channels,
+                                         float min_vfov_deg,
+                                         float max_vfov_deg,
+                                         int hfov_resolution)
+    : BasicRangeImage(n_channels, min_vfov_deg, max_vfov_deg, hfov_resolution) {
+  this->reset(cloud);
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar>::BasicRangeImage(const CloudView &cloud, const SensorModel &sensor_model, int hfov_resolution)
+    : BasicRangeImage(sensor_model, hfov_resolution) {
+  this->reset(cloud);
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar>::BasicRangeImage(CloudMatrix cloud,
+                                         const Eigen::Ref<const Eigen::VectorXi> &rings,
+                                         const Eigen::Ref<const Eigen::VectorXi> &columns,
+                                         int n_channels,
+                                         int hfov_resolution)
+    : BasicRangeImage(n_channels, -30.0, 10.0, hfov_resolution) {
+  this->reset(std::move(cloud), rings, columns);
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar>::BasicRangeImage(const CloudView &cloud,
+                                         const Eigen::Ref<const Eigen::VectorXi> &rings,
+                                         const Eigen::Ref<const Eigen::VectorXi> &columns,
+                                         int n_channels,
+                                         int hfov_resolution)
+    : BasicRangeImage(n_channels, -30.0, 10.0, hfov_resolution) {
+  this->reset(cloud, rings, columns);
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar> BasicRangeImage<Scalar>::from_organized(CloudMatrix cloud, int height, int width) {
+  BasicRangeImage range_image(height, -30.0, 10.0, width);
+  range_image.reset_organized(std::move(cloud));
+  return range_image;
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar> BasicRangeImage<Scalar>::from_organized(const CloudView &cloud, int height, int width) {
+  BasicRangeImage range_image(height, -30.0, 10.0, width);
+  range_image.reset_organized(cloud);
+  return range_image;
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar>::BasicRangeImage(const BasicRangeImage &other)
+    : cloud_storage(other.cloud_storage),
+      cloud_data(other.cloud_data),
+      cloud_rows(other.cloud_rows),
+      cloud_outer_stride(other.cloud_outer_stride),
+      cloud_inner_stride(other.cloud_inner_stride),
+      sensor_model(other.sensor_model),
+      n_channels(other.n_channels),
+      hfov_resolution(other.hfov_resolution),
+      image_indices(other.image_indices),
+      image_depths(other.image_depths),
+      image_depth_sequence(other.image_depth_sequence),
+      image_point_indices_sequence(other.image_point_indices_sequence),
+      image_col_indices_sequence(other.image_col_indices_sequence),
+      channel_start_indices(other.channel_start_indices),
+      channel_end_indices(other.channel_end_indices),
+      profile(other.profile),
+      deskew_motion(other.deskew_motion),
+      deskew(other.deskew),
+      deskew_transforms(other.deskew_transforms),
+      deskewed_storage(other.deskewed_storage),
+      filter(other.filter),
+      filtering(other.filtering) {
+  if (other.owns_cloud()) {
+    this->cloud_data = this->cloud_storage.data();
+  } else if (!other.deskewed_storage.empty() && other.cloud_data == other.deskewed_storage.data()) {
+    this->cloud_data = this->deskewed_storage.data();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicRangeImage<Scalar> &BasicRangeImage<Scalar>::operator=(const BasicRangeImage &other) {
+  if (this != &other) {
+    BasicRangeImage copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::bind_cloud(const Scalar *data,
+                                         Eigen::Index rows,
+                                         Eigen::Index outer_stride,
+                                         Eigen::Index inner_stride) {
+  this->cloud_data         = data;
+  this->cloud_rows         = rows;
+  this->cloud_outer_stride = outer_stride;
+  this->cloud_inner_stride = inner_stride;
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::reset(const CloudMatrix &cloud) {
+  this->bind_cloud(cloud.data(), cloud.rows(), cloud.outerStride(), 1);
   this->calculate_range_image();
 }
 
 /* -------------------------------------------------------------------------- */
 
-void RangeImage::calculate_point_cloud_properties() {
-  float delta_fov = deg2red(this->max_vfov_deg - this->min_vfov_deg) / this->n_channels;
-  float base_fov  = deg2red(this->min_vfov_deg);
+template <typename Scalar>
+void BasicRangeImage<Scalar>::reset(const CloudView &cloud) {
+  this->bind_cloud(cloud.data(), cloud.rows(), cloud.outerStride(), cloud.innerStride());
+  this->calculate_range_image();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::reset(CloudMatrix &&cloud) {
+  this->cloud_storage = std::move(cloud);
+  this->bind_cloud(this->cloud_storage.data(), this->cloud_storage.rows(), this->cloud_storage.outerStride(), 1);
+  this->calculate_range_image();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::reset(const CloudMatrix &cloud,
+                                    const Eigen::Ref<const Eigen::VectorXi> &rings,
+                                    const Eigen::Ref<const Eigen::VectorXi> &columns) {
+  if (rings.size() != cloud.rows() || columns.size() != cloud.rows()) {
+    throw std::invalid_argument("Mismatching sizes of cloud, rings and columns");
+  }
+  this->bind_cloud(cloud.data(), cloud.rows(), cloud.outerStride(), 1);
+  this->calculate_range_image(rings.data(), columns.data());
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::reset(const CloudView &cloud,
+                                    const Eigen::Ref<const Eigen::VectorXi> &rings,
+                                    const Eigen::Ref<const Eigen::VectorXi> &columns) {
+  if (rings.size() != cloud.rows() || columns.size() != cloud.rows()) {
+    throw std::invalid_argument("Mismatching sizes of cloud, rings and columns");
+  }
+  this->bind_cloud(cloud.data(), cloud.rows(), cloud.outerStride(), cloud.innerStride());
+  this->calculate_range_image(rings.data(), columns.data());
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::reset(CloudMatrix &&cloud,
+                                    const Eigen::Ref<const Eigen::VectorXi> &rings,
+                                    const Eigen::Ref<const Eigen::VectorXi> &columns) {
+  if (rings.size() != cloud.rows() || columns.size() != cloud.rows()) {
+    throw std::invalid_argument("Mismatching sizes of cloud, rings and columns");
+  }
+  this->cloud_storage = std::move(cloud);
+  this->bind_cloud(this->cloud_storage.data(), this->cloud_storage.rows(), this->cloud_storage.outerStride(), 1);
+  this->calculate_range_image(rings.data(), columns.data());
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::reset_organized(const CloudMatrix &cloud) {
+  this->bind_cloud(cloud.data(), cloud.rows(), cloud.outerStride(), 1);
+  this->calculate_organized_range_image();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::reset_organized(const CloudView &cloud) {
+  this->bind_cloud(cloud.data(), cloud.rows(), cloud.outerStride(), cloud.innerStride());
+  this->calculate_organized_range_image();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::reset_organized(CloudMatrix &&cloud) {
+  this->cloud_storage = std::move(cloud);
+  this->bind_cloud(this->cloud_storage.data(), this->cloud_storage.rows(), this->cloud_storage.outerStride(), 1);
+  this->calculate_organized_range_image();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::set_deskew(const Eigen::Matrix4d &motion, const Deskew &deskew) {
+  this->deskew_motion = motion;
+  this->deskew        = deskew;
+  this->deskew_transforms.clear();
+  if (motion.isIdentity())
+    return;
+
+  // The column at the start of the sweep is captured at time 0, and the time
+  // grows by 1 / hfov_resolution per column in the sweep order. The pose at a
+  // time interpolates the motion by slerp of the rotation and linear
+  // interpolation of the translation
+  const Eigen::Quaterniond rotation(motion.block<3, 3>(0, 0));
+  const Eigen::Vector3d translation = motion.block<3, 1>(0, 3);
+  const int n_columns               = this->hfov_resolution;
+
+  this->deskew_transforms.resize(12 * n_columns);
+  for (int column = 0; column < n_columns; ++column) {
+    const int offset  = deskew.descending ? deskew.start_column - column : column - deskew.start_column;
+    const double time = static_cast<double>(((offset % n_columns) + n_columns) % n_columns) / n_columns;
+
+    const Eigen::Matrix3d column_rotation    = Eigen::Quaterniond::Identity().slerp(time, rotation).toRotationMatrix();
+    const Eigen::Vector3d column_translation = time * translation;
+    Scalar *transform                        = this->deskew_transforms.data() + 12 * column;
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col) transform[4 * row + col] = static_cast<Scalar>(column_rotation(row, col));
+      transform[4 * row + 3] = static_cast<Scalar>(column_translation(row));
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::set_filter(const Filter &filter) {
+  this->filter    = filter;
+  this->filtering = !filter.crop_boxes.empty() || filter.min_range > 0 ||
+                    filter.max_range < std::numeric_limits<double>::infinity() ||
+                    filter.min_z > -std::numeric_limits<double>::infinity() ||
+                    filter.max_z < std::numeric_limits<double>::infinity() || filter.n_ground_channels > 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+Scalar *BasicRangeImage<Scalar>::prepare_deskewed_cloud() {
+  if (this->deskew_transforms.empty())
+    return nullptr;
+
+  // A point cloud owned by the range image is deskewed in place, as each
+  // point is read before it is written. Otherwise, the deskewed point cloud
+  // is stored in a buffer keeping its capacity across projections
+  if (this->owns_cloud())
+    return this->cloud_storage.data();
+  this->deskewed_storage.resize(3 * this->cloud_rows);
+  return this->deskewed_storage.data();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::calculate_range_image() {
+  this->profile = Profile();
+  ScopedTimer timer(this->profile.projection_time);
+
+  const CloudView cloud = this->get_cloud();
+  const Eigen::Index rows = cloud.rows();
+  Scalar *deskewed        = this->prepare_deskewed_cloud();
+
+  // resizing is a no-op if the shape of the range image is unchanged
+  this->image_indices.resize(this->n_channels, this->hfov_resolution);
+  this->image_depths.resize(this->n_channels, this->hfov_resolution);
+  this->image_indices.setConstant(-1);
+
+  // calculating indices of v-fov and h-fov, and set the index and the depth of
+  // the point to the range image. Pixels follow the measured rays, and points
+  // are filtered and deskewed afterwards, except missing returns at the origin
+  // for deskewing
+  size_t n_filtered_points = 0;
+  for (Eigen::Index idx = 0; idx < rows; ++idx) {
+    Scalar x = cloud(idx, 0);
+    Scalar y = cloud(idx, 1);
+    Scalar z = cloud(idx, 2);
+
+    Scalar xy_norm  = std::sqrt(x * x + y * y);
+    int channel_idx = this->sensor_model.get_channel(z, xy_norm);
+
+    float theta  = MAX(std::atan2(y, x) + M_PI, 0);
+    int thetaIdx = static_cast<int>(theta * this->hfov_resolution / (2 * M_PI)) % this->hfov_resolution;
+
+    const bool rejected =
+        this->filtering && this->filter.rejects(channel_idx, x, y, z, std::sqrt(xy_norm * xy_norm + z * z));
+
+    if (deskewed != nullptr) {
+      if (x != 0 || y != 0 || z != 0) this->deskew_point(thetaIdx, x, y, z);
+      deskewed[idx]            = x;
+      deskewed[idx + rows]     = y;
+      deskewed[idx + 2 * rows] = z;
+    }
+    if (rejected) {
+      ++n_filtered_points;
+      continue;
+    }
+
+    int &pixel = this->image_indices(channel_idx, thetaIdx);
+    if (pixel < 0) {
+      pixel                                     = static_cast<int>(idx);
+      this->image_depths(channel_idx, thetaIdx) = std::sqrt(x * x + y * y + z * z);
+    }
+  }
+
+  if (deskewed != nullptr) this->bind_cloud(deskewed, rows, rows, 1);
+  this->gather_sequences();
+
+  this->profile.n_points           = rows;
+  this->profile.n_filtered_points  = n_filtered_points;
+  this->profile.n_projected_points = this->image_depth_sequence.size();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::calculate_range_image(const int *rings, const int *columns) {
+  this->profile = Profile();
+  ScopedTimer timer(this->profile.projection_time);
+
+  const CloudView cloud = this->get_cloud();
+  const Eigen::Index rows = cloud.rows();
+  Scalar *deskewed        = this->prepare_deskewed_cloud();
+
+  this->image_indices.resize(this->n_channels, this->hfov_resolution);
+  this->image_depths.resize(this->n_channels, this->hfov_resolution);
+  this->image_indices.setConstant(-1);
+
+  // placing points to the given pixels, where points with invalid pixels or
+  // invalid depths (e.g., missing returns filled with NaN or zero) are skipped
+  // (and kept as they are by deskewing), and so are points rejected by the
+  // filter
+  size_t n_filtered_points = 0;
+  for (Eigen::Index idx = 0; idx < rows; ++idx) {
+    const int channel_idx = rings[idx];
+    const int col_idx     = columns[idx];
+    const bool on_image =
+        channel_idx >= 0 && channel_idx < this->n_channels && col_idx >= 0 && col_idx < this->hfov_resolution;
+
+    Scalar x    = cloud(idx, 0);
+    Scalar y    = cloud(idx, 1);
+    Scalar z    = cloud(idx, 2);
+    float depth = std::sqrt(x * x + y * y + z * z);
+    const bool valid    = on_image && depth > 0 && depth < std::numeric_limits<float>::infinity();
+    const bool rejected = valid && this->filtering && this->filter.rejects(channel_idx, x, y, z, depth);
+
+    if (deskewed != nullptr) {
+      if (valid) {
+        this->deskew_point(col_idx, x, y, z);
+        depth = std::sqrt(x * x + y * y + z * z);
+      }
+      deskewed[idx]            = x;
+      deskewed[idx + rows]     = y;
+      deskewed[idx + 2 * rows] = z;
+    }
+    if (!valid) continue;
+    if (rejected) {
+      ++n_filtered_points;
+      continue;
+    }
 
-  // calculating index of v-fov and add it to channel vector
-  for (int idx = 0; idx < cloud.rows(); ++idx) {
-    const auto &point = cloud.row(idx);
-    float &&xy_norm   = l2Norm(point(0), point(1));
-    float &&phi       = atan2(point(2), xy_norm);
-    int &&channel_idx = static_cast<int>(MIN(MAX((phi - base_fov) / delta_fov, 0), this->n_channels - 1));
-    this->channel.push_back(channel_idx);
+    int &pixel = this->image_indices(channel_idx, col_idx);
+    if (pixel < 0) {
+      pixel                                    = static_cast<int>(idx);
+      this->image_depths(channel_idx, col_idx) = depth;
+    }
   }
+
+  if (deskewed != nullptr) this->bind_cloud(deskewed, rows, rows, 1);
+  this->gather_sequences();
+
+  this->profile.n_points           = rows;
+  this->profile.n_filtered_points  = n_filtered_points;
+  this->profile.n_projected_points = this->image_depth_sequence.size();
 }
 
 /* -------------------------------------------------------------------------- */
 
-void RangeImage::calculate_range_image() {
-  // calculating index of h-fov and set to range image
-  for (size_t idx = 0; idx < this->cloud.rows(); ++idx) {
-    const auto &point = cloud.row(idx);
-    float &&theta     = MAX(atan2(point(1), point(0)) + M_PI, 0);
-    int &&thetaIdx    = static_cast<int>(theta * this->hfov_resolution / (2 * M_PI)) % this->hfov_resolution;
-    if (this->image_indices(this->channel[idx], thetaIdx) < 0) {
-      this->image_indices(this->channel[idx], thetaIdx) = idx;
+template <typename Scalar>
+void BasicRangeImage<Scalar>::calculate_organized_range_image() {
+  this->profile = Profile();
+  ScopedTimer timer(this->profile.projection_time);
+
+  const CloudView cloud = this->get_cloud();
+  const Eigen::Index rows = cloud.rows();
+
+  if (rows != static_cast<Eigen::Index>(this->n_channels) * this->hfov_resolution) {
+    throw std::invalid_argument("The size of an organized cloud must be n_channels * hfov_resolution");
+  }
+  Scalar *deskewed = this->prepare_deskewed_cloud();
+
+  this->image_indices.resize(this->n_channels, this->hfov_resolution);
+  this->image_depths.resize(this->n_channels, this->hfov_resolution);
+
+  this->image_depth_sequence.clear();
+  this->image_point_indices_sequence.clear();
+  this->image_col_indices_sequence.clear();
+  this->channel_start_indices.clear();
+  this->channel_end_indices.clear();
+  this->image_depth_sequence.reserve(cloud.rows());
+  this->image_point_indices_sequence.reserve(cloud.rows());
+  this->image_col_indices_sequence.reserve(cloud.rows());
+
+  // the point (r, c) of the organized cloud is stored at r * width + c, so the
+  // sequences are emitted in the storage order directly
+  int counter              = 0;
+  int idx                  = 0;
+  size_t n_filtered_points = 0;
+  for (int channel_idx = 0; channel_idx < this->n_channels; ++channel_idx) {
+    this->channel_start_indices.push_back(counter);
+
+    for (int h_idx = 0; h_idx < this->hfov_resolution; ++h_idx, ++idx) {
+      Scalar x         = cloud(idx, 0);
+      Scalar y         = cloud(idx, 1);
+      Scalar z         = cloud(idx, 2);
+      float depth      = std::sqrt(x * x + y * y + z * z);
+      const bool valid    = depth > 0 && depth < std::numeric_limits<float>::infinity();
+      const bool rejected = valid && this->filtering && this->filter.rejects(channel_idx, x, y, z, depth);
+      n_filtered_points += rejected;
+
+      if (deskewed != nullptr) {
+        if (valid) {
+          this->deskew_point(h_idx, x, y, z);
+          depth = std::sqrt(x * x + y * y + z * z);
+        }
+        deskewed[idx]            = x;
+        deskewed[idx + rows]     = y;
+        deskewed[idx + 2 * rows] = z;
+      }
+
+      if (valid && !rejected) {
+        ++counter;
+        this->image_indices(channel_idx, h_idx) = idx;
+        this->image_depths(channel_idx, h_idx)  = depth;
+        this->image_point_indices_sequence.push_back(idx);
+        this->image_depth_sequence.push_back(depth);
+        this->image_col_indices_sequence.push_back(h_idx);
+      } else {
+        this->image_indices(channel_idx, h_idx) = -1;
+      }
     }
+
+    this->channel_end_indices.push_back(counter - 1);
   }
 
-  // ordering point sequence and calculate depth information
+  if (deskewed != nullptr) this->bind_cloud(deskewed, rows, rows, 1);
+
+  this->profile.n_points           = rows;
+  this->profile.n_filtered_points  = n_filtered_points;
+  this->profile.n_projected_points = this->image_depth_sequence.size();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicRangeImage<Scalar>::gather_sequences() {
+  // ordering point sequence with depth information
+  this->image_depth_sequence.clear();
+  this->image_point_indices_sequence.clear();
+  this->image_col_indices_sequence.clear();
+  this->channel_start_indices.clear();
+  this->channel_end_indices.clear();
+  this->image_depth_sequence.reserve(this->cloud_rows);
+  this->image_point_indices_sequence.reserve(this->cloud_rows);
+  this->image_col_indices_sequence.reserve(this->cloud_rows);
+
   int counter = 0;
   int idx;
-  for (size_t channel_idx = 0; channel_idx < this->n_channels; ++channel_idx) {
+  for (int channel_idx = 0; channel_idx < this->n_channels; ++channel_idx) {
     // adding start indices to start vector
     this->channel_start_indices.push_back(counter);
 
     // looping vertices in one channel with order of h-fov
-    for (size_t h_idx = 0; h_idx < this->hfov_resolution; ++h_idx) {
-      if (this->image_indices(channel_idx, h_idx) >= 0) {
+    for (int h_idx = 0; h_idx < this->hfov_resolution; ++h_idx) {
+      idx = this->image_indices(channel_idx, h_idx);
+      if (idx >= 0) {
         ++counter;
-
-        idx = this->image_indices(channel_idx, h_idx);
-        // adding vertex index of point cloud to sequence
         this->image_point_indices_sequence.push_back(idx);
-
-        // adding vertex depth of this vertex to sequence
-        const auto &point = this->cloud.row(idx);
-        float &&depth     = l2Norm(point(0), point(1), point(2));
-        this->image_depth_sequence.push_back(depth);
+        this->image_depth_sequence.push_back(this->image_depths(channel_idx, h_idx));
         this->image_col_indices_sequence.push_back(h_idx);
       }
     }
@@ -92,211 +572,339 @@ void RangeImage::calculate_range_image() {
   }
 }
 
-/* --------------------------- MultiScaleCurvature -------------------------- */
+/* ------------------------ BasicMultiScaleCurvature ------------------------ */
 
-MultiScaleCurvature::MultiScaleCurvature(RangeImage range_image,
-                                         float corner_threshold,
-                                         float plane_threshold)
-    : range_image(range_image),
-      corner_threshold(corner_threshold),
-      plane_threshold(plane_threshold) {
-  this->curvature.assign(this->range_image.get_image_sequence_size(),
-                         {std::numeric_limits<float>::max(), -1});
-  this->label.assign(this->range_image.get_image_sequence_size(), Label::UNDEFINED);
+template <typename Scalar>
+BasicMultiScaleCurvature<Scalar>::BasicMultiScaleCurvature(BasicRangeImage<Scalar> range_image,
+                                                           float corner_threshold,
+                                                           float plane_threshold)
+    : range_image(std::move(range_image)) {
+  this->params.corner_threshold = corner_threshold;
+  this->params.plane_threshold  = plane_threshold;
   this->calculate_multi_scale_curvature();
 }
 
 /* -------------------------------------------------------------------------- */
 
-MultiScaleCurvature::MultiScaleCurvature(Eigen::MatrixX3d cloud,
-                                         int n_channels,
-                                         float min_vfov_deg,
-                                         float max_vfov_deg,
-                                         int hfov_resolution,
-                                         float corner_threshold,
-                                         float plane_threshold)
-    : range_image(cloud,
+template <typename Scalar>
+BasicMultiScaleCurvature<Scalar>::BasicMultiScaleCurvature(BasicRangeImage<Scalar> range_image, const Params &params)
+    : range_image(std::move(range_image)),
+      params(params) {
+  this->calculate_multi_scale_curvature();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicMultiScaleCurvature<Scalar>::BasicMultiScaleCurvature(CloudMatrix cloud,
+                                                           int n_channels,
+                                                           float min_vfov_deg,
+                                                           float max_vfov_deg,
+                                                           int hfov_resolution,
+                                                           float corner_threshold,
+                                                           float plane_threshold)
+    : range_image(std::move(cloud),
                   n_channels,
                   min_vfov_deg,
                   max_vfov_deg,
-                  hfov_resolution),
-      corner_threshold(corner_threshold),
-      plane_threshold(plane_threshold) {
-  this->curvature.assign(this->range_image.get_image_sequence_size(),
-                         {std::numeric_limits<float>::max(), -1});
-  this->label.assign(this->range_image.get_image_sequence_size(), Label::UNDEFINED);
+                  hfov_resolution) {
+  this->params.corner_threshold = corner_threshold;
+  this->params.plane_threshold  = plane_threshold;
+  this->calculate_multi_scale_curvature();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+BasicMultiScaleCurvature<Scalar>::BasicMultiScaleCurvature(CloudMatrix cloud,
+                                                           const SensorModel &sensor_model,
+                                                           int hfov_resolution,
+                                                           float corner_threshold,
+                                                           float plane_threshold)
+    : range_image(std::move(cloud), sensor_model, hfov_resolution) {
+  this->params.corner_threshold = corner_threshold;
+  this->params.plane_threshold  = plane_threshold;
+  this->calculate_multi_scale_curvature();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicMultiScaleCurvature<Scalar>::reset(BasicRangeImage<Scalar> &range_image) {
+  std::swap(this->range_image, range_image);
   this->calculate_multi_scale_curvature();
 }
 
 /* -------------------------------------------------------------------------- */
 
-void MultiScaleCurvature::calculate_multi_scale_curvature() {
+template <typename Scalar>
+Executor *BasicMultiScaleCurvature<Scalar>::get_executor() {
+  if (this->params.executor != nullptr)
+    return this->params.executor.get();
+  if (this->params.n_threads == 1)
+    return nullptr;
+
+  const size_t n_workers = this->params.n_threads > 0 ? this->params.n_threads : std::thread::hardware_concurrency();
+  if (this->thread_pool == nullptr || this->thread_pool->get_n_workers() != std::max<size_t>(1, n_workers)) {
+    this->thread_pool = std::make_shared<ThreadPool>(n_workers);
+  }
+  return this->thread_pool.get();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicMultiScaleCurvature<Scalar>::calculate_multi_scale_curvature() {
+  if (this->params.n_segments <= 0) {
+    throw std::invalid_argument("MultiScaleCurvature requires at least one segment per channel");
+  }
+
   const std::vector<float> &image_depth = this->range_image.get_image_depth_sequence();
+  const size_t sequence_size            = this->range_image.get_image_sequence_size();
+  const int n_channels                  = this->range_image.get_n_channels();
+
+  this->profile = Profile();
+
+  this->curvature.assign(sequence_size, std::numeric_limits<float>::max());
+  this->label.assign(sequence_size, Label::UNDEFINED);
+
+  Executor *executor     = this->get_executor();
+  const size_t n_workers = executor != nullptr ? executor->get_n_workers() : 1;
+  if (this->workspaces.size() < n_workers) this->workspaces.resize(n_workers);
 
   /**
    * Calculate curvature
    */
-  int sc, ec;  // start and end indices
-  float weight = 1 + .5 + 1. / 3. + .25 + .2;
-  for (size_t k = 0; k < this->range_image.get_n_channels(); ++k) {
-    sc = this->range_image.get_channel_start_indices()[k];
-    ec = this->range_image.get_channel_end_indices()[k];
-
-    if (sc >= ec - 15)
-      continue;
-
-    for (size_t i = sc; i <= ec; ++i) {
-      // clang-format off
-      float &&c = image_depth[CYCLIC_INDEX(i - 5, sc, ec)] / 5 + image_depth[CYCLIC_INDEX(i - 4, sc, ec)] / 4
-                + image_depth[CYCLIC_INDEX(i - 3, sc, ec)] / 3 + image_depth[CYCLIC_INDEX(i - 2, sc, ec)] / 2
-                + image_depth[CYCLIC_INDEX(i - 1, sc, ec)] - image_depth[i] * 2 * weight
-                + image_depth[CYCLIC_INDEX(i + 1, sc, ec)] + image_depth[CYCLIC_INDEX(i + 2, sc, ec)] / 2
-                + image_depth[CYCLIC_INDEX(i + 3, sc, ec)] / 3 + image_depth[CYCLIC_INDEX(i + 4, sc, ec)] / 4
-                + image_depth[CYCLIC_INDEX(i + 5, sc, ec)] / 5;
-      // clang-format on
-      this->curvature[i] = {std::abs(c), i};
-      this->label[i]     = Label::NORMAL;
-    }
+  const CurvatureKernel kernel = resolve_curvature_kernel(this->params.curvature_kernel);
+
+  {
+    ScopedTimer timer(this->profile.curvature_time);
+    run_tasks(executor, n_channels, [&](size_t k, size_t worker) {
+      const int sc = this->range_image.get_channel_start_indices()[k];  // start index
+      const int ec = this->range_image.get_channel_end_indices()[k];    // end index
+
+      if (sc >= ec - 15)
+        return;
+
+      // the cyclic wrap is handled by the halo of the padded depth row
+      std::vector<float> &padded_depth = this->workspaces[worker].padded_depth;
+      const int size                   = ec - sc + 1;
+      padded_depth.resize(size + 2 * CURVATURE_HALO);
+      pad_cyclic_depth(image_depth.data() + sc, size, padded_depth.data());
+      calculate_curvature(padded_depth.data(), size, this->curvature.data() + sc, kernel);
+      std::fill(this->label.begin() + sc, this->label.begin() + ec + 1, Label::NORMAL);
+    });
   }
 
   /**
    * Extract features
    */
+  ScopedTimer timer(this->profile.selection_time);
+
+  this->segment_order.resize(sequence_size);
+  for (size_t idx = 0; idx < sequence_size; ++idx) this->segment_order[idx] = static_cast<int>(idx);
+
+  this->channel_corner_point_indices.resize(n_channels);
+  this->channel_plane_point_indices.resize(n_channels);
+
+  // Neighbors are only marked within their own channel, so channels are
+  // independent
+  run_tasks(executor, n_channels, [&](size_t i, size_t worker) {
+    this->select_channel_features(static_cast<int>(i), this->workspaces[worker]);
+  });
+
+  // Merge features in channel order
+  size_t n_corners = 0, n_planes = 0;
+  for (int i = 0; i < n_channels; ++i) {
+    n_corners += this->channel_corner_point_indices[i].size();
+    n_planes += this->channel_plane_point_indices[i].size();
+  }
+
+  const std::vector<int> &point_indices = this->range_image.get_image_point_indices_sequence();
+
   this->corner_point_indices.clear();
   this->plane_point_indices.clear();
-  this->corner_point_indices.reserve(500);
-  this->plane_point_indices.reserve(20000);
+  this->corner_point_curvatures.clear();
+  this->corner_point_indices.reserve(n_corners);
+  this->plane_point_indices.reserve(n_planes);
+  this->corner_point_curvatures.reserve(n_corners);
+  for (int i = 0; i < n_channels; ++i) {
+    for (const int idx : this->channel_corner_point_indices[i]) {
+      this->corner_point_indices.push_back(point_indices[idx]);
+      this->corner_point_curvatures.push_back(this->curvature[idx]);
+    }
+    for (const int idx : this->channel_plane_point_indices[i]) {
+      this->plane_point_indices.push_back(point_indices[idx]);
+    }
+  }
+
+  // Allocate corner and plane points
+  const typename BasicRangeImage<Scalar>::CloudView cloud = this->range_image.get_cloud();
 
-  auto cloud = this->range_image.get_cloud();
+  this->corner_points.resize(this->corner_point_indices.size(), 3);
+  for (size_t idx = 0; idx < this->corner_point_indices.size(); ++idx) {
+    this->corner_points.row(idx) = cloud.row(this->corner_point_indices[idx]);
+  }
 
-  int sp, ep;      // start and end segment indices
-  int counter;     // counter for max number of feature points
-  int idx;         // index variable for vertex
-  int rIdx, lIdx;  // left and right indices for ambiguity condition
-  for (size_t i = 0; i < this->range_image.get_n_channels(); ++i) {
-    sc = this->range_image.get_channel_start_indices()[i];
-    ec = this->range_image.get_channel_end_indices()[i];
+  this->plane_points.resize(this->plane_point_indices.size(), 3);
+  for (size_t idx = 0; idx < this->plane_point_indices.size(); ++idx) {
+    this->plane_points.row(idx) = cloud.row(this->plane_point_indices[idx]);
+  }
 
-    if (sc >= ec - 20)
-      continue;
+  this->profile.n_corner_points = this->corner_point_indices.size();
+  this->profile.n_plane_points  = this->plane_point_indices.size();
+}
 
-    for (size_t j = 0; j < 6; ++j) {
-      // Partial range (start index and end index of a partial segment within a channel)
-      sp = (sc * (6 - j) + ec * j) / 6;
-      ep = (sc * (5 - j) + ec * (j + 1)) / 6 + 1;
-
-      std::sort(this->curvature.begin() + sp, this->curvature.begin() + ep);
-      counter = 0;
-      // Handling edge features
-      for (int k = ep - 1; k >= sp; --k) {
-        idx = this->curvature[k].second;
-
-        if (this->label[idx] == Label::NORMAL && this->curvature[k].first > this->corner_threshold) {
-          ++counter;
-          // Add vertex to set of edge features
-          if (counter <= 12) {
-            this->label[idx] = Label::CORNER;
-            this->corner_point_indices.push_back(this->range_image.get_image_point_indices_sequence()[idx]);
-          } else {
-            break;
-          }
-
-          // Mark neighbor vertices as ambiguity
-          // .. Right hand side
-          for (int l = 1; l <= 5; ++l) {
-            if (idx + l >= this->range_image.get_image_col_indices_sequence().size()) {
-              break;
-            }
-            rIdx = this->range_image.get_image_col_indices_sequence()[idx + l];
-            lIdx = this->range_image.get_image_col_indices_sequence()[idx + l - 1];
-
-            int &&columnDiff = std::abs(int(rIdx - lIdx));
-            if (columnDiff > 10)
-              break;
-
-            this->label[rIdx] = Label::AMBIGUOUS;
-          }
-          // .. Left hand side
-          for (int l = -1; l >= -5; --l) {
-            if (idx + l < 0) {
-              break;
-            }
-            rIdx = this->range_image.get_image_col_indices_sequence()[idx + l + 1];
-            lIdx = this->range_image.get_image_col_indices_sequence()[idx + l];
-
-            int &&columnDiff = std::abs(int(rIdx - lIdx));
-            if (columnDiff > 10)
-              break;
-
-            this->label[lIdx] = Label::AMBIGUOUS;
-          }
-        }
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicMultiScaleCurvature<Scalar>::select_channel_features(int channel, Workspace &workspace) {
+  const int sc = this->range_image.get_channel_start_indices()[channel];  // start index
+  const int ec = this->range_image.get_channel_end_indices()[channel];    // end index
+
+  std::vector<int> &corner_indices = this->channel_corner_point_indices[channel];
+  std::vector<int> &plane_indices  = this->channel_plane_point_indices[channel];
+  corner_indices.clear();
+  plane_indices.clear();
+
+  if (sc >= ec - 20)
+    return;
+
+  const int n_segments = this->params.n_segments;
+  int sp, ep;  // start and end segment indices
+  for (int j = 0; j < n_segments; ++j) {
+    // Partial range (start index and end index of a partial segment within a
+    // channel). Two adjacent segments share one slot.
+    sp = (sc * (n_segments - j) + ec * j) / n_segments;
+    ep = (sc * (n_segments - 1 - j) + ec * (j + 1)) / n_segments + 1;
+    this->select_segment_features(sp, ep, sc, ec, workspace, corner_indices, plane_indices);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicMultiScaleCurvature<Scalar>::select_segment_features(int sp,
+                                                               int ep,
+                                                               int sc,
+                                                               int ec,
+                                                               Workspace &workspace,
+                                                               std::vector<int> &corner_indices,
+                                                               std::vector<int> &plane_indices) {
+  std::vector<int> &order           = this->segment_order;
+  std::vector<uint64_t> &candidates = workspace.candidates;
+
+  // Curvatures are non-negative, so the bit pattern of a float preserves its
+  // order, and the packed key orders points by {curvature, index}.
+  auto pack = [this](int idx) -> uint64_t {
+    uint32_t bits;
+    std::memcpy(&bits, &this->curvature[idx], sizeof(bits));
+    return (static_cast<uint64_t>(bits) << 32) | static_cast<uint32_t>(idx);
+  };
+  auto unpack = [](uint64_t key) -> int { return static_cast<int>(key & 0xFFFFFFFFu); };
+
+  auto select_corner = [&](int idx) {
+    this->label[idx] = Label::CORNER;
+    corner_indices.push_back(idx);
+    this->mark_ambiguous_neighbors(idx, sc, ec);
+  };
+  auto select_plane = [&](int idx) {
+    this->label[idx] = Label::PLANE;
+    plane_indices.push_back(idx);
+    this->mark_ambiguous_neighbors(idx, sc, ec);
+  };
+
+  const int max_corners = this->params.max_corners_per_segment;
+  int counter           = 0;
+
+  if (this->params.selection == Selection::SORT) {
+    std::sort(order.begin() + sp, order.begin() + ep,
+              [&](int lhs, int rhs) { return pack(lhs) < pack(rhs); });
+
+    // Handling edge features
+    for (int k = ep - 1; k >= sp; --k) {
+      const int idx = order[k];
+      if (this->label[idx] == Label::NORMAL && this->curvature[idx] > this->params.corner_threshold) {
+        if (++counter > max_corners) break;
+        select_corner(idx);
       }
+    }
 
-      // Handle plane features
-      for (int k = ep - 1; k >= sp; --k) {
-        idx = this->curvature[k].second;
-        if (this->label[idx] == Label::NORMAL && this->curvature[k].first < this->plane_threshold) {
-          // add vertex to set of plane features
-          this->label[idx] = Label::PLANE;
-          this->plane_point_indices.push_back(this->range_image.get_image_point_indices_sequence()[idx]);
-
-          // mark neighbor vertices as ambiguity
-          // right hand side
-          for (int l = 1; l <= 5; ++l) {
-            if (idx + l >= this->range_image.get_image_col_indices_sequence().size()) {
-              break;
-            }
-            rIdx = this->range_image.get_image_col_indices_sequence()[idx + l];
-            lIdx = this->range_image.get_image_col_indices_sequence()[idx + l - 1];
-
-            int &&columnDiff = std::abs(int(rIdx - lIdx));
-            if (columnDiff > 10)
-              break;
-
-            this->label[rIdx] = Label::AMBIGUOUS;
-          }
-          // left hand side
-          for (int l = -1; l >= -5; --l) {
-            if (idx + l >= this->range_image.get_image_col_indices_sequence().size()) {
-              break;
-            }
-
-            rIdx = this->range_image.get_image_col_indices_sequence()[idx + l + 1];
-            lIdx = this->range_image.get_image_col_indices_sequence()[idx + l];
-
-            int &&columnDiff = std::abs(int(rIdx - lIdx));
-            if (columnDiff > 10)
-              break;
-            this->label[lIdx] = Label::AMBIGUOUS;
-          }
-        }
+    // Handle plane features
+    for (int k = ep - 1; k >= sp; --k) {
+      const int idx = order[k];
+      if (this->label[idx] == Label::NORMAL && this->curvature[idx] < this->params.plane_threshold) {
+        select_plane(idx);
       }
     }
+    return;
   }
 
-  // Allocate corner and plane points
-  this->corner_points.setZero(this->corner_point_indices.size(), 3);
-  idx = 0;
-  for (const auto &point_idx : this->corner_point_indices) {
-    const auto &point           = this->range_image.get_cloud().row(point_idx);
-    this->corner_points(idx, 0) = point(0);
-    this->corner_points(idx, 1) = point(1);
-    this->corner_points(idx, 2) = point(2);
-    ++idx;
+  // Handling edge features: pop candidates above the threshold from a heap
+  // until the cap is reached. Labels are checked when a candidate is popped
+  // since selections mark other points as ambiguous.
+  candidates.clear();
+  int k_max = sp;
+  for (int k = sp; k < ep; ++k) {
+    const int idx = order[k];
+    if (pack(idx) > pack(order[k_max])) k_max = k;
+    if (this->curvature[idx] > this->params.corner_threshold) candidates.push_back(pack(idx));
   }
+  std::make_heap(candidates.begin(), candidates.end());
+  for (auto heap_end = candidates.end(); heap_end != candidates.begin(); --heap_end) {
+    std::pop_heap(candidates.begin(), heap_end);
+    const int idx = unpack(*(heap_end - 1));
+    if (this->label[idx] == Label::NORMAL) {
+      if (++counter > max_corners) break;
+      select_corner(idx);
+    }
+  }
+
+  // Handle plane features: only points below the threshold are ordered
+  candidates.clear();
+  for (int k = sp; k < ep; ++k) {
+    const int idx = order[k];
+    if (this->curvature[idx] < this->params.plane_threshold) candidates.push_back(pack(idx));
+  }
+  std::sort(candidates.begin(), candidates.end(), std::greater<uint64_t>());
+  for (const auto &key : candidates) {
+    const int idx = unpack(key);
+    if (this->label[idx] == Label::NORMAL) select_plane(idx);
+  }
+
+  // The slot shared with the next segment holds the maximum of this segment,
+  // which is what the in-place sort leaves there.
+  std::swap(order[k_max], order[ep - 1]);
+}
 
-  this->plane_points.setZero(this->plane_point_indices.size(), 3);
-  idx = 0;
-  for (const auto &point_idx : this->plane_point_indices) {
-    const auto point           = this->range_image.get_cloud().row(point_idx);
-    this->plane_points(idx, 0) = point(0);
-    this->plane_points(idx, 1) = point(1);
-    this->plane_points(idx, 2) = point(2);
-    ++idx;
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicMultiScaleCurvature<Scalar>::mark_ambiguous_neighbors(int idx, int sc, int ec) {
+  const std::vector<int> &col_indices = this->range_image.get_image_col_indices_sequence();
+
+  // right hand side
+  for (int l = 1; l <= 5 && idx + l <= ec; ++l) {
+    if (std::abs(col_indices[idx + l] - col_indices[idx + l - 1]) > 10)
+      break;
+    this->label[idx + l] = Label::AMBIGUOUS;
+  }
+
+  // left hand side
+  for (int l = 1; l <= 5 && idx - l >= sc; ++l) {
+    if (std::abs(col_indices[idx - l + 1] - col_indices[idx - l]) > 10)
+      break;
+    this->label[idx - l] = Label::AMBIGUOUS;
   }
 }
 
+/* ------------------------- Explicit instantiations ------------------------ */
+
+template class BasicRangeImage<double>;
+template class BasicRangeImage<float>;
+template class BasicMultiScaleCurvature<double>;
+template class BasicMultiScaleCurvature<float>;
+
 };  // namespace keypoint
 
 };  // namespace kcp
\ No newline at end of file
@@ -0,0 +1,256 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "kcp/local_map.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace kcp {
+
+namespace {
+
+/**
+ * @brief The number of source points queried by a task.
+ *
+ */
+constexpr size_t QUERY_CHUNK_SIZE = 256;
+
+};  // namespace
+
+/* -------------------------------- LocalMap -------------------------------- */
+
+LocalMap::LocalMap(const LocalMap::Params &params) : params(params), n_insertions(0) {
+  if (!(params.voxel_size > 0)) {
+    throw std::invalid_argument("The voxel size of a local map must be positive");
+  }
+  if (params.max_points_per_voxel <= 0) {
+    throw std::invalid_argument("The maximum number of points of a voxel must be positive");
+  }
+
+  this->clear();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void LocalMap::clear() {
+  this->voxels.clear();
+  this->points.resize(0, 3);
+  this->min_key.setConstant(std::numeric_limits<int>::max());
+  this->max_key.setConstant(std::numeric_limits<int>::min());
+}
+
+/* -------------------------------------------------------------------------- */
+
+LocalMap::VoxelKey LocalMap::get_voxel_key(const Eigen::Vector3d &point) const {
+  return (point / this->params.voxel_size).array().floor().cast<int>();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void LocalMap::insert(const Eigen::MatrixX3d &scan, const Eigen::Matrix4d &pose) {
+  const Eigen::Matrix3d rotation    = pose.block<3, 3>(0, 0);
+  const Eigen::Vector3d translation = pose.block<3, 1>(0, 3);
+  const size_t max_points           = this->params.max_points_per_voxel;
+
+  ++this->n_insertions;
+  for (Eigen::Index idx = 0; idx < scan.rows(); ++idx) {
+    const Eigen::Vector3d point = rotation * scan.row(idx).transpose() + translation;
+    if (!point.allFinite()) continue;
+
+    Voxel &voxel = this->voxels[this->get_voxel_key(point)];
+    if (voxel.points.size() < max_points) {
+      voxel.points.push_back(point);
+      voxel.stamps.push_back(this->n_insertions);
+    }
+  }
+
+  this->update(translation);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void LocalMap::update(const Eigen::Vector3d &position) {
+  const double squared_radius = this->params.radius * this->params.radius;
+  const size_t max_age        = this->params.max_age;
+
+  auto is_stale = [&](const Eigen::Vector3d &point, size_t stamp) {
+    return (point - position).squaredNorm() > squared_radius ||
+           (max_age > 0 && this->n_insertions - stamp >= max_age);
+  };
+
+  // Evict stale points and empty voxels
+  size_t n_points = 0;
+  this->min_key.setConstant(std::numeric_limits<int>::max());
+  this->max_key.setConstant(std::numeric_limits<int>::min());
+  for (auto iter = this->voxels.begin(); iter != this->voxels.end();) {
+    Voxel &voxel = iter->second;
+
+    size_t size = 0;
+    for (size_t idx = 0; idx < voxel.points.size(); ++idx) {
+      if (is_stale(voxel.points[idx], voxel.stamps[idx])) continue;
+      voxel.points[size] = voxel.points[idx];
+      voxel.stamps[size] = voxel.stamps[idx];
+      ++size;
+    }
+    voxel.points.resize(size);
+    voxel.stamps.resize(size);
+
+    if (size == 0) {
+      iter = this->voxels.erase(iter);
+      continue;
+    }
+
+    voxel.offset = n_points;
+    n_points += size;
+    this->min_key = this->min_key.cwiseMin(iter->first);
+    this->max_key = this->max_key.cwiseMax(iter->first);
+    ++iter;
+  }
+
+  // Gather points ordered by voxels
+  this->points.resize(n_points, 3);
+  for (const auto &item : this->voxels) {
+    const Voxel &voxel = item.second;
+    for (size_t idx = 0; idx < voxel.points.size(); ++idx) {
+      this->points.row(voxel.offset + idx) = voxel.points[idx].transpose();
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void LocalMap::search_k_closest_points(const Eigen::Vector3d &query,
+                                       size_t k,
+                                       std::vector<std::pair<double, int>> &neighbors) const {
+  neighbors.clear();
+
+  // The bounds of keys are undefined without points
+  if (this->voxels.empty() || k == 0)
+    return;
+
+  // Keep the k closest points in a max-heap of {squared distance, index}
+  auto visit = [&](double squared_distance, int index) {
+    if (neighbors.size() < k) {
+      neighbors.emplace_back(squared_distance, index);
+      std::push_heap(neighbors.begin(), neighbors.end());
+    } else if (squared_distance < neighbors.front().first) {
+      std::pop_heap(neighbors.begin(), neighbors.end());
+      neighbors.back() = {squared_distance, index};
+      std::push_heap(neighbors.begin(), neighbors.end());
+    }
+  };
+  auto visit_voxel = [&](const VoxelKey &key) {
+    auto iter = this->voxels.find(key);
+    if (iter == this->voxels.end()) return;
+
+    const Voxel &voxel = iter->second;
+    for (size_t idx = 0; idx < voxel.points.size(); ++idx) {
+      visit((voxel.points[idx] - query).squaredNorm(), static_cast<int>(voxel.offset + idx));
+    }
+  };
+
+  // Visit voxels ring by ring (the surface of a cube with half width r). Any
+  // point beyond the ring r is farther than r voxels from the query, so the
+  // search stops once the k-th closest point is within that distance.
+  const VoxelKey center = this->get_voxel_key(query);
+  const int max_ring    = (this->max_key - center).cwiseMax(center - this->min_key).maxCoeff();
+  for (int r = 0; r <= max_ring; ++r) {
+    // Scanning all points is cheaper than visiting a huge ring, which happens
+    // for queries far away from the map
+    const size_t n_ring_voxels = r == 0 ? 1 : 24 * r * r + 2;
+    if (n_ring_voxels > this->voxels.size()) {
+      neighbors.clear();
+      for (Eigen::Index idx = 0; idx < this->points.rows(); ++idx) {
+        visit((this->points.row(idx).transpose() - query).squaredNorm(), static_cast<int>(idx));
+      }
+      break;
+    }
+
+    const VoxelKey lower = (center.array() - r).max(this->min_key.array());
+    const VoxelKey upper = (center.array() + r).min(this->max_key.array());
+    for (int x = lower.x(); x <= upper.x(); ++x) {
+      for (int y = lower.y(); y <= upper.y(); ++y) {
+        const bool on_ring = std::abs(x - center.x()) == r || std::abs(y - center.y()) == r;
+        if (on_ring) {
+          for (int z = lower.z(); z <= upper.z(); ++z) visit_voxel(VoxelKey(x, y, z));
+        } else {
+          if (center.z() - r >= lower.z()) visit_voxel(VoxelKey(x, y, center.z() - r));
+          if (r > 0 && center.z() + r <= upper.z()) visit_voxel(VoxelKey(x, y, center.z() + r));
+        }
+      }
+    }
+
+    const double ring_distance = r * this->params.voxel_size;
+    if (neighbors.size() == k && neighbors.front().first <= ring_distance * ring_distance) break;
+  }
+
+  std::sort_heap(neighbors.begin(), neighbors.end());
+}
+
+/* -------------------------------------------------------------------------- */
+
+void LocalMap::search(const Eigen::MatrixX3d &src,
+                      const Eigen::MatrixXd &src_feature,
+                      size_t k,
+                      Correspondences &correspondences,
+                      Executor *executor) const {
+  this->search_points(src, src_feature, k, correspondences, nullptr, executor);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void LocalMap::search(const Eigen::MatrixX3d &src,
+                      const Eigen::MatrixXd &src_feature,
+                      size_t k,
+                      Correspondences &correspondences,
+                      std::vector<double> &squared_distances,
+                      Executor *executor) const {
+  this->search_points(src, src_feature, k, correspondences, &squared_distances, executor);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void LocalMap::search_points(const Eigen::MatrixX3d &src,
+                             const Eigen::MatrixXd &src_feature,
+                             size_t k,
+                             Correspondences &correspondences,
+                             std::vector<double> *squared_distances,
+                             Executor *executor) const {
+  if (src_feature.cols() != 3) {
+    throw std::invalid_argument("Features of a local map must be 3-dimensional points");
+  }
+  if (k > this->get_size()) {
+    throw std::invalid_argument("The number of closest points exceeds the size of the local map");
+  }
+
+  const size_t n_src = src.rows();
+  if (squared_distances != nullptr) squared_distances->resize(n_src * k);
+
+  const size_t n_chunks = (n_src + QUERY_CHUNK_SIZE - 1) / QUERY_CHUNK_SIZE;
+  run_tasks(executor, n_chunks, [&](size_t chunk, size_t) {
+    std::vector<std::pair<double, int>> neighbors;
+    neighbors.reserve(k);
+
+    const size_t begin = chunk * QUERY_CHUNK_SIZE;
+    const size_t end   = std::min(begin + QUERY_CHUNK_SIZE, n_src);
+    for (size_t src_index = begin; src_index < end; ++src_index) {
+      this->search_k_closest_points(src_feature.row(src_index).transpose(), k, neighbors);
+
+      size_t slot = src_index * k;
+      for (size_t i = 0; i < k; ++i, ++slot) {
+        const int dst_index                      = neighbors[i].second;
+        correspondences.points.first.col(slot)  = src.row(src_index).transpose();
+        correspondences.points.second.col(slot) = this->points.row(dst_index).transpose();
+        correspondences.indices.first[slot]     = static_cast<int>(src_index);
+        correspondences.indices.second[slot]    = dst_index;
+        if (squared_distances != nullptr) (*squared_distances)[slot] = neighbors[i].first;
+      }
+    }
+  });
+}
+
+};  // namespace kcp
@@ -0,0 +1,193 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "kcp/odometry.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace kcp {
+
+/* ---------------------------- StreamingOdometry --------------------------- */
+
+StreamingOdometry::StreamingOdometry(const StreamingOdometry::Params &params, Callback callback)
+    : params(params),
+      callback(std::move(callback)),
+      solver(params.kcp),
+      scans(params.queue_capacity),
+      frames(params.queue_capacity),
+      n_pushed(0),
+      n_finished(0),
+      latest_solution(Eigen::Matrix4d::Identity()) {
+  this->keypoint_thread = std::thread(&StreamingOdometry::run_keypoint_stage, this);
+  this->solver_thread   = std::thread(&StreamingOdometry::run_solver_stage, this);
+}
+
+/* -------------------------------------------------------------------------- */
+
+StreamingOdometry::~StreamingOdometry() { this->close(); }
+
+/* -------------------------------------------------------------------------- */
+
+void StreamingOdometry::close() {
+  // The keypoint stage closes the frame queue after draining the scan queue,
+  // so both stages finish the pushed scans before exiting
+  this->scans.close();
+  if (this->keypoint_thread.joinable()) this->keypoint_thread.join();
+  if (this->solver_thread.joinable()) this->solver_thread.join();
+}
+
+/* -------------------------------------------------------------------------- */
+
+size_t StreamingOdometry::push(Eigen::MatrixX3d cloud) {
+  size_t index;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->error) std::rethrow_exception(this->error);
+    index = this->n_pushed++;
+  }
+
+  if (!this->scans.push(Scan{index, std::move(cloud)})) {
+    // The scan is never processed, so flush() must not wait for it
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      --this->n_pushed;
+    }
+    this->finished.notify_all();
+
+    this->rethrow_error();
+    throw std::runtime_error("The streaming odometry is stopped");
+  }
+  return index;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void StreamingOdometry::flush() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->finished.wait(lock, [this] { return this->error || this->n_finished == this->n_pushed; });
+  if (this->error) std::rethrow_exception(this->error);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void StreamingOdometry::fail(std::exception_ptr exception) {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->error) this->error = exception;
+  }
+  this->scans.close();
+  this->frames.close();
+  this->finished.notify_all();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void StreamingOdometry::rethrow_error() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->error) std::rethrow_exception(this->error);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void StreamingOdometry::run_keypoint_stage() {
+  try {
+    std::unique_ptr<keypoint::VoxelSampler> sampler;
+    if (this->params.max_corner_points > 0) {
+      keypoint::VoxelSampler::Params sampler_params;
+      sampler_params.max_points = this->params.max_corner_points;
+      sampler.reset(new keypoint::VoxelSampler(sampler_params));
+    }
+
+    // The range image and the multi-scale curvature are reused across scans,
+    // where the multi-scale curvature swaps its range image with the one
+    // receiving the next scan
+    keypoint::RangeImage range_image(this->params.sensor_model, this->params.hfov_resolution);
+    range_image.set_filter(this->params.filter);
+    std::unique_ptr<keypoint::MultiScaleCurvature> msc_storage;
+
+    Scan scan;
+    while (this->scans.pop(scan)) {
+      // The motion of the scan is taken from the latest solved one, which may
+      // lag behind by a scan as both stages overlap
+      if (this->params.deskew) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        range_image.set_deskew(this->latest_solution, this->params.deskew_layout);
+      }
+      range_image.reset(std::move(scan.cloud));
+
+      if (msc_storage == nullptr) {
+        msc_storage.reset(new keypoint::MultiScaleCurvature(range_image, this->params.keypoint));
+      } else {
+        msc_storage->reset(range_image);
+      }
+      const keypoint::MultiScaleCurvature &msc = *msc_storage;
+      if (sampler) sampler->sample(msc);
+
+      // The kd-tree of corner points is built here, so that the solver stage
+      // only queries it
+      const Eigen::MatrixX3d &corners = sampler ? sampler->get_points() : msc.get_corner_points();
+      Eigen::MatrixX3d corner_points  = corners;
+      Frame frame;
+      frame.index        = scan.index;
+      frame.corner_index = std::make_shared<const TargetIndex>(
+          std::move(corner_points), corners, this->params.kcp.single_precision_features);
+      frame.plane_points = msc.get_plane_points();
+
+      if (!this->frames.push(std::move(frame))) break;
+    }
+  } catch (...) {
+    this->fail(std::current_exception());
+  }
+  this->frames.close();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void StreamingOdometry::run_solver_stage() {
+  try {
+    Frame previous;
+    Frame frame;
+    Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+    while (this->frames.pop(frame)) {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->error) break;
+      }
+
+      Result result;
+      result.index           = frame.index;
+      result.solution        = Eigen::Matrix4d::Identity();
+      result.n_corner_points = frame.corner_index->get_size();
+      result.n_plane_points  = frame.plane_points.rows();
+
+      if (previous.corner_index != nullptr) {
+        const Eigen::MatrixX3d &corner_points = frame.corner_index->get_points();
+        this->solver.solve(corner_points, corner_points, *previous.corner_index);
+        if (this->params.kcp.refinement_iterations > 0) {
+          this->solver.refine(frame.plane_points, previous.plane_points);
+        }
+        result.solution = this->solver.get_solution();
+        pose            = pose * result.solution;
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->latest_solution = result.solution;
+      }
+      result.pose = pose;
+
+      if (this->callback) this->callback(result);
+      previous = std::move(frame);
+
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        ++this->n_finished;
+      }
+      this->finished.notify_all();
+    }
+  } catch (...) {
+    this->fail(std::current_exception());
+  }
+}
+
+};  // namespace kcp
@@ -0,0 +1,133 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "kcp/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace kcp {
+
+/* ------------------------------- ThreadPool ------------------------------- */
+
+struct ThreadPool::Job {
+  const Executor::Task *task;
+  size_t n_tasks;
+  std::atomic<size_t> next_task{0};
+  std::atomic<size_t> n_finished_tasks{0};
+  std::exception_ptr error;
+};
+
+/* -------------------------------------------------------------------------- */
+
+ThreadPool::ThreadPool(size_t n_workers) : stopping(false) {
+  if (n_workers == 0) {
+    n_workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  this->threads.reserve(n_workers - 1);
+  for (size_t worker = 1; worker < n_workers; ++worker) {
+    this->threads.emplace_back(&ThreadPool::work, this, worker);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->job_available.notify_all();
+
+  for (auto &thread : this->threads) thread.join();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ThreadPool::work(size_t worker) {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true) {
+    this->job_available.wait(lock, [this] { return this->stopping || !this->jobs.empty(); });
+    if (this->jobs.empty())
+      return;
+
+    std::shared_ptr<Job> job = this->jobs.front();
+    lock.unlock();
+    this->participate(*job, worker);
+    lock.lock();
+
+    // All tasks of the job are claimed
+    auto iter = std::find(this->jobs.begin(), this->jobs.end(), job);
+    if (iter != this->jobs.end()) this->jobs.erase(iter);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ThreadPool::participate(Job &job, size_t worker) {
+  size_t task_index;
+  while ((task_index = job.next_task.fetch_add(1)) < job.n_tasks) {
+    try {
+      (*job.task)(task_index, worker);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (!job.error) job.error = std::current_exception();
+    }
+
+    if (job.n_finished_tasks.fetch_add(1) + 1 == job.n_tasks) {
+      // Lock before notifying, so that the caller cannot miss the wake-up
+      // between checking the predicate and waiting.
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->job_finished.notify_all();
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ThreadPool::run(size_t n_tasks, const Task &task) {
+  if (n_tasks == 0)
+    return;
+
+  if (this->threads.empty() || n_tasks == 1) {
+    for (size_t task_index = 0; task_index < n_tasks; ++task_index) task(task_index, 0);
+    return;
+  }
+
+  auto job     = std::make_shared<Job>();
+  job->task    = &task;
+  job->n_tasks = n_tasks;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->jobs.push_back(job);
+  }
+  this->job_available.notify_all();
+
+  this->participate(*job, 0);
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+  auto iter = std::find(this->jobs.begin(), this->jobs.end(), job);
+  if (iter != this->jobs.end()) this->jobs.erase(iter);
+
+  this->job_finished.wait(lock, [&job] { return job->n_finished_tasks.load() == job->n_tasks; });
+
+  if (job->error)
+    std::rethrow_exception(job->error);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void run_tasks(Executor *executor, size_t n_tasks, const Executor::Task &task) {
+  if (executor != nullptr && executor->get_n_workers() > 1) {
+    executor->run(n_tasks, task);
+    return;
+  }
+
+  for (size_t task_index = 0; task_index < n_tasks; ++task_index) task(task_index, 0);
+}
+
+};  // namespace kcp
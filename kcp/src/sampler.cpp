@@ -0,0 +1,224 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "kcp/sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace kcp {
+
+namespace keypoint {
+
+namespace {
+
+/**
+ * @brief The number of bits of each voxel coordinate packed into a key.
+ *
+ */
+constexpr int COORDINATE_BITS = 21;
+
+/**
+ * @brief The largest voxel coordinate along an axis.
+ *
+ */
+constexpr uint64_t MAX_COORDINATE = (uint64_t(1) << COORDINATE_BITS) - 1;
+
+/**
+ * @brief The initial exponent of the model of the number of voxels, which is
+ * the inverse square of the voxel size, and the bounds of the estimated one.
+ *
+ */
+constexpr double MODEL_EXPONENT     = 2;
+constexpr double MIN_MODEL_EXPONENT = 0.25;
+constexpr double MAX_MODEL_EXPONENT = 3;
+
+/**
+ * @brief The key of empty slots of the hash table.
+ *
+ */
+constexpr uint64_t EMPTY_KEY = std::numeric_limits<uint64_t>::max();
+
+/**
+ * @brief Get the voxel coordinate of a point along an axis, clamped to the
+ * range of packed coordinates.
+ *
+ */
+inline uint64_t get_coordinate(double value, double origin, double size) {
+  const double coordinate = std::floor((value - origin) / size);
+  return coordinate < static_cast<double>(MAX_COORDINATE) ? static_cast<uint64_t>(coordinate) : MAX_COORDINATE;
+}
+
+};  // namespace
+
+/* ---------------------------- BasicVoxelSampler --------------------------- */
+
+template <typename Scalar>
+BasicVoxelSampler<Scalar>::BasicVoxelSampler(const Params &params) : params(params), voxel_size(0) {
+  if (params.max_points == 0) {
+    throw std::invalid_argument("The maximum number of sampled points must be positive");
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicVoxelSampler<Scalar>::collect_representatives(const CloudMatrix &cloud,
+                                                        const std::vector<float> &scores,
+                                                        const Eigen::Vector3d &origin,
+                                                        double size) {
+  const uint64_t mask = this->slot_keys.size() - 1;
+  std::fill(this->slot_keys.begin(), this->slot_keys.end(), EMPTY_KEY);
+  this->representatives.clear();
+
+  // Points are visited in input order, so ties of scores keep the earliest
+  // point of a voxel
+  for (const int idx : this->valid_indices) {
+    const uint64_t key = (get_coordinate(cloud(idx, 0), origin.x(), size) << (2 * COORDINATE_BITS)) |
+                         (get_coordinate(cloud(idx, 1), origin.y(), size) << COORDINATE_BITS) |
+                         get_coordinate(cloud(idx, 2), origin.z(), size);
+
+    uint64_t slot = ((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    while (this->slot_keys[slot] != EMPTY_KEY && this->slot_keys[slot] != key) slot = (slot + 1) & mask;
+
+    if (this->slot_keys[slot] == EMPTY_KEY) {
+      this->slot_keys[slot]   = key;
+      this->slot_voxels[slot] = static_cast<int>(this->representatives.size());
+      this->representatives.push_back(idx);
+    } else if (!scores.empty()) {
+      int &representative = this->representatives[this->slot_voxels[slot]];
+      if (scores[idx] > scores[representative]) representative = idx;
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void BasicVoxelSampler<Scalar>::sample(const CloudMatrix &cloud, const std::vector<float> &scores) {
+  if (!scores.empty() && scores.size() != static_cast<size_t>(cloud.rows())) {
+    throw std::invalid_argument("Mismatching sizes of points and scores");
+  }
+
+  this->profile          = Profile();
+  this->profile.n_points = cloud.rows();
+  ScopedTimer timer(this->profile.sampling_time);
+
+  const size_t max_points = this->params.max_points;
+
+  // Gather finite points and their bounding box
+  Eigen::Vector3d lower = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+  Eigen::Vector3d upper = -lower;
+  this->valid_indices.clear();
+  for (Eigen::Index idx = 0; idx < cloud.rows(); ++idx) {
+    if (!cloud.row(idx).allFinite()) continue;
+    const Eigen::Vector3d point = cloud.row(idx).transpose().template cast<double>();
+    lower                       = lower.cwiseMin(point);
+    upper                       = upper.cwiseMax(point);
+    this->valid_indices.push_back(static_cast<int>(idx));
+  }
+
+  // Without any size tried, all finite points are the representatives
+  this->voxel_size = 0;
+  this->best_representatives.assign(this->valid_indices.begin(), this->valid_indices.end());
+  this->profile.n_voxels = this->valid_indices.size();
+
+  const double extent = this->valid_indices.empty() ? 0 : (upper - lower).maxCoeff();
+  if (this->valid_indices.size() > max_points * (1 + this->params.tolerance) && extent > 0) {
+    size_t capacity = 1;
+    while (capacity < 2 * this->valid_indices.size()) capacity <<= 1;
+    this->slot_keys.resize(capacity);
+    this->slot_voxels.resize(capacity);
+
+    // The number of voxels is modeled as a power of the voxel size, whose
+    // exponent is estimated from the latest two sizes (starting from -2 as
+    // LiDAR keypoints lie on surfaces). The model proposes the next size, which
+    // is replaced by bisecting the bracket if it falls outside. Sizes are
+    // bounded so that coordinates fit into keys
+    const double target   = max_points * (1 + this->params.tolerance / 2);
+    const double min_size = extent / MAX_COORDINATE;
+    double lower_size     = 0;
+    double upper_size     = std::numeric_limits<double>::infinity();
+    double size           = extent / std::sqrt(static_cast<double>(max_points));
+    double exponent       = MODEL_EXPONENT;
+    double previous_size = 0, previous_n_voxels = 0;
+    for (int iteration = 0; iteration < this->params.max_iterations; ++iteration) {
+      size = std::max(size, min_size);
+      this->collect_representatives(cloud, scores, lower, size);
+      ++this->profile.n_iterations;
+
+      const size_t n_voxels = this->representatives.size();
+      if (n_voxels >= max_points) {
+        lower_size             = size;
+        this->voxel_size       = size;
+        this->profile.n_voxels = n_voxels;
+        this->best_representatives.swap(this->representatives);
+        if (n_voxels <= max_points * (1 + this->params.tolerance)) break;
+      } else {
+        upper_size = size;
+      }
+
+      if (previous_size > 0 && previous_size != size && previous_n_voxels != n_voxels) {
+        exponent = std::log(previous_n_voxels / n_voxels) / std::log(size / previous_size);
+        exponent = std::min(std::max(exponent, MIN_MODEL_EXPONENT), MAX_MODEL_EXPONENT);
+      }
+      previous_size     = size;
+      previous_n_voxels = n_voxels;
+
+      size *= std::pow(n_voxels / target, 1 / exponent);
+      if (!(size > lower_size && size < upper_size)) {
+        if (lower_size == 0) {
+          size = upper_size / 2;
+        } else if (std::isinf(upper_size)) {
+          size = lower_size * 2;
+        } else {
+          size = std::sqrt(lower_size * upper_size);
+        }
+      }
+    }
+  }
+
+  // Drop the lowest scored representatives, or evenly drop them without
+  // scores
+  std::vector<int> &selected = this->best_representatives;
+  if (selected.size() > max_points) {
+    if (!scores.empty()) {
+      std::nth_element(selected.begin(), selected.begin() + max_points, selected.end(), [&](int lhs, int rhs) {
+        return scores[lhs] != scores[rhs] ? scores[lhs] > scores[rhs] : lhs < rhs;
+      });
+    } else {
+      const size_t n_voxels = selected.size();
+      for (size_t idx = 0; idx < max_points; ++idx) selected[idx] = selected[idx * n_voxels / max_points];
+    }
+    selected.resize(max_points);
+  }
+
+  // Restore the input order by marking selected points in the buffer of
+  // representatives
+  this->representatives.assign(cloud.rows(), 0);
+  for (const int idx : selected) this->representatives[idx] = 1;
+
+  this->indices.clear();
+  for (Eigen::Index idx = 0; idx < cloud.rows(); ++idx) {
+    if (this->representatives[idx]) this->indices.push_back(static_cast<int>(idx));
+  }
+
+  this->points.resize(this->indices.size(), 3);
+  for (size_t idx = 0; idx < this->indices.size(); ++idx) {
+    this->points.row(idx) = cloud.row(this->indices[idx]);
+  }
+
+  this->profile.n_sampled_points = this->indices.size();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template class BasicVoxelSampler<double>;
+template class BasicVoxelSampler<float>;
+
+};  // namespace keypoint
+
+};  // namespace kcp
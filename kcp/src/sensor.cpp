@@ -0,0 +1,81 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "kcp/sensor.hpp"
+#include "kcp/utility.hpp"
+
+#include <fstream>
+#include <sstream>
+
+namespace kcp {
+
+/* ------------------------------- SensorModel ------------------------------ */
+
+SensorModel::SensorModel(std::vector<float> elevations_deg)
+    : elevations_deg(std::move(elevations_deg)) {
+  if (this->elevations_deg.empty()) {
+    throw std::invalid_argument("SensorModel requires at least one channel");
+  }
+  for (const auto &elevation : this->elevations_deg) {
+    if (!(elevation > -90 && elevation < 90)) {
+      throw std::invalid_argument("Elevation angles of SensorModel must be in (-90, 90) degrees");
+    }
+  }
+
+  std::sort(this->elevations_deg.begin(), this->elevations_deg.end());
+
+  this->boundary_slopes.reserve(this->elevations_deg.size() - 1);
+  for (size_t i = 1; i < this->elevations_deg.size(); ++i) {
+    double boundary = (static_cast<double>(this->elevations_deg[i - 1]) + this->elevations_deg[i]) / 2;
+    this->boundary_slopes.push_back(std::tan(deg2red(boundary)));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+SensorModel SensorModel::uniform(int n_channels, float min_vfov_deg, float max_vfov_deg) {
+  if (n_channels <= 0) {
+    throw std::invalid_argument("SensorModel requires at least one channel");
+  }
+
+  double delta = (static_cast<double>(max_vfov_deg) - min_vfov_deg) / n_channels;
+  std::vector<float> elevations_deg(n_channels);
+  for (int i = 0; i < n_channels; ++i) {
+    elevations_deg[i] = static_cast<float>(min_vfov_deg + (i + 0.5) * delta);
+  }
+  SensorModel sensor_model(std::move(elevations_deg));
+
+  // Use the exact boundaries instead of the (rounded) middle of two centers
+  for (int i = 1; i < n_channels; ++i) {
+    sensor_model.boundary_slopes[i - 1] = std::tan(deg2red(min_vfov_deg + i * delta));
+  }
+  return sensor_model;
+}
+
+/* -------------------------------------------------------------------------- */
+
+SensorModel SensorModel::from_file(const std::string &filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Cannot open the sensor model file: " + filename);
+  }
+
+  std::vector<float> elevations_deg;
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream stream(line.substr(0, line.find('#')));
+    std::string token;
+    while (stream >> token) {
+      try {
+        elevations_deg.push_back(std::stof(token));
+      } catch (const std::exception &) {
+        throw std::runtime_error("Invalid elevation angle \"" + token + "\" in " + filename);
+      }
+    }
+  }
+
+  return SensorModel(std::move(elevations_deg));
+}
+
+};  // namespace kcp
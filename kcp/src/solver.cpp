@@ -5,32 +5,378 @@
 #include "kcp/solver.hpp"
 #include "kcp/utility.hpp"
 
+#include <Eigen/Eigenvalues>
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
 
 namespace kcp {
 
+namespace {
+
+/**
+ * @brief The number of sampled pairs to estimate the density of the pairwise
+ * consistency graph.
+ *
+ */
+constexpr size_t N_DENSITY_SAMPLES = 1000;
+
+/**
+ * @brief The refinement stops when the norm of the update is below it.
+ *
+ */
+constexpr double REFINEMENT_CONVERGENCE_THRESHOLD = 1e-8;
+
+/**
+ * @brief Get the skew-symmetric matrix of a vector, i.e., ``skew(a) * b`` is
+ * the cross product of ``a`` and ``b``.
+ *
+ */
+Eigen::Matrix3d skew(const Eigen::Vector3d& v) {
+  Eigen::Matrix3d m;
+  m << 0, -v.z(), v.y(), v.z(), 0, -v.x(), -v.y(), v.x(), 0;
+  return m;
+}
+
+/**
+ * @brief The number of active OutputMute objects of the current thread.
+ *
+ */
+thread_local int n_output_mutes = 0;
+
+/**
+ * @brief A stream buffer forwarding output to another buffer, unless the
+ * writing thread is muted. It buffers nothing by itself, so it is as
+ * thread-safe as the forwarded buffer.
+ *
+ */
+class MutableStreamBuffer : public std::streambuf {
+ protected:
+  std::streambuf* target;
+
+  int_type overflow(int_type c) override {
+    if (n_output_mutes > 0 || traits_type::eq_int_type(c, traits_type::eof()))
+      return traits_type::not_eof(c);
+    return this->target->sputc(traits_type::to_char_type(c));
+  }
+
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    if (n_output_mutes > 0)
+      return n;
+    return this->target->sputn(s, n);
+  }
+
+  int sync() override { return this->target->pubsync(); }
+
+ public:
+  explicit MutableStreamBuffer(std::streambuf* target) : target(target) {}
+};
+
+/**
+ * @brief Drop messages written to ``std::cout`` by the current thread within
+ * the scope if it is active and the output filter is installed. Unlike setting
+ * the failbit of ``std::cout``, other threads keep their output.
+ *
+ */
+class OutputMute {
+ protected:
+  bool active;
+
+ public:
+  explicit OutputMute(bool active) : active(active) {
+    if (this->active) ++n_output_mutes;
+  }
+
+  ~OutputMute() {
+    if (this->active) --n_output_mutes;
+  }
+
+  OutputMute(const OutputMute&) = delete;
+  OutputMute& operator=(const OutputMute&) = delete;
+};
+
+};  // namespace
+
+/* -------------------------------------------------------------------------- */
+
+void install_output_filter() {
+  // The buffer is never freed, since std::cout may still use it at exit
+  static std::once_flag flag;
+  std::call_once(flag, [] {
+    std::streambuf* buffer = std::cout.rdbuf();
+    if (buffer != nullptr) std::cout.rdbuf(new MutableStreamBuffer(buffer));
+  });
+}
+
+/* -------------------------------------------------------------------------- */
+
+KCP::KCP(KCP::Params params)
+    : solver(params.teaser), params(params), heuristic_clique_active(false), builtin_clique_active(false) {
+  if (!this->params.verbose) install_output_filter();
+}
+
 /* ----------------------------------- KCP ---------------------------------- */
 
+Executor* KCP::get_executor() {
+  if (this->params.executor != nullptr)
+    return this->params.executor.get();
+  if (this->params.n_threads == 1)
+    return nullptr;
+
+  const size_t n_workers = this->params.n_threads > 0 ? this->params.n_threads : std::thread::hardware_concurrency();
+  if (this->thread_pool == nullptr || this->thread_pool->get_n_workers() != std::max<size_t>(1, n_workers)) {
+    this->thread_pool = std::make_shared<ThreadPool>(n_workers);
+  }
+  return this->thread_pool.get();
+}
+
+/* -------------------------------------------------------------------------- */
+
 void KCP::solve(const Eigen::MatrixX3d& src,
                 const Eigen::MatrixX3d& dst,
                 const Eigen::MatrixXd& src_feature,
                 const Eigen::MatrixXd& dst_feature) {
-  // Generate initial guess of correspondences with k closest points
-  auto correspondences = get_kcp_correspondences(src,
-                                                 dst,
-                                                 src_feature,
-                                                 dst_feature,
-                                                 this->params.k);
-
-  // Store the initial k closest points correspondences
-  this->initial_correspondences = *correspondences;
-
-  // Trigger the TEASER++ solver, where the maximum clique pruning will be
-  // executed within the solver
-  if (!this->params.verbose) std::cout.setstate(std::ios_base::failbit);
-  this->solver.solve(correspondences->points.first,
-                     correspondences->points.second);
-  if (!this->params.verbose) std::cout.clear();
+  // Reuse the kd-tree of the previous target if it is identical
+  this->profile = KCP::Profile();
+
+  const bool single_precision = this->params.single_precision_features;
+  if (this->target_index != nullptr && this->target_index->matches(dst, dst_feature, single_precision)) {
+    ++this->target_index_counters.hits;
+  } else {
+    ScopedTimer timer(this->profile.index_time);
+
+    // Release the previous index before building the new one
+    this->target_index.reset();
+    this->target_index = std::make_shared<const TargetIndex>(dst, dst_feature, single_precision);
+    ++this->target_index_counters.misses;
+  }
+
+  this->find_correspondences(src, src_feature, *this->target_index);
+  this->solve_initial_correspondences();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void KCP::solve(const Eigen::MatrixX3d& src, const Eigen::MatrixXd& src_feature, const Target& dst) {
+  this->profile = KCP::Profile();
+
+  this->find_correspondences(src, src_feature, dst);
+  this->solve_initial_correspondences();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void KCP::solve(const Eigen::MatrixX3f& src,
+                const Eigen::MatrixX3f& dst,
+                const Eigen::MatrixXf& src_feature,
+                const Eigen::MatrixXf& dst_feature) {
+  // Reuse the kd-tree of the previous target if it is identical
+  this->profile = KCP::Profile();
+
+  if (this->target_index != nullptr && this->target_index->matches(dst, dst_feature)) {
+    ++this->target_index_counters.hits;
+  } else {
+    ScopedTimer timer(this->profile.index_time);
+
+    // Release the previous index before building the new one
+    this->target_index.reset();
+    this->target_index = std::make_shared<const TargetIndex>(dst, dst_feature);
+    ++this->target_index_counters.misses;
+  }
+
+  this->find_correspondences(src, src_feature, *this->target_index);
+  this->solve_initial_correspondences();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void KCP::solve(const Eigen::MatrixX3f& src, const Eigen::MatrixXf& src_feature, const Target& dst) {
+  this->profile = KCP::Profile();
+
+  this->find_correspondences(src, src_feature, dst);
+  this->solve_initial_correspondences();
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename Scalar>
+void KCP::find_correspondences(const Eigen::Matrix<Scalar, Eigen::Dynamic, 3>& src,
+                               const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>& src_feature,
+                               const Target& dst) {
+  ScopedTimer timer(this->profile.correspondence_time);
+
+  Correspondences& correspondences = this->initial_correspondences;
+  KCP::BudgetReport& report        = this->budget_report;
+
+  const size_t n_src = src.rows();
+  size_t k           = MIN(this->params.k, dst.get_size());
+
+  // The budget only depends on the sizes, so it is planned before the search
+  // and the correspondences are generated at their final size
+  report              = KCP::BudgetReport();
+  report.n_candidates = n_src * k;
+
+  const size_t budget = this->params.max_correspondences;
+  if (budget > 0 && report.n_candidates > budget) {
+    // Closest points of each source point are sorted by feature distances, so
+    // lowering k keeps the best candidates of each source point
+    const size_t reduced_k = std::max<size_t>(1, budget / n_src);
+    if (reduced_k < k) {
+      k                = reduced_k;
+      report.reduced_k = true;
+    }
+
+    // Even one correspondence per source point may exceed the budget
+    report.subsampled = n_src * k > budget;
+  }
+
+  // Generate initial guess of correspondences with k closest points, which
+  // are stored as the initial k closest points correspondences
+  if (!report.subsampled) {
+    get_kcp_correspondences(src, src_feature, dst, k, correspondences, this->get_executor());
+  } else {
+    // Only one closest point of each source point is left (k = 1). Source
+    // points whose closest features are the nearest are kept, and the kept
+    // correspondences stay in the order of source points
+    std::vector<double>& distances = this->candidate_distances;
+    std::vector<int>& order        = this->candidate_order;
+    correspondences.points.first.resize(3, n_src);
+    correspondences.points.second.resize(3, n_src);
+    correspondences.indices.first.resize(n_src);
+    correspondences.indices.second.resize(n_src);
+    dst.search(src, src_feature, 1, correspondences, distances, this->get_executor());
+
+    order.resize(n_src);
+    std::iota(order.begin(), order.end(), 0);
+    std::nth_element(order.begin(), order.begin() + budget, order.end(), [&](int lhs, int rhs) {
+      return distances[lhs] != distances[rhs] ? distances[lhs] < distances[rhs] : lhs < rhs;
+    });
+    order.resize(budget);
+    std::sort(order.begin(), order.end());
+
+    // Compact the kept correspondences in place, where order[i] >= i
+    for (size_t i = 0; i < budget; ++i) {
+      const int idx = order[i];
+      correspondences.points.first.col(i)  = correspondences.points.first.col(idx);
+      correspondences.points.second.col(i) = correspondences.points.second.col(idx);
+      correspondences.indices.first[i]     = correspondences.indices.first[idx];
+      correspondences.indices.second[i]    = correspondences.indices.second[idx];
+    }
+    correspondences.points.first.conservativeResize(3, budget);
+    correspondences.points.second.conservativeResize(3, budget);
+    correspondences.indices.first.resize(budget);
+    correspondences.indices.second.resize(budget);
+  }
+
+  report.k                 = k;
+  report.n_correspondences = correspondences.indices.first.size();
+  const size_t size        = report.n_correspondences;
+
+  // Estimate the density of the pairwise consistency graph by sampling pairs
+  // of correspondences, where two correspondences are consistent if they
+  // preserve the distance within the noise bound (as in TEASER++)
+  const TEASER::Params& teaser = this->params.teaser;
+  if (this->params.max_clique_density < 1 && teaser.use_max_clique && teaser.max_clique_exact_solution && size >= 2) {
+    const double bound = 2 * teaser.noise_bound * std::sqrt(teaser.cbar2);
+
+    std::mt19937 generator(0);
+    std::uniform_int_distribution<size_t> distribution(0, size - 1);
+
+    size_t n_edges = 0;
+    for (size_t sample = 0; sample < N_DENSITY_SAMPLES; ++sample) {
+      const size_t i = distribution(generator);
+      size_t j;
+      do {
+        j = distribution(generator);
+      } while (j == i);
+
+      const double src_distance = (correspondences.points.first.col(i) - correspondences.points.first.col(j)).norm();
+      const double dst_distance = (correspondences.points.second.col(i) - correspondences.points.second.col(j)).norm();
+      if (std::abs(src_distance - dst_distance) <= bound) ++n_edges;
+    }
+
+    report.estimated_density = static_cast<double>(n_edges) / N_DENSITY_SAMPLES;
+    report.heuristic_clique  = report.estimated_density > this->params.max_clique_density;
+  }
+
+  this->profile.n_src_points      = n_src;
+  this->profile.n_dst_points      = dst.get_size();
+  this->profile.n_correspondences = size;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void KCP::solve_initial_correspondences() {
+  const TEASER::Params& teaser = this->params.teaser;
+  const bool builtin_clique    = teaser.use_max_clique && this->params.max_clique_backend == KCP::MaxCliqueBackend::BUILTIN;
+  const bool heuristic_clique  = this->budget_report.heuristic_clique && !builtin_clique;
+
+  // Reconfigure the TEASER++ solver if the density fallback or the backend
+  // changes. With the built-in backend, TEASER++ only receives the inliers
+  // and skips its own maximum clique pruning
+  if (heuristic_clique != this->heuristic_clique_active || builtin_clique != this->builtin_clique_active) {
+    TEASER::Params teaser_params = teaser;
+    if (heuristic_clique) teaser_params.max_clique_exact_solution = false;
+    if (builtin_clique) teaser_params.use_max_clique = false;
+    this->solver.reset(teaser_params);
+    this->heuristic_clique_active = heuristic_clique;
+    this->builtin_clique_active   = builtin_clique;
+  }
+
+  ScopedTimer timer(this->profile.registration_time);
+
+  if (!builtin_clique) {
+    // Trigger the TEASER++ solver, where the maximum clique pruning will be
+    // executed within the solver
+    {
+      OutputMute mute(!this->params.verbose);
+      this->solver.solve(this->initial_correspondences.points.first,
+                         this->initial_correspondences.points.second);
+    }
+
+    // Store the inlier correspondence indices provided by the maximum clique
+    // pruning algorithm
+    this->inlier_correspondence_indices = this->solver.getInlierMaxClique();
+  } else {
+    {
+      ScopedTimer clique_timer(this->profile.clique_time);
+      const bool exact = teaser.max_clique_exact_solution && !this->budget_report.heuristic_clique;
+      this->consistency_graph.build(this->initial_correspondences,
+                                    2 * teaser.noise_bound * std::sqrt(teaser.cbar2),
+                                    this->get_executor(),
+                                    this->params.exclude_same_source);
+      this->inlier_correspondence_indices =
+          find_max_clique(this->consistency_graph, exact, this->get_executor(), teaser.max_clique_time_limit);
+    }
+
+    // As in TEASER++, no transformation is estimated from less than two
+    // inliers
+    const auto& indices = this->inlier_correspondence_indices;
+    if (indices.size() < 2) {
+      this->solution          = Eigen::Matrix4d::Identity();
+      this->profile.n_inliers = indices.size();
+      return;
+    }
+
+    Eigen::Matrix3Xd& inlier_src = this->inlier_correspondences.points.first;
+    Eigen::Matrix3Xd& inlier_dst = this->inlier_correspondences.points.second;
+    inlier_src.resize(3, indices.size());
+    inlier_dst.resize(3, indices.size());
+    for (size_t idx = 0; idx < indices.size(); ++idx) {
+      inlier_src.col(idx) = this->initial_correspondences.points.first.col(indices[idx]);
+      inlier_dst.col(idx) = this->initial_correspondences.points.second.col(indices[idx]);
+    }
+
+    OutputMute mute(!this->params.verbose);
+    this->solver.solve(inlier_src, inlier_dst);
+  }
 
   // Extract the estimation result
   auto solution                    = this->solver.getSolution();
@@ -38,9 +384,213 @@ void KCP::solve(const Eigen::MatrixX3d& src,
   this->solution.block<3, 3>(0, 0) = solution.rotation;
   this->solution.block<3, 1>(0, 3) = solution.translation;
 
-  // Store the inlier correspondence indices provided by the maximum clique
-  // pruning algorithm
-  this->inlier_correspondence_indices = this->solver.getInlierMaxClique();
+  this->profile.n_inliers = this->inlier_correspondence_indices.size();
+}
+
+void KCP::solve(const Eigen::MatrixX3d& src,
+                const Eigen::MatrixX3d& dst,
+                const Eigen::MatrixXd& src_feature,
+                const Eigen::MatrixXd& dst_feature,
+                const Eigen::MatrixX3d& src_plane_points,
+                const Eigen::MatrixX3d& dst_plane_points) {
+  this->solve(src, dst, src_feature, dst_feature);
+  this->refine(src_plane_points, dst_plane_points);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int KCP::refine(const Eigen::MatrixX3d& src_plane_points, const Eigen::MatrixX3d& dst_plane_points) {
+  this->profile.n_refinement_iterations = 0;
+  this->profile.refinement_time         = 0;
+
+  const int max_iterations = this->params.refinement_iterations;
+  if (max_iterations <= 0 || src_plane_points.rows() == 0 || dst_plane_points.rows() < 3)
+    return 0;
+
+  ScopedTimer timer(this->profile.refinement_time);
+
+  Executor* executor = this->get_executor();
+
+  // Build the kd-tree and the normals of target plane points, unless they are
+  // identical to the previous ones
+  if (this->plane_index == nullptr || !this->plane_index->matches(dst_plane_points, dst_plane_points, false)) {
+    this->plane_index.reset();
+    this->plane_index = std::make_shared<const TargetIndex>(dst_plane_points, dst_plane_points);
+
+    const size_t n_neighbors = MIN(MAX(this->params.refinement_normal_neighbors, size_t(3)),
+                                   static_cast<size_t>(dst_plane_points.rows()));
+    get_kcp_correspondences(dst_plane_points,
+                            dst_plane_points,
+                            *this->plane_index,
+                            n_neighbors,
+                            this->plane_correspondences,
+                            executor);
+
+    // The normal is the direction of the least variance of neighbors, which is
+    // only kept if the neighbors spread on a plane rather than a line
+    this->plane_normals.setZero(dst_plane_points.rows(), 3);
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen_solver;
+    for (Eigen::Index idx = 0; idx < dst_plane_points.rows(); ++idx) {
+      const auto neighbors            = this->plane_correspondences.points.second.middleCols(idx * n_neighbors, n_neighbors);
+      const Eigen::Vector3d mean      = neighbors.rowwise().mean();
+      const Eigen::Matrix3Xd centered = neighbors.colwise() - mean;
+      eigen_solver.computeDirect(centered * centered.transpose());
+
+      const Eigen::Vector3d& eigenvalues = eigen_solver.eigenvalues();
+      if (eigenvalues(0) < 0.3 * eigenvalues(1)) {
+        this->plane_normals.row(idx) = eigen_solver.eigenvectors().col(0).transpose();
+      }
+    }
+  }
+
+  const Eigen::Matrix3Xd& inlier_src = this->initial_correspondences.points.first;
+  const Eigen::Matrix3Xd& inlier_dst = this->initial_correspondences.points.second;
+  const double max_squared_distance  = this->params.refinement_max_distance * this->params.refinement_max_distance;
+
+  Eigen::Matrix4d estimate = this->solution;
+  int iteration            = 0;
+  while (iteration < max_iterations) {
+    const Eigen::Matrix3d rotation    = estimate.block<3, 3>(0, 0);
+    const Eigen::Vector3d translation = estimate.block<3, 1>(0, 3);
+
+    // Find the closest target plane point of each transformed source plane
+    // point
+    this->transformed_plane_points = (src_plane_points * rotation.transpose()).rowwise() + translation.transpose();
+    get_kcp_correspondences(this->transformed_plane_points,
+                            this->transformed_plane_points,
+                            *this->plane_index,
+                            1,
+                            this->plane_correspondences,
+                            executor);
+
+    // Accumulate the normal equation of the left perturbation (rotation,
+    // translation) of the estimate
+    Eigen::Matrix<double, 6, 6> hessian  = Eigen::Matrix<double, 6, 6>::Zero();
+    Eigen::Matrix<double, 6, 1> gradient = Eigen::Matrix<double, 6, 1>::Zero();
+    size_t n_residuals                   = 0;
+
+    for (size_t slot = 0; slot < this->plane_correspondences.indices.first.size(); ++slot) {
+      const Eigen::Vector3d point  = this->plane_correspondences.points.first.col(slot);
+      const Eigen::Vector3d target = this->plane_correspondences.points.second.col(slot);
+      const Eigen::Vector3d normal = this->plane_normals.row(this->plane_correspondences.indices.second[slot]);
+      if (normal.isZero() || (point - target).squaredNorm() > max_squared_distance) continue;
+
+      Eigen::Matrix<double, 6, 1> jacobian;
+      jacobian << point.cross(normal), normal;
+      const double residual = normal.dot(point - target);
+      hessian += jacobian * jacobian.transpose();
+      gradient += jacobian * residual;
+      ++n_residuals;
+    }
+
+    for (const int idx : this->inlier_correspondence_indices) {
+      const Eigen::Vector3d point = rotation * inlier_src.col(idx) + translation;
+
+      Eigen::Matrix<double, 3, 6> jacobian;
+      jacobian << -skew(point), Eigen::Matrix3d::Identity();
+      const Eigen::Vector3d residual = point - inlier_dst.col(idx);
+      hessian += jacobian.transpose() * jacobian;
+      gradient += jacobian.transpose() * residual;
+      n_residuals += 3;
+    }
+
+    if (n_residuals < 6)
+      break;
+
+    const Eigen::Matrix<double, 6, 1> update = hessian.ldlt().solve(-gradient);
+    if (!update.allFinite())
+      break;
+
+    ++iteration;
+
+    Eigen::Matrix4d increment = Eigen::Matrix4d::Identity();
+    const double angle        = update.head<3>().norm();
+    if (angle > 0) {
+      increment.block<3, 3>(0, 0) = Eigen::AngleAxisd(angle, update.head<3>() / angle).toRotationMatrix();
+    }
+    increment.block<3, 1>(0, 3) = update.tail<3>();
+    estimate                    = increment * estimate;
+
+    if (update.norm() < REFINEMENT_CONVERGENCE_THRESHOLD)
+      break;
+  }
+
+  this->solution                        = estimate;
+  this->profile.n_refinement_iterations = iteration;
+  return iteration;
+}
+
+/* ------------------------------ SequentialKCP ----------------------------- */
+
+bool SequentialKCP::push(Eigen::MatrixX3d points, const Eigen::MatrixXd& features) {
+  auto index = std::make_shared<const TargetIndex>(std::move(points),
+                                                   features,
+                                                   this->solver.get_params().single_precision_features);
+
+  const bool registered = this->previous_index != nullptr;
+  if (registered) {
+    this->solver.solve(index->get_points(), features, *this->previous_index);
+    this->pose = this->pose * this->solver.get_solution();
+  }
+
+  this->previous_index = std::move(index);
+  return registered;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void SequentialKCP::reset() {
+  this->previous_index.reset();
+  this->pose = Eigen::Matrix4d::Identity();
+}
+
+/* -------------------------------- BatchKCP -------------------------------- */
+
+BatchKCP::BatchKCP(KCP::Params params) : params(params) {
+  if (this->params.executor == nullptr && this->params.n_threads != 1) {
+    // As in KCP::get_executor, a non-positive number of threads means the
+    // number of hardware threads
+    this->thread_pool = std::make_shared<ThreadPool>(static_cast<size_t>(std::max(0, this->params.n_threads)));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+size_t BatchKCP::get_n_workers() const {
+  if (this->params.executor != nullptr)
+    return this->params.executor->get_n_workers();
+  return this->thread_pool != nullptr ? this->thread_pool->get_n_workers() : 1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::vector<BatchKCP::Result> BatchKCP::solve(const std::vector<BatchKCP::Job>& jobs) {
+  Executor* executor = this->params.executor != nullptr ? this->params.executor.get() : this->thread_pool.get();
+  this->solvers.resize(std::max(this->solvers.size(), this->get_n_workers()));
+
+  // Solvers of workers are single-threaded
+  KCP::Params solver_params = this->params;
+  solver_params.n_threads   = 1;
+  solver_params.executor    = nullptr;
+
+  std::vector<BatchKCP::Result> results(jobs.size());
+  run_tasks(executor, jobs.size(), [&](size_t index, size_t worker) {
+    auto& solver = this->solvers[worker];
+    if (solver == nullptr) solver.reset(new KCP(solver_params));
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto& job  = jobs[index];
+    solver->solve(job.src, job.dst, job.src_feature, job.dst_feature);
+
+    auto& result             = results[index];
+    result.solution          = solver->get_solution();
+    result.n_correspondences = solver->get_initial_correspondences().indices.first.size();
+    result.n_inliers         = solver->get_inlier_correspondence_indices().size();
+    result.profile           = solver->get_profile();
+    result.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  });
+
+  return results;
 }
 
 };  // namespace kcp
\ No newline at end of file
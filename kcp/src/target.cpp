@@ -0,0 +1,431 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "kcp/target.hpp"
+
+#include <algorithm>
+#include <nanoflann.hpp>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace kcp {
+
+namespace {
+
+/**
+ * @brief Feature cloud stored in row-major order, so that the feature of a
+ * point is contiguous for both the kd-tree and the queries.
+ *
+ * @tparam Scalar The scalar type of features.
+ */
+template <typename Scalar>
+struct RowMajorFeatureCloud {
+  using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  Matrix features;
+
+  size_t kdtree_get_point_count() const { return this->features.rows(); }
+
+  Scalar kdtree_get_pt(const size_t idx, const size_t dim) const { return this->features(idx, dim); }
+
+  template <class BBox>
+  bool kdtree_get_bbox(BBox&) const { return false; }
+};
+
+template <typename Scalar>
+using FeatureTree = nanoflann::KDTreeSingleIndexAdaptor<
+    nanoflann::L2_Simple_Adaptor<Scalar, RowMajorFeatureCloud<Scalar>, Scalar, size_t>,
+    RowMajorFeatureCloud<Scalar>,
+    -1,
+    size_t>;
+
+/**
+ * @brief The number of source points queried by a task.
+ *
+ */
+constexpr size_t QUERY_CHUNK_SIZE = 256;
+
+/**
+ * @brief Buffers owned by a worker of a query.
+ *
+ * @tparam Scalar The scalar type of features.
+ */
+template <typename Scalar>
+struct QueryWorkspace {
+  /**
+   * @brief The feature of the queried point, which is only gathered if the
+   * source feature is not a contiguous row in the precision of the tree.
+   *
+   */
+  std::vector<Scalar> query;
+
+  /**
+   * @brief Indices of the k closest points.
+   *
+   */
+  std::vector<size_t> indices;
+
+  /**
+   * @brief Squared distances of the k closest points.
+   *
+   */
+  std::vector<Scalar> distances;
+};
+
+};  // namespace
+
+/* --------------------------------- Target --------------------------------- */
+
+void Target::search(const Eigen::MatrixX3f& src,
+                    const Eigen::MatrixXf& src_feature,
+                    size_t k,
+                    Correspondences& correspondences,
+                    Executor* executor) const {
+  this->search(Eigen::MatrixX3d(src.cast<double>()),
+               Eigen::MatrixXd(src_feature.cast<double>()),
+               k,
+               correspondences,
+               executor);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void Target::search(const Eigen::MatrixX3d& src,
+                    const Eigen::MatrixXd& src_feature,
+                    size_t k,
+                    Correspondences& correspondences,
+                    std::vector<double>& squared_distances,
+                    Executor* executor) const {
+  this->search(src, src_feature, k, correspondences, executor);
+  squared_distances.assign(src.rows() * k, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void Target::search(const Eigen::MatrixX3f& src,
+                    const Eigen::MatrixXf& src_feature,
+                    size_t k,
+                    Correspondences& correspondences,
+                    std::vector<double>& squared_distances,
+                    Executor* executor) const {
+  this->search(Eigen::MatrixX3d(src.cast<double>()),
+               Eigen::MatrixXd(src_feature.cast<double>()),
+               k,
+               correspondences,
+               squared_distances,
+               executor);
+}
+
+/* ------------------------------- TargetIndex ------------------------------ */
+
+struct TargetIndex::Impl {
+  virtual ~Impl() = default;
+
+  virtual int get_feature_dim() const = 0;
+
+  virtual bool is_single_precision() const = 0;
+
+  virtual bool matches(const Eigen::MatrixXd& features) const = 0;
+
+  virtual bool matches(const Eigen::MatrixXf& features) const = 0;
+
+  virtual void search(const Eigen::MatrixX3d& src,
+                      const Eigen::MatrixXd& src_feature,
+                      const Eigen::MatrixX3d& dst,
+                      size_t k,
+                      Correspondences& correspondences,
+                      std::vector<double>* squared_distances,
+                      Executor* executor) const = 0;
+
+  virtual void search(const Eigen::MatrixX3f& src,
+                      const Eigen::MatrixXf& src_feature,
+                      const Eigen::MatrixX3d& dst,
+                      size_t k,
+                      Correspondences& correspondences,
+                      std::vector<double>* squared_distances,
+                      Executor* executor) const = 0;
+
+  virtual void search(const Eigen::MatrixX3d& src,
+                      const TargetIndex::FeatureView& src_feature,
+                      const Eigen::MatrixX3d& dst,
+                      size_t k,
+                      Correspondences& correspondences,
+                      std::vector<double>* squared_distances,
+                      Executor* executor) const = 0;
+
+  virtual void search(const Eigen::MatrixX3f& src,
+                      const TargetIndex::FeatureViewF& src_feature,
+                      const Eigen::MatrixX3d& dst,
+                      size_t k,
+                      Correspondences& correspondences,
+                      std::vector<double>* squared_distances,
+                      Executor* executor) const = 0;
+};
+
+namespace {
+
+template <typename Scalar>
+struct FeatureTreeImpl : public TargetIndex::Impl {
+  RowMajorFeatureCloud<Scalar> cloud;
+
+  // The tree refers to the cloud, so it is declared (and constructed) after
+  // the cloud
+  FeatureTree<Scalar> tree;
+
+  template <typename Derived>
+  explicit FeatureTreeImpl(const Eigen::MatrixBase<Derived>& features)
+      : cloud{features.template cast<Scalar>()},
+        tree(features.cols(), cloud, nanoflann::KDTreeSingleIndexAdaptorParams(10)) {}
+
+  int get_feature_dim() const override { return static_cast<int>(this->cloud.features.cols()); }
+
+  bool is_single_precision() const override { return std::is_same<Scalar, float>::value; }
+
+  bool matches(const Eigen::MatrixXd& features) const override { return this->matches_features(features); }
+
+  bool matches(const Eigen::MatrixXf& features) const override { return this->matches_features(features); }
+
+  void search(const Eigen::MatrixX3d& src,
+              const Eigen::MatrixXd& src_feature,
+              const Eigen::MatrixX3d& dst,
+              size_t k,
+              Correspondences& correspondences,
+              std::vector<double>* squared_distances,
+              Executor* executor) const override {
+    this->search_features(src, src_feature, dst, k, correspondences, squared_distances, executor);
+  }
+
+  void search(const Eigen::MatrixX3f& src,
+              const Eigen::MatrixXf& src_feature,
+              const Eigen::MatrixX3d& dst,
+              size_t k,
+              Correspondences& correspondences,
+              std::vector<double>* squared_distances,
+              Executor* executor) const override {
+    this->search_features(src, src_feature, dst, k, correspondences, squared_distances, executor);
+  }
+
+  void search(const Eigen::MatrixX3d& src,
+              const TargetIndex::FeatureView& src_feature,
+              const Eigen::MatrixX3d& dst,
+              size_t k,
+              Correspondences& correspondences,
+              std::vector<double>* squared_distances,
+              Executor* executor) const override {
+    this->search_features(src, src_feature, dst, k, correspondences, squared_distances, executor);
+  }
+
+  void search(const Eigen::MatrixX3f& src,
+              const TargetIndex::FeatureViewF& src_feature,
+              const Eigen::MatrixX3d& dst,
+              size_t k,
+              Correspondences& correspondences,
+              std::vector<double>* squared_distances,
+              Executor* executor) const override {
+    this->search_features(src, src_feature, dst, k, correspondences, squared_distances, executor);
+  }
+
+  template <typename Input>
+  bool matches_features(const Eigen::Matrix<Input, Eigen::Dynamic, Eigen::Dynamic>& features) const {
+    if (features.rows() != this->cloud.features.rows() || features.cols() != this->cloud.features.cols())
+      return false;
+
+    // Features equal after the conversion yield the same kd-tree
+    for (Eigen::Index col = 0; col < features.cols(); ++col) {
+      for (Eigen::Index row = 0; row < features.rows(); ++row) {
+        if (static_cast<Scalar>(features(row, col)) != this->cloud.features(row, col)) return false;
+      }
+    }
+    return true;
+  }
+
+  // Source features which are contiguous rows in the precision of the tree
+  // are queried in place, and other features are gathered row by row into the
+  // buffer of the worker
+  template <typename Input, typename Features>
+  void search_features(const Eigen::Matrix<Input, Eigen::Dynamic, 3>& src,
+                       const Eigen::MatrixBase<Features>& src_feature,
+                       const Eigen::MatrixX3d& dst,
+                       size_t k,
+                       Correspondences& correspondences,
+                       std::vector<double>* squared_distances,
+                       Executor* executor) const {
+    const size_t dim   = src_feature.cols();
+    const size_t n_src = src.rows();
+
+    const Features& features    = src_feature.derived();
+    const bool queried_in_place = std::is_same<typename Features::Scalar, Scalar>::value &&
+                                  (dim == 1 || features.colStride() == 1);
+
+    // The index is shared by threads, so buffers live for a call, one per
+    // worker
+    const size_t n_workers = executor != nullptr ? executor->get_n_workers() : 1;
+    std::vector<QueryWorkspace<Scalar>> workspaces(n_workers);
+    for (auto& workspace : workspaces) {
+      if (!queried_in_place) workspace.query.resize(dim);
+      workspace.indices.resize(k);
+      workspace.distances.resize(k);
+    }
+
+    if (squared_distances != nullptr) squared_distances->resize(n_src * k);
+
+    const size_t n_chunks = (n_src + QUERY_CHUNK_SIZE - 1) / QUERY_CHUNK_SIZE;
+    run_tasks(executor, n_chunks, [&](size_t chunk, size_t worker) {
+      QueryWorkspace<Scalar>& workspace = workspaces[worker];
+      nanoflann::KNNResultSet<Scalar, size_t> result(k);
+
+      const size_t begin = chunk * QUERY_CHUNK_SIZE;
+      const size_t end   = std::min(begin + QUERY_CHUNK_SIZE, n_src);
+      for (size_t src_index = begin; src_index < end; ++src_index) {
+        const Scalar* query;
+        if (queried_in_place) {
+          query = reinterpret_cast<const Scalar*>(features.data() + src_index * features.rowStride());
+        } else {
+          for (size_t d = 0; d < dim; ++d) workspace.query[d] = static_cast<Scalar>(features(src_index, d));
+          query = workspace.query.data();
+        }
+
+        result.init(workspace.indices.data(), workspace.distances.data());
+        this->tree.findNeighbors(result, query, nanoflann::SearchParameters());
+
+        size_t slot = src_index * k;
+        for (size_t i = 0; i < k; ++i, ++slot) {
+          const size_t dst_index                   = workspace.indices[i];
+          correspondences.points.first.col(slot)  = src.row(src_index).transpose().template cast<double>();
+          correspondences.points.second.col(slot) = dst.row(dst_index).transpose();
+          correspondences.indices.first[slot]     = static_cast<int>(src_index);
+          correspondences.indices.second[slot]    = static_cast<int>(dst_index);
+        }
+        if (squared_distances != nullptr) {
+          std::copy(workspace.distances.begin(), workspace.distances.end(), squared_distances->begin() + src_index * k);
+        }
+      }
+    });
+  }
+};
+
+};  // namespace
+
+/* -------------------------------------------------------------------------- */
+
+TargetIndex::TargetIndex(Eigen::MatrixX3d points, const Eigen::MatrixXd& features, bool single_precision)
+    : points(std::move(points)) {
+  if (this->points.rows() != features.rows()) {
+    throw std::invalid_argument("Mismatching sizes of points and features");
+  }
+
+  if (single_precision) {
+    this->impl.reset(new FeatureTreeImpl<float>(features));
+  } else {
+    this->impl.reset(new FeatureTreeImpl<double>(features));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+TargetIndex::TargetIndex(const Eigen::MatrixX3f& points, const Eigen::MatrixXf& features)
+    : points(points.cast<double>()) {
+  if (this->points.rows() != features.rows()) {
+    throw std::invalid_argument("Mismatching sizes of points and features");
+  }
+
+  this->impl.reset(new FeatureTreeImpl<float>(features));
+}
+
+/* -------------------------------------------------------------------------- */
+
+TargetIndex::TargetIndex(TargetIndex&& other) noexcept = default;
+
+TargetIndex& TargetIndex::operator=(TargetIndex&& other) noexcept = default;
+
+TargetIndex::~TargetIndex() = default;
+
+/* -------------------------------------------------------------------------- */
+
+void TargetIndex::search(const Eigen::MatrixX3d& src,
+                         const Eigen::MatrixXd& src_feature,
+                         size_t k,
+                         Correspondences& correspondences,
+                         Executor* executor) const {
+  this->impl->search(src, src_feature, this->points, k, correspondences, nullptr, executor);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TargetIndex::search(const Eigen::MatrixX3f& src,
+                         const Eigen::MatrixXf& src_feature,
+                         size_t k,
+                         Correspondences& correspondences,
+                         Executor* executor) const {
+  this->impl->search(src, src_feature, this->points, k, correspondences, nullptr, executor);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TargetIndex::search(const Eigen::MatrixX3d& src,
+                         const FeatureView& src_feature,
+                         size_t k,
+                         Correspondences& correspondences,
+                         Executor* executor) const {
+  this->impl->search(src, src_feature, this->points, k, correspondences, nullptr, executor);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TargetIndex::search(const Eigen::MatrixX3f& src,
+                         const FeatureViewF& src_feature,
+                         size_t k,
+                         Correspondences& correspondences,
+                         Executor* executor) const {
+  this->impl->search(src, src_feature, this->points, k, correspondences, nullptr, executor);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TargetIndex::search(const Eigen::MatrixX3d& src,
+                         const Eigen::MatrixXd& src_feature,
+                         size_t k,
+                         Correspondences& correspondences,
+                         std::vector<double>& squared_distances,
+                         Executor* executor) const {
+  this->impl->search(src, src_feature, this->points, k, correspondences, &squared_distances, executor);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TargetIndex::search(const Eigen::MatrixX3f& src,
+                         const Eigen::MatrixXf& src_feature,
+                         size_t k,
+                         Correspondences& correspondences,
+                         std::vector<double>& squared_distances,
+                         Executor* executor) const {
+  this->impl->search(src, src_feature, this->points, k, correspondences, &squared_distances, executor);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int TargetIndex::get_feature_dim() const { return this->impl->get_feature_dim(); }
+
+bool TargetIndex::is_single_precision() const { return this->impl->is_single_precision(); }
+
+/* -------------------------------------------------------------------------- */
+
+bool TargetIndex::matches(const Eigen::MatrixX3d& points, const Eigen::MatrixXd& features, bool single_precision) const {
+  return this->impl->is_single_precision() == single_precision &&
+         this->points.rows() == points.rows() &&
+         this->points == points &&
+         this->impl->matches(features);
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool TargetIndex::matches(const Eigen::MatrixX3f& points, const Eigen::MatrixXf& features) const {
+  return this->impl->is_single_precision() &&
+         this->points.rows() == points.rows() &&
+         this->points == points.cast<double>() &&
+         this->impl->matches(features);
+}
+
+};  // namespace kcp
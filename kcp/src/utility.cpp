@@ -4,72 +4,121 @@
 
 #include "kcp/utility.hpp"
 
-#include <nanoflann.hpp>
-
 namespace kcp {
 
+namespace {
+
+/**
+ * @brief Fill k-closest-points correspondences of a source cloud in the given
+ * precision against a target.
+ *
+ * @tparam Scalar The scalar type of the source cloud.
+ */
+template <typename Scalar>
+void fill_kcp_correspondences(const Eigen::Matrix<Scalar, Eigen::Dynamic, 3>& src,
+                              const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>& src_feature,
+                              const Target& dst,
+                              size_t k,
+                              Correspondences& correspondences,
+                              Executor* executor) {
+  assert(src_feature.cols() == dst.get_feature_dim() && "Incompatible dimensions of src_feature and dst_feature");
+  assert(src.rows() == src_feature.rows() && "Mismatching sizes of src and src_feature");
+
+  const size_t dst_size = dst.get_size();
+  const size_t size     = MIN(k, dst_size);
+  const size_t n_slots  = src.rows() * size;
+  correspondences.points.first.resize(3, n_slots);
+  correspondences.points.second.resize(3, n_slots);
+  correspondences.indices.first.resize(n_slots);
+  correspondences.indices.second.resize(n_slots);
+
+  if (n_slots == 0)
+    return;
+
+  if (k >= dst_size) {
+    // Equivalent to cross product of two clouds
+    size_t index = 0;
+    for (int src_index = 0; src_index < src.rows(); ++src_index) {
+      for (size_t dst_index = 0; dst_index < dst_size; ++dst_index) {
+        correspondences.points.first.col(index)  = src.row(src_index).transpose().template cast<double>();
+        correspondences.points.second.col(index) = dst.get_point(dst_index);
+        correspondences.indices.first[index]     = src_index;
+        correspondences.indices.second[index]    = static_cast<int>(dst_index);
+        ++index;
+      }
+    }
+  } else {
+    // Query k closest points of each source point in parallel
+    dst.search(src, src_feature, k, correspondences, executor);
+  }
+}
+
+};  // namespace
+
+/* ------------------------- get_kcp_correspondences ------------------------ */
+
 std::shared_ptr<Correspondences>
 get_kcp_correspondences(const Eigen::MatrixX3d& src,
                         const Eigen::MatrixX3d& dst,
                         const Eigen::MatrixXd& src_feature,
                         const Eigen::MatrixXd& dst_feature,
                         size_t k) {
+  auto correspondences = std::make_shared<Correspondences>();
+  get_kcp_correspondences(src, dst, src_feature, dst_feature, k, *correspondences);
+  return correspondences;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void get_kcp_correspondences(const Eigen::MatrixX3d& src,
+                             const Eigen::MatrixX3d& dst,
+                             const Eigen::MatrixXd& src_feature,
+                             const Eigen::MatrixXd& dst_feature,
+                             size_t k,
+                             Correspondences& correspondences,
+                             bool single_precision,
+                             Executor* executor) {
   assert(src_feature.cols() == dst_feature.cols() && "Incompatible dimensions of src_feature and dst_feature");
-  assert(src.rows() == src_feature.rows() && "Mismatching sizes of src and src_feature");
   assert(dst.rows() == dst_feature.rows() && "Mismatching sizes of dst and dst_feature");
 
-  int dim                 = src_feature.cols();
-  int size                = MIN(k, dst.rows());
-  auto correspondences    = std::make_shared<Correspondences>();
-  correspondences->points = std::make_pair(Eigen::Matrix3Xd::Zero(3, src.rows() * size),
-                                           Eigen::Matrix3Xd::Zero(3, src.rows() * size));
-  correspondences->indices.first.reserve(src.rows() * size);
-  correspondences->indices.second.reserve(src.rows() * size);
+  get_kcp_correspondences(src, src_feature, TargetIndex(dst, dst_feature, single_precision), k, correspondences, executor);
+}
 
-  int index = 0;
-  if (k >= dst.rows()) {
-    // Equivalent to cross product of two clouds
-    for (int src_index = 0; src_index < src.rows(); ++src_index) {
-      for (int dst_index = 0; dst_index < dst.rows(); ++dst_index) {
-        correspondences->points.first.col(index) << src(src_index, 0), src(src_index, 1), src(src_index, 2);
-        correspondences->points.second.col(index) << dst(dst_index, 0), dst(dst_index, 1), dst(dst_index, 2);
-        correspondences->indices.first.push_back(src_index);
-        correspondences->indices.second.push_back(dst_index);
-        ++index;
-      }
-    }
-  } else {
-    // Build the KD-tree of dst_feature, and query k closest points for each
-    // source point.
-    nanoflann::KDTreeEigenMatrixAdaptor<Eigen::MatrixXd> dst_tree(dim, std::cref(dst_feature), 10);
-    dst_tree.index_->buildIndex();
+/* -------------------------------------------------------------------------- */
 
-    std::vector<double> point(dim);
-    std::vector<size_t> indices(k);
-    std::vector<double> distances(k);
+void get_kcp_correspondences(const Eigen::MatrixX3d& src,
+                             const Eigen::MatrixXd& src_feature,
+                             const Target& dst,
+                             size_t k,
+                             Correspondences& correspondences,
+                             Executor* executor) {
+  fill_kcp_correspondences(src, src_feature, dst, k, correspondences, executor);
+}
 
-    nanoflann::KNNResultSet<double> result(k);
+/* -------------------------------------------------------------------------- */
 
-    for (int src_index = 0; src_index < src.rows(); ++src_index) {
-      for (int i = 0; i < dim; ++i) {
-        point[i] = src_feature.row(src_index)(i);
-      }
-      result.init(&indices[0], &distances[0]);
+void get_kcp_correspondences(const Eigen::MatrixX3f& src,
+                             const Eigen::MatrixX3f& dst,
+                             const Eigen::MatrixXf& src_feature,
+                             const Eigen::MatrixXf& dst_feature,
+                             size_t k,
+                             Correspondences& correspondences,
+                             Executor* executor) {
+  assert(src_feature.cols() == dst_feature.cols() && "Incompatible dimensions of src_feature and dst_feature");
+  assert(dst.rows() == dst_feature.rows() && "Mismatching sizes of dst and dst_feature");
 
-      dst_tree.index_->findNeighbors(result, &point[0], nanoflann::SearchParameters());
+  fill_kcp_correspondences(src, src_feature, TargetIndex(dst, dst_feature), k, correspondences, executor);
+}
 
-      for (int i = 0; i < size; ++i) {
-        int dst_index = indices[i];
-        correspondences->points.first.col(index) << src(src_index, 0), src(src_index, 1), src(src_index, 2);
-        correspondences->points.second.col(index) << dst(dst_index, 0), dst(dst_index, 1), dst(dst_index, 2);
-        correspondences->indices.first.push_back(src_index);
-        correspondences->indices.second.push_back(dst_index);
-        ++index;
-      }
-    }
-  }
+/* -------------------------------------------------------------------------- */
 
-  return correspondences;
+void get_kcp_correspondences(const Eigen::MatrixX3f& src,
+                             const Eigen::MatrixXf& src_feature,
+                             const Target& dst,
+                             size_t k,
+                             Correspondences& correspondences,
+                             Executor* executor) {
+  fill_kcp_correspondences(src, src_feature, dst, k, correspondences, executor);
 }
 
 };  // namespace kcp
@@ -1,57 +1,484 @@
 #include <pybind11/eigen.h>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
 #include "kcp/keypoint.hpp"
+#include "kcp/local_map.hpp"
+#include "kcp/odometry.hpp"
+#include "kcp/parallel.hpp"
+#include "kcp/sampler.hpp"
+#include "kcp/sensor.hpp"
 #include "kcp/solver.hpp"
+#include "kcp/target.hpp"
+
+#include <memory>
+#include <stdexcept>
 
 #define STRINGIFY(x) #x
 #define MACRO_STRINGIFY(x) STRINGIFY(x)
 
 namespace py = pybind11;
 
-PYBIND11_MODULE(pykcp, m) {
-  py::class_<kcp::Correspondences>(m, "Correspondences")
-      .def(py::init<>())
-      .def_readwrite("points", &kcp::Correspondences::points)
-      .def_readwrite("indices", &kcp::Correspondences::indices);
+namespace {
+
+/**
+ * @brief View an array of shape (N, 3) in place, whatever its strides are
+ * (e.g., C order, Fortran order, or a slice of a structured point buffer).
+ *
+ * @tparam Scalar The scalar type of the point cloud.
+ */
+template <typename Scalar>
+typename kcp::keypoint::BasicRangeImage<Scalar>::CloudView view_cloud(const py::array_t<Scalar, 0> &cloud) {
+  const auto item_size = static_cast<py::ssize_t>(sizeof(Scalar));
+  if (cloud.ndim() != 2 || cloud.shape(1) != 3) {
+    throw std::invalid_argument("The cloud must be an array of shape (N, 3)");
+  }
+  if (cloud.strides(0) % item_size != 0 || cloud.strides(1) % item_size != 0) {
+    throw std::invalid_argument("The strides of the cloud must be multiples of its item size");
+  }
+  return typename kcp::keypoint::BasicRangeImage<Scalar>::CloudView(
+      cloud.data(),
+      cloud.shape(0),
+      3,
+      Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(cloud.strides(1) / item_size, cloud.strides(0) / item_size));
+}
 
-  py::class_<kcp::keypoint::RangeImage>(m, "RangeImage")
-      .def(py::init<Eigen::MatrixX3d, int, float, float, int>(),
+/**
+ * @brief View a vector as a one-dimensional array. Returned with
+ * ``reference_internal``, it becomes a read-only NumPy view kept valid by the
+ * owner of the vector.
+ *
+ * @tparam T The type of elements.
+ */
+template <typename T>
+Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>> view_vector(const std::vector<T> &vector) {
+  return Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(vector.data(), vector.size());
+}
+
+/**
+ * @brief Deleter of the streaming odometry. The GIL is released while the
+ * pipeline is closed, since a callback running in the solver thread waits for
+ * the GIL. It is held again while the object is deleted, since deleting the
+ * callback drops the reference to the Python function.
+ *
+ */
+struct StreamingOdometryDeleter {
+  void operator()(kcp::StreamingOdometry *odometry) const {
+    {
+      py::gil_scoped_release release;
+      odometry->close();
+    }
+    delete odometry;
+  }
+};
+
+/**
+ * @brief Bind a range image of the given scalar type.
+ *
+ * @tparam Scalar The scalar type of the point cloud.
+ */
+template <typename Scalar>
+py::class_<kcp::keypoint::BasicRangeImage<Scalar>> bind_range_image(py::module &m, const char *name) {
+  using RangeImage  = kcp::keypoint::BasicRangeImage<Scalar>;
+  using CloudMatrix = typename RangeImage::CloudMatrix;
+
+  // Arrays of the matching dtype are viewed in place by the constructors
+  // below, which keep the array alive as long as the range image. Other
+  // inputs fall back to the overloads copying the cloud. The projection runs
+  // without the GIL, and getters return read-only views, which reflect the
+  // latest reset.
+  return py::class_<RangeImage>(m, name)
+      .def(py::init<int, float, float, int>(),
+           py::arg("n_channels")      = 32,
+           py::arg("min_vfov_deg")    = -30.0,
+           py::arg("max_vfov_deg")    = 10.0,
+           py::arg("hfov_resolution") = 1800)
+      .def(py::init([](const py::array_t<Scalar, 0> &cloud,
+                       int n_channels,
+                       float min_vfov_deg,
+                       float max_vfov_deg,
+                       int hfov_resolution) {
+             return new RangeImage(view_cloud(cloud), n_channels, min_vfov_deg, max_vfov_deg, hfov_resolution);
+           }),
+           py::arg("cloud").noconvert(),
+           py::arg("n_channels")      = 32,
+           py::arg("min_vfov_deg")    = -30.0,
+           py::arg("max_vfov_deg")    = 10.0,
+           py::arg("hfov_resolution") = 1800,
+           py::keep_alive<1, 2>(),
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init([](const py::array_t<Scalar, 0> &cloud, const kcp::SensorModel &sensor_model, int hfov_resolution) {
+             return new RangeImage(view_cloud(cloud), sensor_model, hfov_resolution);
+           }),
+           py::arg("cloud").noconvert(),
+           py::arg("sensor_model"),
+           py::arg("hfov_resolution") = 1800,
+           py::keep_alive<1, 2>(),
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init([](const py::array_t<Scalar, 0> &cloud,
+                       const Eigen::Ref<const Eigen::VectorXi> &rings,
+                       const Eigen::Ref<const Eigen::VectorXi> &columns,
+                       int n_channels,
+                       int hfov_resolution) {
+             return new RangeImage(view_cloud(cloud), rings, columns, n_channels, hfov_resolution);
+           }),
+           py::arg("cloud").noconvert(),
+           py::arg("rings"),
+           py::arg("columns"),
+           py::arg("n_channels"),
+           py::arg("hfov_resolution"),
+           py::keep_alive<1, 2>(),
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init<CloudMatrix, int, float, float, int>(),
            py::arg("cloud"),
            py::arg("n_channels")      = 32,
            py::arg("min_vfov_deg")    = -30.0,
            py::arg("max_vfov_deg")    = 10.0,
+           py::arg("hfov_resolution") = 1800,
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init<const kcp::SensorModel &, int>(),
+           py::arg("sensor_model"),
            py::arg("hfov_resolution") = 1800)
-      .def("get_cloud", &kcp::keypoint::RangeImage::get_cloud, py::return_value_policy::copy)
-      .def("get_n_channels", &kcp::keypoint::RangeImage::get_n_channels)
-      .def("get_image_sequence_size", &kcp::keypoint::RangeImage::get_image_sequence_size)
-      .def("get_image_indices", &kcp::keypoint::RangeImage::get_image_indices, py::return_value_policy::copy)
-      .def("get_image_depth_sequence", &kcp::keypoint::RangeImage::get_image_depth_sequence, py::return_value_policy::copy)
-      .def("get_image_point_indices_sequence", &kcp::keypoint::RangeImage::get_image_point_indices_sequence, py::return_value_policy::copy)
-      .def("get_image_col_indices_sequence", &kcp::keypoint::RangeImage::get_image_col_indices_sequence, py::return_value_policy::copy)
-      .def("get_channel_start_indices", &kcp::keypoint::RangeImage::get_channel_start_indices, py::return_value_policy::copy)
-      .def("get_channel_end_indices", &kcp::keypoint::RangeImage::get_channel_end_indices, py::return_value_policy::copy);
-
-  py::class_<kcp::keypoint::MultiScaleCurvature>(m, "MultiScaleCurvature")
-      .def(py::init<kcp::keypoint::RangeImage, float, float>(),
+      .def(py::init<CloudMatrix, const kcp::SensorModel &, int>(),
+           py::arg("cloud"),
+           py::arg("sensor_model"),
+           py::arg("hfov_resolution") = 1800,
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init<CloudMatrix, const Eigen::Ref<const Eigen::VectorXi> &, const Eigen::Ref<const Eigen::VectorXi> &, int, int>(),
+           py::arg("cloud"),
+           py::arg("rings"),
+           py::arg("columns"),
+           py::arg("n_channels"),
+           py::arg("hfov_resolution"),
+           py::call_guard<py::gil_scoped_release>())
+      .def_static(
+          "from_organized",
+          [](const py::array_t<Scalar, 0> &cloud, int height, int width) {
+            return RangeImage::from_organized(view_cloud(cloud), height, width);
+          },
+          py::arg("cloud").noconvert(),
+          py::arg("height"),
+          py::arg("width"),
+          py::keep_alive<0, 1>(),
+          py::call_guard<py::gil_scoped_release>())
+      .def_static("from_organized", static_cast<RangeImage (*)(CloudMatrix, int, int)>(&RangeImage::from_organized),
+                  py::arg("cloud"),
+                  py::arg("height"),
+                  py::arg("width"),
+                  py::call_guard<py::gil_scoped_release>())
+      .def(
+          "reset",
+          [](RangeImage &self, CloudMatrix cloud) { self.reset(std::move(cloud)); },
+          py::arg("cloud"),
+          py::call_guard<py::gil_scoped_release>())
+      .def(
+          "reset",
+          [](RangeImage &self, CloudMatrix cloud, Eigen::VectorXi rings, Eigen::VectorXi columns) {
+            self.reset(std::move(cloud), rings, columns);
+          },
+          py::arg("cloud"),
+          py::arg("rings"),
+          py::arg("columns"),
+          py::call_guard<py::gil_scoped_release>())
+      .def(
+          "reset_organized",
+          [](RangeImage &self, CloudMatrix cloud) { self.reset_organized(std::move(cloud)); },
+          py::arg("cloud"),
+          py::call_guard<py::gil_scoped_release>())
+      .def("set_deskew",
+           &RangeImage::set_deskew,
+           py::arg("motion"),
+           py::arg("deskew") = kcp::keypoint::RangeImage::Deskew())
+      .def("get_deskew_motion", &RangeImage::get_deskew_motion, py::return_value_policy::copy)
+      .def("get_deskew", &RangeImage::get_deskew, py::return_value_policy::copy)
+      .def("set_filter", &RangeImage::set_filter, py::arg("filter"))
+      .def("get_filter", &RangeImage::get_filter, py::return_value_policy::copy)
+      .def("get_cloud", &RangeImage::get_cloud, py::return_value_policy::reference_internal)
+      .def("get_sensor_model", &RangeImage::get_sensor_model, py::return_value_policy::copy)
+      .def("get_n_channels", &RangeImage::get_n_channels)
+      .def("get_image_sequence_size", &RangeImage::get_image_sequence_size)
+      .def("get_image_indices", &RangeImage::get_image_indices, py::return_value_policy::reference_internal)
+      .def(
+          "get_image_depth_sequence",
+          [](const RangeImage &self) { return view_vector(self.get_image_depth_sequence()); },
+          py::return_value_policy::reference_internal)
+      .def(
+          "get_image_point_indices_sequence",
+          [](const RangeImage &self) { return view_vector(self.get_image_point_indices_sequence()); },
+          py::return_value_policy::reference_internal)
+      .def(
+          "get_image_col_indices_sequence",
+          [](const RangeImage &self) { return view_vector(self.get_image_col_indices_sequence()); },
+          py::return_value_policy::reference_internal)
+      .def(
+          "get_channel_start_indices",
+          [](const RangeImage &self) { return view_vector(self.get_channel_start_indices()); },
+          py::return_value_policy::reference_internal)
+      .def(
+          "get_channel_end_indices",
+          [](const RangeImage &self) { return view_vector(self.get_channel_end_indices()); },
+          py::return_value_policy::reference_internal)
+      .def("get_profile", &RangeImage::get_profile, py::return_value_policy::copy);
+}
+
+/**
+ * @brief Bind constructors and methods of a multi-scale curvature of the given
+ * scalar type.
+ *
+ * @tparam Scalar The scalar type of the point cloud.
+ */
+template <typename Scalar>
+void bind_multi_scale_curvature(py::class_<kcp::keypoint::BasicMultiScaleCurvature<Scalar>> &msc) {
+  using MultiScaleCurvature = kcp::keypoint::BasicMultiScaleCurvature<Scalar>;
+  using RangeImage          = kcp::keypoint::BasicRangeImage<Scalar>;
+  using CloudMatrix         = typename MultiScaleCurvature::CloudMatrix;
+
+  // The copy of a range image may view the array of the given one, so the
+  // given one (or the given array) is kept alive. The extraction runs without
+  // the GIL, and getters return read-only views.
+  msc.def(py::init<kcp::keypoint::BasicRangeImage<Scalar>, const kcp::keypoint::MultiScaleCurvatureBase::Params &>(),
+          py::arg("range_image"),
+          py::arg("params"),
+          py::keep_alive<1, 2>(),
+          py::call_guard<py::gil_scoped_release>())
+      .def(py::init<kcp::keypoint::BasicRangeImage<Scalar>, float, float>(),
            py::arg("range_image"),
            py::arg("corner_threshold") = 30.0,
-           py::arg("plane_threshold")  = 0.1)
-      .def(py::init<Eigen::MatrixX3d, int, float, float, int, float, float>(),
+           py::arg("plane_threshold")  = 0.1,
+           py::keep_alive<1, 2>(),
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init([](const py::array_t<Scalar, 0> &cloud,
+                       int n_channels,
+                       float min_vfov_deg,
+                       float max_vfov_deg,
+                       int hfov_resolution,
+                       float corner_threshold,
+                       float plane_threshold) {
+             return new MultiScaleCurvature(
+                 RangeImage(view_cloud(cloud), n_channels, min_vfov_deg, max_vfov_deg, hfov_resolution),
+                 corner_threshold,
+                 plane_threshold);
+           }),
+           py::arg("cloud").noconvert(),
+           py::arg("n_channels")       = 32,
+           py::arg("min_vfov_deg")     = -30.0,
+           py::arg("max_vfov_deg")     = 10.0,
+           py::arg("hfov_resolution")  = 1800,
+           py::arg("corner_threshold") = 30.0,
+           py::arg("plane_threshold")  = 0.1,
+           py::keep_alive<1, 2>(),
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init([](const py::array_t<Scalar, 0> &cloud,
+                       const kcp::SensorModel &sensor_model,
+                       int hfov_resolution,
+                       float corner_threshold,
+                       float plane_threshold) {
+             return new MultiScaleCurvature(RangeImage(view_cloud(cloud), sensor_model, hfov_resolution),
+                                            corner_threshold,
+                                            plane_threshold);
+           }),
+           py::arg("cloud").noconvert(),
+           py::arg("sensor_model"),
+           py::arg("hfov_resolution")  = 1800,
+           py::arg("corner_threshold") = 30.0,
+           py::arg("plane_threshold")  = 0.1,
+           py::keep_alive<1, 2>(),
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init<CloudMatrix, int, float, float, int, float, float>(),
            py::arg("cloud"),
            py::arg("n_channels")       = 32,
            py::arg("min_vfov_deg")     = -30.0,
            py::arg("max_vfov_deg")     = 10.0,
            py::arg("hfov_resolution")  = 1800,
            py::arg("corner_threshold") = 30.0,
-           py::arg("plane_threshold")  = 0.1)
-      .def("get_range_image", &kcp::keypoint::MultiScaleCurvature::get_range_image, py::return_value_policy::copy)
-      .def("get_corner_points", &kcp::keypoint::MultiScaleCurvature::get_corner_points, py::return_value_policy::copy)
-      .def("get_plane_points", &kcp::keypoint::MultiScaleCurvature::get_plane_points, py::return_value_policy::copy)
-      .def("get_corner_point_indices", &kcp::keypoint::MultiScaleCurvature::get_corner_point_indices, py::return_value_policy::copy)
-      .def("get_plane_point_indices", &kcp::keypoint::MultiScaleCurvature::get_plane_point_indices, py::return_value_policy::copy)
-      .def("get_curvature", &kcp::keypoint::MultiScaleCurvature::get_curvature, py::return_value_policy::copy);
+           py::arg("plane_threshold")  = 0.1,
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init<CloudMatrix, const kcp::SensorModel &, int, float, float>(),
+           py::arg("cloud"),
+           py::arg("sensor_model"),
+           py::arg("hfov_resolution")  = 1800,
+           py::arg("corner_threshold") = 30.0,
+           py::arg("plane_threshold")  = 0.1,
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_params", &MultiScaleCurvature::get_params, py::return_value_policy::copy)
+      .def("get_range_image", &MultiScaleCurvature::get_range_image, py::return_value_policy::reference_internal)
+      .def("get_corner_points", &MultiScaleCurvature::get_corner_points, py::return_value_policy::reference_internal)
+      .def("get_plane_points", &MultiScaleCurvature::get_plane_points, py::return_value_policy::reference_internal)
+      .def(
+          "get_corner_point_indices",
+          [](const MultiScaleCurvature &self) { return view_vector(self.get_corner_point_indices()); },
+          py::return_value_policy::reference_internal)
+      .def(
+          "get_plane_point_indices",
+          [](const MultiScaleCurvature &self) { return view_vector(self.get_plane_point_indices()); },
+          py::return_value_policy::reference_internal)
+      .def(
+          "get_curvature",
+          [](const MultiScaleCurvature &self) { return view_vector(self.get_curvature()); },
+          py::return_value_policy::reference_internal)
+      .def(
+          "get_corner_point_curvatures",
+          [](const MultiScaleCurvature &self) { return view_vector(self.get_corner_point_curvatures()); },
+          py::return_value_policy::reference_internal)
+      .def("get_profile", &MultiScaleCurvature::get_profile, py::return_value_policy::copy);
+}
+
+/**
+ * @brief Bind methods of a voxel sampler of the given scalar type.
+ *
+ * @tparam Scalar The scalar type of points.
+ */
+template <typename Scalar>
+void bind_voxel_sampler(py::class_<kcp::keypoint::BasicVoxelSampler<Scalar>> &sampler) {
+  using VoxelSampler        = kcp::keypoint::BasicVoxelSampler<Scalar>;
+  using MultiScaleCurvature = kcp::keypoint::BasicMultiScaleCurvature<Scalar>;
+  using CloudMatrix         = typename VoxelSampler::CloudMatrix;
+
+  sampler.def(py::init<const kcp::keypoint::VoxelSamplerBase::Params &>(), py::arg("params"))
+      .def(py::init<>())
+      .def("sample",
+           static_cast<void (VoxelSampler::*)(const CloudMatrix &, const std::vector<float> &)>(&VoxelSampler::sample),
+           py::arg("cloud"),
+           py::arg("scores") = std::vector<float>(),
+           py::call_guard<py::gil_scoped_release>())
+      .def("sample",
+           static_cast<void (VoxelSampler::*)(const MultiScaleCurvature &)>(&VoxelSampler::sample),
+           py::arg("msc"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_params", &VoxelSampler::get_params, py::return_value_policy::copy)
+      .def("get_points", &VoxelSampler::get_points, py::return_value_policy::reference_internal)
+      .def(
+          "get_indices",
+          [](const VoxelSampler &self) { return view_vector(self.get_indices()); },
+          py::return_value_policy::reference_internal)
+      .def("get_voxel_size", &VoxelSampler::get_voxel_size)
+      .def("get_profile", &VoxelSampler::get_profile, py::return_value_policy::copy);
+}
+
+};  // namespace
+
+PYBIND11_MODULE(pykcp, m) {
+  m.attr("PROFILING_ENABLED") = kcp::PROFILING_ENABLED;
+
+  py::class_<kcp::Correspondences>(m, "Correspondences")
+      .def(py::init<>())
+      .def_readwrite("points", &kcp::Correspondences::points)
+      .def_readwrite("indices", &kcp::Correspondences::indices)
+      // Read-only views sharing the memory of the correspondences
+      .def_property_readonly("src_points", [](const kcp::Correspondences &self) -> const Eigen::Matrix3Xd & { return self.points.first; })
+      .def_property_readonly("dst_points", [](const kcp::Correspondences &self) -> const Eigen::Matrix3Xd & { return self.points.second; })
+      .def_property_readonly("src_indices", [](const kcp::Correspondences &self) {
+        return Eigen::Map<const Eigen::VectorXi>(self.indices.first.data(), self.indices.first.size());
+      })
+      .def_property_readonly("dst_indices", [](const kcp::Correspondences &self) {
+        return Eigen::Map<const Eigen::VectorXi>(self.indices.second.data(), self.indices.second.size());
+      });
+
+  py::class_<kcp::Executor, std::shared_ptr<kcp::Executor>>(m, "Executor")
+      .def("get_n_workers", &kcp::Executor::get_n_workers);
+
+  py::class_<kcp::ThreadPool, kcp::Executor, std::shared_ptr<kcp::ThreadPool>>(m, "ThreadPool")
+      .def(py::init<size_t>(), py::arg("n_workers") = 0);
+
+  py::class_<kcp::SensorModel>(m, "SensorModel")
+      .def(py::init<std::vector<float>>(), py::arg("elevations_deg"))
+      .def_static("uniform", &kcp::SensorModel::uniform,
+                  py::arg("n_channels"),
+                  py::arg("min_vfov_deg"),
+                  py::arg("max_vfov_deg"))
+      .def_static("from_file", &kcp::SensorModel::from_file, py::arg("filename"))
+      .def("get_n_channels", &kcp::SensorModel::get_n_channels)
+      .def("get_elevations_deg", &kcp::SensorModel::get_elevations_deg, py::return_value_policy::copy)
+      .def("get_channel", &kcp::SensorModel::get_channel, py::arg("z"), py::arg("xy_norm"));
+
+  py::class_<kcp::keypoint::RangeImage::Profile>(m, "RangeImageProfile")
+      .def(py::init<>())
+      .def_readonly("n_points", &kcp::keypoint::RangeImage::Profile::n_points)
+      .def_readonly("n_filtered_points", &kcp::keypoint::RangeImage::Profile::n_filtered_points)
+      .def_readonly("n_projected_points", &kcp::keypoint::RangeImage::Profile::n_projected_points)
+      .def_readonly("projection_time", &kcp::keypoint::RangeImage::Profile::projection_time);
+
+  py::class_<kcp::keypoint::RangeImage::Deskew>(m, "RangeImageDeskew")
+      .def(py::init<>())
+      .def_readwrite("start_column", &kcp::keypoint::RangeImage::Deskew::start_column)
+      .def_readwrite("descending", &kcp::keypoint::RangeImage::Deskew::descending);
+
+  py::class_<kcp::keypoint::RangeImage::CropBox>(m, "RangeImageCropBox")
+      .def(py::init<const Eigen::Vector3d &, const Eigen::Vector3d &>(), py::arg("min_point"), py::arg("max_point"))
+      .def_readwrite("min_point", &kcp::keypoint::RangeImage::CropBox::min_point)
+      .def_readwrite("max_point", &kcp::keypoint::RangeImage::CropBox::max_point);
+
+  py::class_<kcp::keypoint::RangeImage::Filter>(m, "RangeImageFilter")
+      .def(py::init<>())
+      .def_readwrite("crop_boxes", &kcp::keypoint::RangeImage::Filter::crop_boxes)
+      .def_readwrite("min_range", &kcp::keypoint::RangeImage::Filter::min_range)
+      .def_readwrite("max_range", &kcp::keypoint::RangeImage::Filter::max_range)
+      .def_readwrite("min_z", &kcp::keypoint::RangeImage::Filter::min_z)
+      .def_readwrite("max_z", &kcp::keypoint::RangeImage::Filter::max_z)
+      .def_readwrite("n_ground_channels", &kcp::keypoint::RangeImage::Filter::n_ground_channels)
+      .def_readwrite("ground_z", &kcp::keypoint::RangeImage::Filter::ground_z);
+
+  // Both precisions share the constructors and methods. A float32 array is
+  // bound to the single precision variant without conversion.
+  bind_range_image<double>(m, "RangeImage");
+  bind_range_image<float>(m, "RangeImageF");
+
+  py::enum_<kcp::keypoint::CurvatureKernel>(m, "CurvatureKernel")
+      .value("AUTO", kcp::keypoint::CurvatureKernel::AUTO)
+      .value("SCALAR", kcp::keypoint::CurvatureKernel::SCALAR)
+      .value("AVX2", kcp::keypoint::CurvatureKernel::AVX2)
+      .value("AVX512", kcp::keypoint::CurvatureKernel::AVX512);
+
+  py::class_<kcp::keypoint::MultiScaleCurvature> msc(m, "MultiScaleCurvature");
+
+  py::enum_<kcp::keypoint::MultiScaleCurvature::Selection>(msc, "Selection")
+      .value("SORT", kcp::keypoint::MultiScaleCurvature::Selection::SORT)
+      .value("PARTIAL", kcp::keypoint::MultiScaleCurvature::Selection::PARTIAL);
+
+  py::class_<kcp::keypoint::MultiScaleCurvature::Params>(m, "MultiScaleCurvatureParams")
+      .def(py::init<>())
+      .def_readwrite("corner_threshold", &kcp::keypoint::MultiScaleCurvature::Params::corner_threshold)
+      .def_readwrite("plane_threshold", &kcp::keypoint::MultiScaleCurvature::Params::plane_threshold)
+      .def_readwrite("n_segments", &kcp::keypoint::MultiScaleCurvature::Params::n_segments)
+      .def_readwrite("max_corners_per_segment", &kcp::keypoint::MultiScaleCurvature::Params::max_corners_per_segment)
+      .def_readwrite("selection", &kcp::keypoint::MultiScaleCurvature::Params::selection)
+      .def_readwrite("curvature_kernel", &kcp::keypoint::MultiScaleCurvature::Params::curvature_kernel)
+      .def_readwrite("n_threads", &kcp::keypoint::MultiScaleCurvature::Params::n_threads)
+      .def_readwrite("executor", &kcp::keypoint::MultiScaleCurvature::Params::executor);
+
+  py::class_<kcp::keypoint::MultiScaleCurvature::Profile>(m, "MultiScaleCurvatureProfile")
+      .def(py::init<>())
+      .def_readonly("n_corner_points", &kcp::keypoint::MultiScaleCurvature::Profile::n_corner_points)
+      .def_readonly("n_plane_points", &kcp::keypoint::MultiScaleCurvature::Profile::n_plane_points)
+      .def_readonly("curvature_time", &kcp::keypoint::MultiScaleCurvature::Profile::curvature_time)
+      .def_readonly("selection_time", &kcp::keypoint::MultiScaleCurvature::Profile::selection_time);
+
+  bind_multi_scale_curvature(msc);
+
+  py::class_<kcp::keypoint::MultiScaleCurvatureF> msc_f(m, "MultiScaleCurvatureF");
+  msc_f.attr("Selection") = msc.attr("Selection");
+  bind_multi_scale_curvature(msc_f);
+
+  py::class_<kcp::keypoint::VoxelSampler::Params>(m, "VoxelSamplerParams")
+      .def(py::init<>())
+      .def_readwrite("max_points", &kcp::keypoint::VoxelSampler::Params::max_points)
+      .def_readwrite("max_iterations", &kcp::keypoint::VoxelSampler::Params::max_iterations)
+      .def_readwrite("tolerance", &kcp::keypoint::VoxelSampler::Params::tolerance);
+
+  py::class_<kcp::keypoint::VoxelSampler::Profile>(m, "VoxelSamplerProfile")
+      .def(py::init<>())
+      .def_readonly("n_points", &kcp::keypoint::VoxelSampler::Profile::n_points)
+      .def_readonly("n_sampled_points", &kcp::keypoint::VoxelSampler::Profile::n_sampled_points)
+      .def_readonly("n_voxels", &kcp::keypoint::VoxelSampler::Profile::n_voxels)
+      .def_readonly("n_iterations", &kcp::keypoint::VoxelSampler::Profile::n_iterations)
+      .def_readonly("sampling_time", &kcp::keypoint::VoxelSampler::Profile::sampling_time);
+
+  py::class_<kcp::keypoint::VoxelSampler> sampler(m, "VoxelSampler");
+  bind_voxel_sampler(sampler);
+
+  py::class_<kcp::keypoint::VoxelSamplerF> sampler_f(m, "VoxelSamplerF");
+  bind_voxel_sampler(sampler_f);
 
   py::class_<kcp::KCP::TEASER::Params>(m, "TEASERParams")
       .def(py::init<>())
@@ -67,17 +494,234 @@ PYBIND11_MODULE(pykcp, m) {
       .def_readwrite("max_clique_exact_solution", &kcp::KCP::TEASER::Params::max_clique_exact_solution)
       .def_readwrite("max_clique_time_limit", &kcp::KCP::TEASER::Params::max_clique_time_limit);
 
+  py::enum_<kcp::KCP::MaxCliqueBackend>(m, "MaxCliqueBackend")
+      .value("TEASER", kcp::KCP::MaxCliqueBackend::TEASER)
+      .value("BUILTIN", kcp::KCP::MaxCliqueBackend::BUILTIN);
+
   py::class_<kcp::KCP::Params>(m, "KCPParams")
       .def(py::init<>())
       .def_readwrite("k", &kcp::KCP::Params::k)
       .def_readwrite("verbose", &kcp::KCP::Params::verbose)
+      .def_readwrite("single_precision_features", &kcp::KCP::Params::single_precision_features)
+      .def_readwrite("n_threads", &kcp::KCP::Params::n_threads)
+      .def_readwrite("executor", &kcp::KCP::Params::executor)
+      .def_readwrite("max_correspondences", &kcp::KCP::Params::max_correspondences)
+      .def_readwrite("max_clique_density", &kcp::KCP::Params::max_clique_density)
+      .def_readwrite("max_clique_backend", &kcp::KCP::Params::max_clique_backend)
+      .def_readwrite("exclude_same_source", &kcp::KCP::Params::exclude_same_source)
+      .def_readwrite("refinement_iterations", &kcp::KCP::Params::refinement_iterations)
+      .def_readwrite("refinement_max_distance", &kcp::KCP::Params::refinement_max_distance)
+      .def_readwrite("refinement_normal_neighbors", &kcp::KCP::Params::refinement_normal_neighbors)
       .def_readwrite("teaser", &kcp::KCP::Params::teaser);
 
+  py::class_<kcp::Target, std::shared_ptr<kcp::Target>>(m, "Target")
+      .def("get_size", &kcp::Target::get_size)
+      .def("get_feature_dim", &kcp::Target::get_feature_dim);
+
+  py::class_<kcp::TargetIndex, kcp::Target, std::shared_ptr<kcp::TargetIndex>>(m, "TargetIndex")
+      .def(py::init<Eigen::MatrixX3d, const Eigen::MatrixXd &, bool>(),
+           py::arg("points"),
+           py::arg("features"),
+           py::arg("single_precision") = false,
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init<const Eigen::MatrixX3f &, const Eigen::MatrixXf &>(),
+           py::arg("points"),
+           py::arg("features"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_points", &kcp::TargetIndex::get_points, py::return_value_policy::reference_internal)
+      .def("is_single_precision", &kcp::TargetIndex::is_single_precision);
+
+  py::class_<kcp::LocalMap::Params>(m, "LocalMapParams")
+      .def(py::init<>())
+      .def_readwrite("voxel_size", &kcp::LocalMap::Params::voxel_size)
+      .def_readwrite("max_points_per_voxel", &kcp::LocalMap::Params::max_points_per_voxel)
+      .def_readwrite("radius", &kcp::LocalMap::Params::radius)
+      .def_readwrite("max_age", &kcp::LocalMap::Params::max_age);
+
+  py::class_<kcp::LocalMap, kcp::Target, std::shared_ptr<kcp::LocalMap>>(m, "LocalMap")
+      .def(py::init<const kcp::LocalMap::Params &>(), py::arg("params") = kcp::LocalMap::Params())
+      .def("insert", &kcp::LocalMap::insert, py::arg("scan"), py::arg("pose"), py::call_guard<py::gil_scoped_release>())
+      .def("clear", &kcp::LocalMap::clear)
+      .def("get_params", &kcp::LocalMap::get_params, py::return_value_policy::copy)
+      .def("get_points", &kcp::LocalMap::get_points, py::return_value_policy::reference_internal)
+      .def("get_n_voxels", &kcp::LocalMap::get_n_voxels);
+
+  py::class_<kcp::KCP::BudgetReport>(m, "BudgetReport")
+      .def(py::init<>())
+      .def_readonly("n_candidates", &kcp::KCP::BudgetReport::n_candidates)
+      .def_readonly("n_correspondences", &kcp::KCP::BudgetReport::n_correspondences)
+      .def_readonly("k", &kcp::KCP::BudgetReport::k)
+      .def_readonly("reduced_k", &kcp::KCP::BudgetReport::reduced_k)
+      .def_readonly("subsampled", &kcp::KCP::BudgetReport::subsampled)
+      .def_readonly("estimated_density", &kcp::KCP::BudgetReport::estimated_density)
+      .def_readonly("heuristic_clique", &kcp::KCP::BudgetReport::heuristic_clique);
+
+  py::class_<kcp::KCP::Profile>(m, "KCPProfile")
+      .def(py::init<>())
+      .def_readonly("n_src_points", &kcp::KCP::Profile::n_src_points)
+      .def_readonly("n_dst_points", &kcp::KCP::Profile::n_dst_points)
+      .def_readonly("n_correspondences", &kcp::KCP::Profile::n_correspondences)
+      .def_readonly("n_inliers", &kcp::KCP::Profile::n_inliers)
+      .def_readonly("n_refinement_iterations", &kcp::KCP::Profile::n_refinement_iterations)
+      .def_readonly("index_time", &kcp::KCP::Profile::index_time)
+      .def_readonly("correspondence_time", &kcp::KCP::Profile::correspondence_time)
+      .def_readonly("registration_time", &kcp::KCP::Profile::registration_time)
+      .def_readonly("clique_time", &kcp::KCP::Profile::clique_time)
+      .def_readonly("refinement_time", &kcp::KCP::Profile::refinement_time);
+
+  py::class_<kcp::KCP::CacheCounters>(m, "CacheCounters")
+      .def(py::init<>())
+      .def_readonly("hits", &kcp::KCP::CacheCounters::hits)
+      .def_readonly("misses", &kcp::KCP::CacheCounters::misses);
+
+  using SolveWithMatrices = void (kcp::KCP::*)(const Eigen::MatrixX3d &,
+                                               const Eigen::MatrixX3d &,
+                                               const Eigen::MatrixXd &,
+                                               const Eigen::MatrixXd &);
+  using SolveWithPlanes   = void (kcp::KCP::*)(const Eigen::MatrixX3d &,
+                                               const Eigen::MatrixX3d &,
+                                               const Eigen::MatrixXd &,
+                                               const Eigen::MatrixXd &,
+                                               const Eigen::MatrixX3d &,
+                                               const Eigen::MatrixX3d &);
+  using SolveWithIndex    = void (kcp::KCP::*)(const Eigen::MatrixX3d &, const Eigen::MatrixXd &, const kcp::Target &);
+  using SolveWithMatricesF = void (kcp::KCP::*)(const Eigen::MatrixX3f &,
+                                                const Eigen::MatrixX3f &,
+                                                const Eigen::MatrixXf &,
+                                                const Eigen::MatrixXf &);
+  using SolveWithIndexF    = void (kcp::KCP::*)(const Eigen::MatrixX3f &, const Eigen::MatrixXf &, const kcp::Target &);
+
+  // Without conversions, float64 arrays match the double precision overloads
+  // and float32 arrays match the single precision ones. Other inputs are
+  // converted for the double precision overloads, which are registered first.
+
+  m.def("install_output_filter", &kcp::install_output_filter);
+
   py::class_<kcp::KCP>(m, "KCP")
       .def(py::init<kcp::KCP::Params>())
       .def("get_params", &kcp::KCP::get_params, py::return_value_policy::reference)
-      .def("get_initial_correspondences", &kcp::KCP::get_initial_correspondences)
+      .def("get_initial_correspondences", &kcp::KCP::get_initial_correspondences, py::return_value_policy::reference_internal)
       .def("get_inlier_correspondence_indices", &kcp::KCP::get_inlier_correspondence_indices)
-      .def("solve", &kcp::KCP::solve)
+      .def("get_target_index", [](const kcp::KCP &self) { return std::const_pointer_cast<kcp::TargetIndex>(self.get_target_index()); })
+      .def("get_budget_report", &kcp::KCP::get_budget_report, py::return_value_policy::copy)
+      .def("get_profile", &kcp::KCP::get_profile, py::return_value_policy::copy)
+      .def("get_target_index_counters", &kcp::KCP::get_target_index_counters, py::return_value_policy::copy)
+      .def("reset_target_index_counters", &kcp::KCP::reset_target_index_counters)
+      .def("solve", static_cast<SolveWithMatrices>(&kcp::KCP::solve),
+           py::arg("src"),
+           py::arg("dst"),
+           py::arg("src_feature"),
+           py::arg("dst_feature"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("solve", static_cast<SolveWithPlanes>(&kcp::KCP::solve),
+           py::arg("src"),
+           py::arg("dst"),
+           py::arg("src_feature"),
+           py::arg("dst_feature"),
+           py::arg("src_plane_points"),
+           py::arg("dst_plane_points"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("solve", static_cast<SolveWithIndex>(&kcp::KCP::solve),
+           py::arg("src"),
+           py::arg("src_feature"),
+           py::arg("dst"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("solve", static_cast<SolveWithMatricesF>(&kcp::KCP::solve),
+           py::arg("src"),
+           py::arg("dst"),
+           py::arg("src_feature"),
+           py::arg("dst_feature"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("solve", static_cast<SolveWithIndexF>(&kcp::KCP::solve),
+           py::arg("src"),
+           py::arg("src_feature"),
+           py::arg("dst"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("refine", &kcp::KCP::refine,
+           py::arg("src_plane_points"),
+           py::arg("dst_plane_points"),
+           py::call_guard<py::gil_scoped_release>())
       .def("get_solution", &kcp::KCP::get_solution);
-}
\ No newline at end of file
+
+  py::class_<kcp::SequentialKCP>(m, "SequentialKCP")
+      .def(py::init<kcp::KCP::Params>())
+      .def("push", &kcp::SequentialKCP::push,
+           py::arg("points"),
+           py::arg("features"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("reset", &kcp::SequentialKCP::reset)
+      .def("get_solver", &kcp::SequentialKCP::get_solver, py::return_value_policy::reference_internal)
+      .def("get_solution", &kcp::SequentialKCP::get_solution)
+      .def("get_pose", &kcp::SequentialKCP::get_pose);
+
+  py::class_<kcp::BatchKCP::Job>(m, "BatchJob")
+      .def(py::init<>())
+      .def(py::init([](Eigen::MatrixX3d src, Eigen::MatrixX3d dst, Eigen::MatrixXd src_feature, Eigen::MatrixXd dst_feature) {
+             return kcp::BatchKCP::Job{std::move(src), std::move(dst), std::move(src_feature), std::move(dst_feature)};
+           }),
+           py::arg("src"),
+           py::arg("dst"),
+           py::arg("src_feature"),
+           py::arg("dst_feature"))
+      .def_readwrite("src", &kcp::BatchKCP::Job::src)
+      .def_readwrite("dst", &kcp::BatchKCP::Job::dst)
+      .def_readwrite("src_feature", &kcp::BatchKCP::Job::src_feature)
+      .def_readwrite("dst_feature", &kcp::BatchKCP::Job::dst_feature);
+
+  py::class_<kcp::BatchKCP::Result>(m, "BatchResult")
+      .def_readonly("solution", &kcp::BatchKCP::Result::solution)
+      .def_readonly("n_correspondences", &kcp::BatchKCP::Result::n_correspondences)
+      .def_readonly("n_inliers", &kcp::BatchKCP::Result::n_inliers)
+      .def_readonly("time", &kcp::BatchKCP::Result::time)
+      .def_readonly("profile", &kcp::BatchKCP::Result::profile);
+
+  // Jobs are converted with the GIL held, and solved without it
+  py::class_<kcp::BatchKCP>(m, "BatchKCP")
+      .def(py::init<kcp::KCP::Params>())
+      .def("get_params", &kcp::BatchKCP::get_params, py::return_value_policy::reference)
+      .def("get_n_workers", &kcp::BatchKCP::get_n_workers)
+      .def("solve", &kcp::BatchKCP::solve, py::arg("jobs"), py::call_guard<py::gil_scoped_release>());
+
+  py::class_<kcp::StreamingOdometry::Params>(m, "StreamingOdometryParams")
+      .def(py::init<>())
+      .def_readwrite("kcp", &kcp::StreamingOdometry::Params::kcp)
+      .def_readwrite("keypoint", &kcp::StreamingOdometry::Params::keypoint)
+      .def_readwrite("max_corner_points", &kcp::StreamingOdometry::Params::max_corner_points)
+      .def_readwrite("deskew", &kcp::StreamingOdometry::Params::deskew)
+      .def_readwrite("deskew_layout", &kcp::StreamingOdometry::Params::deskew_layout)
+      .def_readwrite("filter", &kcp::StreamingOdometry::Params::filter)
+      .def_readwrite("sensor_model", &kcp::StreamingOdometry::Params::sensor_model)
+      .def_readwrite("hfov_resolution", &kcp::StreamingOdometry::Params::hfov_resolution)
+      .def_readwrite("queue_capacity", &kcp::StreamingOdometry::Params::queue_capacity);
+
+  py::class_<kcp::StreamingOdometry::Result>(m, "StreamingOdometryResult")
+      .def_readonly("index", &kcp::StreamingOdometry::Result::index)
+      .def_readonly("pose", &kcp::StreamingOdometry::Result::pose)
+      .def_readonly("solution", &kcp::StreamingOdometry::Result::solution)
+      .def_readonly("n_corner_points", &kcp::StreamingOdometry::Result::n_corner_points)
+      .def_readonly("n_plane_points", &kcp::StreamingOdometry::Result::n_plane_points);
+
+  // The callback is called by the solver thread, so it acquires the GIL, and
+  // blocking methods (including closing the pipeline before destruction)
+  // release the GIL to let the callback run
+  py::class_<kcp::StreamingOdometry, std::unique_ptr<kcp::StreamingOdometry, StreamingOdometryDeleter>>(
+      m, "StreamingOdometry")
+      .def(py::init([](const kcp::StreamingOdometry::Params &params, py::function callback) {
+             auto function = std::make_shared<py::function>(std::move(callback));
+             return new kcp::StreamingOdometry(params, [function](const kcp::StreamingOdometry::Result &result) {
+               py::gil_scoped_acquire acquire;
+               (*function)(result);
+             });
+           }),
+           py::arg("params"),
+           py::arg("callback"))
+      .def("push", &kcp::StreamingOdometry::push, py::arg("cloud"), py::call_guard<py::gil_scoped_release>())
+      .def("flush", &kcp::StreamingOdometry::flush, py::call_guard<py::gil_scoped_release>())
+      .def("close", &kcp::StreamingOdometry::close, py::call_guard<py::gil_scoped_release>())
+      .def("__enter__", [](kcp::StreamingOdometry &self) -> kcp::StreamingOdometry & { return self; },
+           py::return_value_policy::reference)
+      .def("__exit__", [](kcp::StreamingOdometry &self, py::args) {
+        py::gil_scoped_release release;
+        self.close();
+      });
+}
@@ -0,0 +1,384 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <kcp/clique.hpp>
+#include <kcp/keypoint.hpp>
+#include <kcp/parallel.hpp>
+#include <kcp/solver.hpp>
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pcd.hpp"
+
+namespace {
+
+/**
+ * @brief The bound of consistent correspondences used by the tests.
+ *
+ */
+constexpr double BOUND = 0.12;
+
+/**
+ * @brief Generate correspondences of random source points, each of which has
+ * ``group_size`` contiguous correspondences. Targets are a rigid transform of
+ * their source points perturbed by up to ``noise``, so that differences of
+ * distances spread around ``BOUND``, except for a fraction ``outlier_ratio``
+ * of random targets.
+ *
+ */
+kcp::Correspondences make_correspondences(size_t n_sources,
+                                          size_t group_size,
+                                          double noise,
+                                          std::mt19937 &rng,
+                                          double outlier_ratio = 0) {
+  std::uniform_real_distribution<double> coordinate(-10, 10);
+  std::uniform_real_distribution<double> perturbation(-noise, noise);
+  std::bernoulli_distribution is_outlier(outlier_ratio);
+  const Eigen::Matrix3d rotation = Eigen::AngleAxisd(0.3, Eigen::Vector3d(1, 2, 3).normalized()).toRotationMatrix();
+  const Eigen::Vector3d translation(1, -2, 0.5);
+
+  const size_t n_vertices = n_sources * group_size;
+  kcp::Correspondences correspondences;
+  correspondences.points.first.resize(3, n_vertices);
+  correspondences.points.second.resize(3, n_vertices);
+  correspondences.indices.first.resize(n_vertices);
+  correspondences.indices.second.resize(n_vertices);
+  for (size_t source = 0; source < n_sources; ++source) {
+    const Eigen::Vector3d point(coordinate(rng), coordinate(rng), coordinate(rng));
+    for (size_t i = 0; i < group_size; ++i) {
+      const size_t vertex = source * group_size + i;
+      const Eigen::Vector3d offset(perturbation(rng), perturbation(rng), perturbation(rng));
+      correspondences.points.first.col(vertex)  = point;
+      correspondences.points.second.col(vertex) = rotation * point + translation + offset;
+      if (is_outlier(rng)) correspondences.points.second.col(vertex) = Eigen::Vector3d(coordinate(rng), coordinate(rng), coordinate(rng));
+      correspondences.indices.first[vertex]     = static_cast<int>(source);
+      correspondences.indices.second[vertex]    = static_cast<int>(vertex);
+    }
+  }
+  return correspondences;
+}
+
+/**
+ * @brief Reorder correspondences of ``make_correspondences`` so that the ones
+ * of a source point are interleaved with the ones of the others.
+ *
+ */
+kcp::Correspondences interleave(const kcp::Correspondences &correspondences, size_t group_size) {
+  const size_t n_vertices = correspondences.points.first.cols();
+  const size_t n_sources  = n_vertices / group_size;
+
+  kcp::Correspondences interleaved = correspondences;
+  for (size_t i = 0; i < group_size; ++i) {
+    for (size_t source = 0; source < n_sources; ++source) {
+      const size_t from = source * group_size + i, to = i * n_sources + source;
+      interleaved.points.first.col(to)  = correspondences.points.first.col(from);
+      interleaved.points.second.col(to) = correspondences.points.second.col(from);
+      interleaved.indices.first[to]     = correspondences.indices.first[from];
+      interleaved.indices.second[to]    = correspondences.indices.second[from];
+    }
+  }
+  return interleaved;
+}
+
+/**
+ * @brief The exact consistency test, computed in the same order of operations
+ * as the graph (from the smaller vertex to the larger one).
+ *
+ */
+bool is_consistent(const kcp::Correspondences &correspondences, size_t i, size_t j, double bound) {
+  const size_t first = std::min(i, j), second = std::max(i, j);
+  const Eigen::Matrix3Xd &src = correspondences.points.first;
+  const Eigen::Matrix3Xd &dst = correspondences.points.second;
+
+  const double src_dx       = src(0, second) - src(0, first);
+  const double src_dy       = src(1, second) - src(1, first);
+  const double src_dz       = src(2, second) - src(2, first);
+  const double dst_dx       = dst(0, second) - dst(0, first);
+  const double dst_dy       = dst(1, second) - dst(1, first);
+  const double dst_dz       = dst(2, second) - dst(2, first);
+  const double src_distance = std::sqrt(src_dx * src_dx + src_dy * src_dy + src_dz * src_dz);
+  const double dst_distance = std::sqrt(dst_dx * dst_dx + dst_dy * dst_dy + dst_dz * dst_dz);
+  return std::abs(src_distance - dst_distance) <= bound;
+}
+
+/**
+ * @brief Expect the graph to match the exact test, where correspondences of
+ * the same source point are never adjacent.
+ *
+ */
+void expect_exact_adjacency(const kcp::ConsistencyGraph &graph, const kcp::Correspondences &correspondences) {
+  const std::vector<int> &groups = correspondences.indices.first;
+  const size_t n_vertices        = correspondences.points.first.cols();
+  ASSERT_EQ(graph.get_n_vertices(), n_vertices);
+
+  size_t n_mismatches = 0;
+  for (size_t i = 0; i < n_vertices; ++i) {
+    for (size_t j = 0; j < n_vertices; ++j) {
+      const bool same_source = i == j || (!groups.empty() && groups[i] == groups[j]);
+      const bool expected    = !same_source && is_consistent(correspondences, i, j, BOUND);
+      n_mismatches += graph.is_adjacent(i, j) != expected;
+    }
+  }
+  EXPECT_EQ(n_mismatches, 0u);
+}
+
+/**
+ * @brief The size of the maximum clique by enumerating all cliques.
+ *
+ */
+size_t brute_force_max_clique(const kcp::ConsistencyGraph &graph, std::vector<int> &clique, int next) {
+  size_t best = clique.size();
+  for (int vertex = next; vertex < static_cast<int>(graph.get_n_vertices()); ++vertex) {
+    bool adjacent = true;
+    for (const int member : clique) adjacent = adjacent && graph.is_adjacent(member, vertex);
+    if (!adjacent) continue;
+
+    clique.push_back(vertex);
+    best = std::max(best, brute_force_max_clique(graph, clique, vertex + 1));
+    clique.pop_back();
+  }
+  return best;
+}
+
+/**
+ * @brief Expect the vertices to be ascending and pairwise adjacent.
+ *
+ */
+void expect_clique(const kcp::ConsistencyGraph &graph, const std::vector<int> &clique) {
+  EXPECT_TRUE(std::is_sorted(clique.begin(), clique.end()));
+  for (size_t i = 0; i < clique.size(); ++i) {
+    for (size_t j = i + 1; j < clique.size(); ++j) EXPECT_TRUE(graph.is_adjacent(clique[i], clique[j]));
+  }
+}
+
+};  // namespace
+
+/* ---------------------------- ConsistencyGraph ---------------------------- */
+
+TEST(ConsistencyGraphTest, MatchesExactTestOnRandomCorrespondences) {
+  std::mt19937 rng(1);
+  for (const size_t group_size : {1, 2, 3}) {
+    const kcp::Correspondences correspondences = make_correspondences(150, group_size, BOUND, rng);
+
+    kcp::ConsistencyGraph graph;
+    graph.build(correspondences, BOUND);
+    expect_exact_adjacency(graph, correspondences);
+  }
+}
+
+TEST(ConsistencyGraphTest, MatchesExactTestNearBound) {
+  // Pairs of correspondences whose differences of distances are within a tiny
+  // relative error of the bound, where the squared distance bounds cannot
+  // settle the test
+  const std::vector<double> errors = {-1e-3, -1e-7, -1e-10, -1e-14, 0, 1e-14, 1e-10, 1e-7, 1e-3};
+  kcp::Correspondences correspondences;
+  correspondences.points.first.resize(3, 2 * errors.size());
+  correspondences.points.second.resize(3, 2 * errors.size());
+  for (size_t idx = 0; idx < errors.size(); ++idx) {
+    const double distance   = 1 + idx;
+    const Eigen::Vector3d a = Eigen::Vector3d(0, 0, 10.0 * idx);
+    const Eigen::Vector3d b = a + Eigen::Vector3d(0.6, 0.8, 0) * distance;
+    const Eigen::Vector3d c = a + Eigen::Vector3d(0.6, 0.8, 0) * (distance + BOUND * (1 + errors[idx]));
+
+    correspondences.points.first.col(2 * idx)       = a;
+    correspondences.points.second.col(2 * idx)      = a;
+    correspondences.points.first.col(2 * idx + 1)   = b;
+    correspondences.points.second.col(2 * idx + 1)  = c;
+  }
+
+  kcp::ConsistencyGraph graph;
+  graph.build(correspondences, BOUND);
+  expect_exact_adjacency(graph, correspondences);
+
+  // The clearly separated pairs are settled as expected
+  EXPECT_TRUE(graph.is_adjacent(0, 1));
+  EXPECT_FALSE(graph.is_adjacent(2 * (errors.size() - 1), 2 * (errors.size() - 1) + 1));
+}
+
+TEST(ConsistencyGraphTest, ExcludesCorrespondencesOfSameSource) {
+  std::mt19937 rng(2);
+
+  // Without noise, all pairs are consistent except the ones of the same source
+  // point
+  const kcp::Correspondences correspondences = make_correspondences(40, 3, 0, rng);
+  kcp::ConsistencyGraph graph;
+  graph.build(correspondences, BOUND);
+  expect_exact_adjacency(graph, correspondences);
+  EXPECT_EQ(graph.get_n_edges(), 120u * 117u / 2);
+
+  // Without source indices, all correspondences are distinct source points
+  kcp::Correspondences anonymous = correspondences;
+  anonymous.indices.first.clear();
+  graph.build(anonymous, BOUND);
+  expect_exact_adjacency(graph, anonymous);
+  EXPECT_EQ(graph.get_n_edges(), 120u * 119u / 2);
+
+  // So are they if the exclusion is disabled, as in TEASER++
+  graph.build(correspondences, BOUND, nullptr, false);
+  expect_exact_adjacency(graph, anonymous);
+  EXPECT_EQ(graph.get_n_edges(), 120u * 119u / 2);
+  EXPECT_EQ(graph.get_groups()[1], 1);
+}
+
+TEST(ConsistencyGraphTest, ExcludesInterleavedCorrespondencesOfSameSource) {
+  std::mt19937 rng(6);
+  const kcp::Correspondences correspondences = interleave(make_correspondences(40, 3, 0, rng), 3);
+  kcp::ConsistencyGraph graph;
+  graph.build(correspondences, BOUND);
+  expect_exact_adjacency(graph, correspondences);
+  EXPECT_EQ(graph.get_n_edges(), 120u * 117u / 2);
+}
+
+TEST(ConsistencyGraphTest, DoesNotDependOnThreads) {
+  std::mt19937 rng(3);
+  const kcp::Correspondences correspondences = make_correspondences(300, 2, BOUND, rng);
+
+  kcp::ConsistencyGraph serial, parallel;
+  kcp::ThreadPool pool(4);
+  serial.build(correspondences, BOUND);
+  parallel.build(correspondences, BOUND, &pool);
+  ASSERT_EQ(serial.get_n_words(), parallel.get_n_words());
+  for (size_t vertex = 0; vertex < serial.get_n_vertices(); ++vertex) {
+    EXPECT_TRUE(std::equal(serial.get_row(vertex), serial.get_row(vertex) + serial.get_n_words(), parallel.get_row(vertex)));
+  }
+}
+
+/* ----------------------------- find_max_clique ---------------------------- */
+
+TEST(FindMaxCliqueTest, MatchesBruteForceOnSmallGraphs) {
+  std::mt19937 rng(4);
+  std::uniform_int_distribution<size_t> n_sources(1, 11);
+  std::uniform_int_distribution<size_t> group_size(1, 2);
+  std::uniform_real_distribution<double> noise(0, 4 * BOUND);
+  std::uniform_real_distribution<double> outlier_ratio(0, 1);
+  for (int trial = 0; trial < 200; ++trial) {
+    const kcp::Correspondences correspondences =
+        make_correspondences(n_sources(rng), group_size(rng), noise(rng), rng, outlier_ratio(rng));
+    kcp::ConsistencyGraph graph;
+    graph.build(correspondences, BOUND);
+
+    std::vector<int> buffer;
+    const size_t expected = brute_force_max_clique(graph, buffer, 0);
+
+    const std::vector<int> clique = kcp::find_max_clique(graph, true);
+    expect_clique(graph, clique);
+    EXPECT_EQ(clique.size(), expected) << "trial " << trial;
+
+    const std::vector<int> greedy = kcp::find_max_clique(graph, false);
+    expect_clique(graph, greedy);
+    EXPECT_LE(greedy.size(), expected);
+  }
+}
+
+TEST(FindMaxCliqueTest, DoesNotDependOnOrderOfCorrespondences) {
+  // The bound by source points must hold if correspondences of a source point
+  // are not contiguous
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<size_t> n_sources(1, 8);
+  std::uniform_int_distribution<size_t> group_size(2, 3);
+  std::uniform_real_distribution<double> noise(0, 4 * BOUND);
+  std::uniform_real_distribution<double> outlier_ratio(0, 1);
+  for (int trial = 0; trial < 200; ++trial) {
+    const size_t size = group_size(rng);
+    const kcp::Correspondences correspondences =
+        interleave(make_correspondences(n_sources(rng), size, noise(rng), rng, outlier_ratio(rng)), size);
+    kcp::ConsistencyGraph graph;
+    graph.build(correspondences, BOUND);
+
+    std::vector<int> buffer;
+    const size_t expected = brute_force_max_clique(graph, buffer, 0);
+
+    const std::vector<int> clique = kcp::find_max_clique(graph, true);
+    expect_clique(graph, clique);
+    EXPECT_EQ(clique.size(), expected) << "trial " << trial;
+  }
+
+  for (const double outlier_ratio : {0.5, 0.9}) {
+    const kcp::Correspondences contiguous  = make_correspondences(200, 3, BOUND / 4, rng, outlier_ratio);
+    const kcp::Correspondences interleaved = interleave(contiguous, 3);
+    kcp::ConsistencyGraph contiguous_graph, interleaved_graph;
+    contiguous_graph.build(contiguous, BOUND);
+    interleaved_graph.build(interleaved, BOUND);
+
+    const std::vector<int> clique = kcp::find_max_clique(interleaved_graph, true);
+    expect_clique(interleaved_graph, clique);
+    EXPECT_EQ(clique.size(), kcp::find_max_clique(contiguous_graph, true).size());
+  }
+}
+
+TEST(FindMaxCliqueTest, DoesNotDependOnThreads) {
+  std::mt19937 rng(5);
+  for (const double outlier_ratio : {0.5, 0.9}) {
+    const kcp::Correspondences correspondences = make_correspondences(400, 2, BOUND / 4, rng, outlier_ratio);
+    kcp::ConsistencyGraph graph;
+    graph.build(correspondences, BOUND);
+
+    const std::vector<int> serial = kcp::find_max_clique(graph, true);
+    expect_clique(graph, serial);
+    for (const size_t n_workers : {2, 4, 7}) {
+      kcp::ThreadPool pool(n_workers);
+      EXPECT_EQ(kcp::find_max_clique(graph, true, &pool), serial) << n_workers << " workers";
+      EXPECT_EQ(kcp::find_max_clique(graph, false, &pool), kcp::find_max_clique(graph, false));
+    }
+  }
+}
+
+TEST(FindMaxCliqueTest, KeepsGreedyCliqueAtTimeLimit) {
+  std::mt19937 rng(8);
+  const kcp::Correspondences correspondences = make_correspondences(400, 2, BOUND / 4, rng, 0.9);
+  kcp::ConsistencyGraph graph;
+  graph.build(correspondences, BOUND);
+
+  // The exact search is stopped before any branch, and a long time limit
+  // does not change the result
+  const std::vector<int> greedy = kcp::find_max_clique(graph, false);
+  EXPECT_EQ(kcp::find_max_clique(graph, true, nullptr, 0), greedy);
+  EXPECT_EQ(kcp::find_max_clique(graph, true, nullptr, 3600), kcp::find_max_clique(graph, true));
+}
+
+/* ------------------------------ KCP backends ------------------------------ */
+
+TEST(KCPTest, BuiltinBackendAgreesWithTeaser) {
+  const Eigen::MatrixX3d src_cloud = load_pcd(std::string(KCP_TEST_DATA_DIR) + "/1531883530.949817000.pcd");
+  const Eigen::MatrixX3d dst_cloud = load_pcd(std::string(KCP_TEST_DATA_DIR) + "/1531883530.449377000.pcd");
+  const Eigen::MatrixX3d src = kcp::keypoint::MultiScaleCurvature(src_cloud).get_corner_points();
+  const Eigen::MatrixX3d dst = kcp::keypoint::MultiScaleCurvature(dst_cloud).get_corner_points();
+
+  kcp::KCP::Params params;
+  params.k                  = 2;
+  params.teaser.noise_bound = 0.06;
+
+  kcp::KCP teaser_solver(params);
+  teaser_solver.solve(src, dst, src, dst);
+
+  params.max_clique_backend = kcp::KCP::MaxCliqueBackend::BUILTIN;
+  kcp::KCP builtin_solver(params);
+  builtin_solver.solve(src, dst, src, dst);
+
+  // TEASER++ also connects correspondences of the same source point, so its
+  // maximum clique is at least as large. Both estimate the same motion
+  const size_t n_teaser_inliers  = teaser_solver.get_inlier_correspondence_indices().size();
+  const size_t n_builtin_inliers = builtin_solver.get_inlier_correspondence_indices().size();
+  EXPECT_GT(n_builtin_inliers, 10u);
+  EXPECT_LE(n_builtin_inliers, n_teaser_inliers);
+
+  const Eigen::Matrix4d difference = teaser_solver.get_solution().inverse() * builtin_solver.get_solution();
+  const double angle = Eigen::AngleAxisd(Eigen::Matrix3d(difference.topLeftCorner(3, 3))).angle();
+  EXPECT_LT(difference.topRightCorner(3, 1).norm(), 0.05);
+  EXPECT_LT(angle, 0.5 * M_PI / 180);
+
+  // Connecting correspondences of the same source point builds the graph of
+  // TEASER++, whose maximum cliques are of the same size
+  params.exclude_same_source = false;
+  kcp::KCP parity_solver(params);
+  parity_solver.solve(src, dst, src, dst);
+  EXPECT_EQ(parity_solver.get_inlier_correspondence_indices().size(), n_teaser_inliers);
+}
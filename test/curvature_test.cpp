@@ -0,0 +1,134 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <kcp/curvature.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+using kcp::keypoint::CURVATURE_HALO;
+using kcp::keypoint::CurvatureKernel;
+
+/**
+ * @brief The maximum depth of the random depth rows.
+ *
+ */
+constexpr float MAX_DEPTH = 80;
+
+/**
+ * @brief The tolerance between kernels, which is a few ULPs of the
+ * intermediate sums of depths up to MAX_DEPTH.
+ *
+ */
+constexpr float TOLERANCE = 1e-5f * MAX_DEPTH;
+
+/**
+ * @brief Random depths with occasional jumps, as at the edges of objects.
+ *
+ */
+std::vector<float> random_depths(int size, std::mt19937 &rng) {
+  std::uniform_real_distribution<float> depth(1, MAX_DEPTH);
+  std::uniform_real_distribution<float> step(-0.05f, 0.05f);
+  std::bernoulli_distribution jump(0.1);
+
+  std::vector<float> depths(size);
+  float current = depth(rng);
+  for (float &value : depths) {
+    current = jump(rng) ? depth(rng) : std::min(std::max(current + step(rng), 1.0f), MAX_DEPTH);
+    value   = current;
+  }
+  return depths;
+}
+
+/**
+ * @brief Compute the curvature of a padded depth row by the division-based
+ * formula.
+ *
+ */
+std::vector<float> reference_curvature(const std::vector<float> &padded, int size) {
+  std::vector<float> curvature(size);
+  for (int j = 0; j < size; ++j) {
+    const double center = padded[j + CURVATURE_HALO];
+    double sum          = 0;
+    for (int m = 1; m <= CURVATURE_HALO; ++m) {
+      sum += (padded[j + CURVATURE_HALO - m] + padded[j + CURVATURE_HALO + m] - 2 * center) / m;
+    }
+    curvature[j] = static_cast<float>(std::abs(sum));
+  }
+  return curvature;
+}
+
+/**
+ * @brief Pad a depth row and compute its curvature by the given kernel.
+ *
+ */
+std::vector<float> calculate(const std::vector<float> &depths, CurvatureKernel kernel) {
+  const int size = static_cast<int>(depths.size());
+  std::vector<float> padded(size + 2 * CURVATURE_HALO), curvature(size);
+  kcp::keypoint::pad_cyclic_depth(depths.data(), size, padded.data());
+  kcp::keypoint::calculate_curvature(padded.data(), size, curvature.data(), kernel);
+  return curvature;
+}
+
+};  // namespace
+
+TEST(CurvatureTest, ResolvesToSupportedKernels) {
+  EXPECT_EQ(kcp::keypoint::resolve_curvature_kernel(CurvatureKernel::SCALAR), CurvatureKernel::SCALAR);
+
+  // A resolved kernel resolves to itself
+  for (const CurvatureKernel kernel : {CurvatureKernel::AUTO, CurvatureKernel::AVX2, CurvatureKernel::AVX512}) {
+    const CurvatureKernel resolved = kcp::keypoint::resolve_curvature_kernel(kernel);
+    EXPECT_NE(resolved, CurvatureKernel::AUTO);
+    EXPECT_EQ(kcp::keypoint::resolve_curvature_kernel(resolved), resolved);
+  }
+}
+
+TEST(CurvatureTest, PadsDepthsCyclically) {
+  const int size = 12;
+  std::vector<float> depths(size), padded(size + 2 * CURVATURE_HALO);
+  for (int idx = 0; idx < size; ++idx) depths[idx] = static_cast<float>(idx);
+  kcp::keypoint::pad_cyclic_depth(depths.data(), size, padded.data());
+
+  for (int m = 1; m <= CURVATURE_HALO; ++m) {
+    EXPECT_EQ(padded[CURVATURE_HALO - m], depths[size - 1 - m]);
+    EXPECT_EQ(padded[CURVATURE_HALO + size - 1 + m], depths[m]);
+  }
+  EXPECT_TRUE(std::equal(depths.begin(), depths.end(), padded.begin() + CURVATURE_HALO));
+}
+
+TEST(CurvatureTest, ScalarKernelMatchesDivisionBasedFormula) {
+  std::mt19937 rng(1);
+  for (const int size : {CURVATURE_HALO + 1, 17, 100, 1800}) {
+    const std::vector<float> depths = random_depths(size, rng);
+    std::vector<float> padded(size + 2 * CURVATURE_HALO);
+    kcp::keypoint::pad_cyclic_depth(depths.data(), size, padded.data());
+
+    const std::vector<float> expected = reference_curvature(padded, size);
+    const std::vector<float> actual   = calculate(depths, CurvatureKernel::SCALAR);
+    for (int j = 0; j < size; ++j) EXPECT_NEAR(actual[j], expected[j], TOLERANCE) << "size " << size << ", point " << j;
+  }
+}
+
+TEST(CurvatureTest, SimdKernelsMatchScalarKernel) {
+  // Sizes cover full vectors and every tail of the 8-wide and 16-wide
+  // kernels. Kernels unsupported by the running CPU resolve to the scalar one
+  std::mt19937 rng(2);
+  for (const CurvatureKernel requested : {CurvatureKernel::AVX2, CurvatureKernel::AVX512}) {
+    const CurvatureKernel kernel = kcp::keypoint::resolve_curvature_kernel(requested);
+    for (int size = CURVATURE_HALO + 1; size <= 80; ++size) {
+      const std::vector<float> depths   = random_depths(size, rng);
+      const std::vector<float> expected = calculate(depths, CurvatureKernel::SCALAR);
+      const std::vector<float> actual   = calculate(depths, kernel);
+      for (int j = 0; j < size; ++j) {
+        EXPECT_NEAR(actual[j], expected[j], TOLERANCE)
+            << "kernel " << static_cast<int>(kernel) << ", size " << size << ", point " << j;
+      }
+    }
+  }
+}
@@ -0,0 +1,298 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <kcp/keypoint.hpp>
+#include <kcp/parallel.hpp>
+#include <kcp/sensor.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pcd.hpp"
+
+namespace {
+
+/**
+ * @brief The layout of the synthetic range images used by the tests.
+ *
+ */
+constexpr int N_CHANNELS = 16;
+constexpr int N_COLUMNS  = 360;
+
+/**
+ * @brief The point at the center of a pixel of the spherical projection with
+ * the given depth.
+ *
+ */
+Eigen::RowVector3d pixel_point(const kcp::SensorModel &sensor_model, int channel, int column, double depth) {
+  const double elevation = sensor_model.get_elevations_deg()[channel] * M_PI / 180;
+  const double azimuth   = (column + 0.5) * 2 * M_PI / N_COLUMNS - M_PI;
+  return depth * Eigen::RowVector3d(std::cos(elevation) * std::cos(azimuth),
+                                    std::cos(elevation) * std::sin(azimuth),
+                                    std::sin(elevation));
+}
+
+/**
+ * @brief Whether the synthetic scan has a return at the pixel.
+ *
+ */
+bool has_return(int channel, int column) { return (7 * channel + column) % 5 != 0; }
+
+/**
+ * @brief The depth of the synthetic scan at the pixel.
+ *
+ */
+double pixel_depth(int channel, int column) { return 5 + channel + 0.01 * column; }
+
+/**
+ * @brief Expect two range images to have the same pixels and sequences.
+ *
+ */
+template <typename Scalar>
+void expect_same_range_image(const kcp::keypoint::BasicRangeImage<Scalar> &actual,
+                             const kcp::keypoint::BasicRangeImage<Scalar> &expected) {
+  EXPECT_EQ(actual.get_image_indices(), expected.get_image_indices());
+  EXPECT_EQ(actual.get_image_depth_sequence(), expected.get_image_depth_sequence());
+  EXPECT_EQ(actual.get_image_point_indices_sequence(), expected.get_image_point_indices_sequence());
+  EXPECT_EQ(actual.get_image_col_indices_sequence(), expected.get_image_col_indices_sequence());
+  EXPECT_EQ(actual.get_channel_start_indices(), expected.get_channel_start_indices());
+  EXPECT_EQ(actual.get_channel_end_indices(), expected.get_channel_end_indices());
+}
+
+/**
+ * @brief Expect two extractions to select the same keypoints.
+ *
+ */
+template <typename Scalar>
+void expect_same_keypoints(const kcp::keypoint::BasicMultiScaleCurvature<Scalar> &actual,
+                           const kcp::keypoint::BasicMultiScaleCurvature<Scalar> &expected) {
+  EXPECT_EQ(actual.get_corner_point_indices(), expected.get_corner_point_indices());
+  EXPECT_EQ(actual.get_plane_point_indices(), expected.get_plane_point_indices());
+  EXPECT_EQ(actual.get_corner_point_curvatures(), expected.get_corner_point_curvatures());
+  EXPECT_EQ(actual.get_corner_points(), expected.get_corner_points());
+  EXPECT_EQ(actual.get_plane_points(), expected.get_plane_points());
+}
+
+/**
+ * @brief Load a bundled scan.
+ *
+ */
+Eigen::MatrixX3d load_scan(const std::string &name) {
+  return load_pcd(std::string(KCP_TEST_DATA_DIR) + "/" + name + ".pcd");
+}
+
+};  // namespace
+
+/* ------------------------------- RangeImage ------------------------------- */
+
+TEST(RangeImageTest, ProjectsPointsToTheirPixels) {
+  const kcp::SensorModel sensor_model = kcp::SensorModel::uniform(N_CHANNELS, -15, 15);
+
+  // Points of the pixels with returns in a random order, followed by a
+  // farther point of the first pixel, which is not kept
+  std::vector<std::pair<int, int>> pixels;
+  for (int channel = 0; channel < N_CHANNELS; ++channel) {
+    for (int column = 0; column < N_COLUMNS; ++column) {
+      if (has_return(channel, column)) pixels.emplace_back(channel, column);
+    }
+  }
+  std::mt19937 rng(1);
+  std::shuffle(pixels.begin(), pixels.end(), rng);
+
+  Eigen::MatrixX3d cloud(pixels.size() + 1, 3);
+  for (size_t idx = 0; idx < pixels.size(); ++idx) {
+    const int channel = pixels[idx].first, column = pixels[idx].second;
+    cloud.row(idx)    = pixel_point(sensor_model, channel, column, pixel_depth(channel, column));
+  }
+  cloud.row(pixels.size()) = 2 * cloud.row(0);
+
+  const kcp::keypoint::RangeImage range_image(cloud, sensor_model, N_COLUMNS);
+  const Eigen::MatrixXi &image_indices = range_image.get_image_indices();
+  ASSERT_EQ(image_indices.rows(), N_CHANNELS);
+  ASSERT_EQ(image_indices.cols(), N_COLUMNS);
+  for (size_t idx = 0; idx < pixels.size(); ++idx) {
+    EXPECT_EQ(image_indices(pixels[idx].first, pixels[idx].second), static_cast<int>(idx));
+  }
+  EXPECT_EQ((image_indices.array() >= 0).count(), static_cast<Eigen::Index>(pixels.size()));
+  EXPECT_EQ(range_image.get_profile().n_points, static_cast<size_t>(cloud.rows()));
+  EXPECT_EQ(range_image.get_profile().n_projected_points, pixels.size());
+
+  // Sequences follow channels and then columns
+  const std::vector<int> &start_indices = range_image.get_channel_start_indices();
+  const std::vector<int> &end_indices   = range_image.get_channel_end_indices();
+  ASSERT_EQ(start_indices.size(), static_cast<size_t>(N_CHANNELS));
+  ASSERT_EQ(end_indices.size(), static_cast<size_t>(N_CHANNELS));
+  for (int channel = 0; channel < N_CHANNELS; ++channel) {
+    int expected_idx = start_indices[channel];
+    for (int column = 0; column < N_COLUMNS; ++column) {
+      if (!has_return(channel, column)) continue;
+      ASSERT_LE(expected_idx, end_indices[channel]);
+      EXPECT_EQ(range_image.get_image_col_indices_sequence()[expected_idx], column);
+      EXPECT_EQ(range_image.get_image_point_indices_sequence()[expected_idx], image_indices(channel, column));
+      EXPECT_NEAR(range_image.get_image_depth_sequence()[expected_idx], pixel_depth(channel, column), 1e-5);
+      ++expected_idx;
+    }
+    EXPECT_EQ(expected_idx, end_indices[channel] + 1);
+  }
+}
+
+TEST(RangeImageTest, ProjectionPathsAgree) {
+  const kcp::SensorModel sensor_model = kcp::SensorModel::uniform(N_CHANNELS, -15, 15);
+
+  // The organized cloud marks missing returns by zeros and NaNs, which the
+  // compact cloud leaves out
+  Eigen::MatrixX3d organized(N_CHANNELS * N_COLUMNS, 3);
+  std::vector<int> compact_rows;
+  Eigen::VectorXi rings, columns;
+  for (int channel = 0; channel < N_CHANNELS; ++channel) {
+    for (int column = 0; column < N_COLUMNS; ++column) {
+      const int idx = channel * N_COLUMNS + column;
+      if (has_return(channel, column)) {
+        organized.row(idx) = pixel_point(sensor_model, channel, column, pixel_depth(channel, column));
+        compact_rows.push_back(idx);
+      } else {
+        organized.row(idx).setConstant(column % 2 ? std::numeric_limits<double>::quiet_NaN() : 0.0);
+      }
+    }
+  }
+  Eigen::MatrixX3d compact(compact_rows.size(), 3);
+  rings.resize(compact_rows.size());
+  columns.resize(compact_rows.size());
+  for (size_t idx = 0; idx < compact_rows.size(); ++idx) {
+    compact.row(idx) = organized.row(compact_rows[idx]);
+    rings(idx)       = compact_rows[idx] / N_COLUMNS;
+    columns(idx)     = compact_rows[idx] % N_COLUMNS;
+  }
+
+  const kcp::keypoint::RangeImage spherical(compact, sensor_model, N_COLUMNS);
+  const kcp::keypoint::RangeImage pixels(compact, rings, columns, N_CHANNELS, N_COLUMNS);
+  expect_same_range_image(pixels, spherical);
+
+  // The organized path indexes the organized cloud
+  const auto from_organized = kcp::keypoint::RangeImage::from_organized(organized, N_CHANNELS, N_COLUMNS);
+  EXPECT_EQ(from_organized.get_image_col_indices_sequence(), spherical.get_image_col_indices_sequence());
+  EXPECT_EQ(from_organized.get_channel_start_indices(), spherical.get_channel_start_indices());
+  EXPECT_EQ(from_organized.get_channel_end_indices(), spherical.get_channel_end_indices());
+  EXPECT_EQ(from_organized.get_image_point_indices_sequence(), compact_rows);
+  const std::vector<float> &depths = from_organized.get_image_depth_sequence();
+  ASSERT_EQ(depths.size(), spherical.get_image_depth_sequence().size());
+  for (size_t idx = 0; idx < depths.size(); ++idx) {
+    EXPECT_FLOAT_EQ(depths[idx], spherical.get_image_depth_sequence()[idx]);
+  }
+
+  // Pixels out of the range image are ignored
+  rings(0)   = -1;
+  columns(1) = N_COLUMNS;
+  const kcp::keypoint::RangeImage clipped(compact, rings, columns, N_CHANNELS, N_COLUMNS);
+  EXPECT_EQ(clipped.get_profile().n_projected_points, compact_rows.size() - 2);
+  EXPECT_THROW(kcp::keypoint::RangeImage::from_organized(compact, N_CHANNELS, N_COLUMNS), std::invalid_argument);
+}
+
+TEST(RangeImageTest, ResetMatchesConstructionAndReusesBuffers) {
+  const Eigen::MatrixX3d first  = load_scan("1531883530.449377000");
+  const Eigen::MatrixX3d second = load_scan("1531883530.949817000");
+
+  kcp::keypoint::RangeImage range_image;
+  range_image.reset(first);
+  range_image.reset(second);
+  expect_same_range_image(range_image, kcp::keypoint::RangeImage(second));
+  range_image.reset(first);
+  expect_same_range_image(range_image, kcp::keypoint::RangeImage(first));
+
+  // The point cloud is viewed, and the sequences keep their buffers when the
+  // same scan is projected again
+  EXPECT_EQ(range_image.get_cloud().data(), first.data());
+  const float *depth_data = range_image.get_image_depth_sequence().data();
+  range_image.reset(first);
+  EXPECT_EQ(range_image.get_image_depth_sequence().data(), depth_data);
+
+  // Temporaries are owned by the range image
+  range_image.reset(Eigen::MatrixX3d(second));
+  EXPECT_NE(range_image.get_cloud().data(), second.data());
+  EXPECT_EQ(Eigen::MatrixX3d(range_image.get_cloud()), second);
+  expect_same_range_image(range_image, kcp::keypoint::RangeImage(second));
+}
+
+/* -------------------------- MultiScaleCurvature --------------------------- */
+
+TEST(MultiScaleCurvatureTest, CurvatureKernelsAgree) {
+  const kcp::keypoint::RangeImage range_image(load_scan("1531883530.449377000"));
+
+  kcp::keypoint::MultiScaleCurvature::Params params;
+  params.curvature_kernel = kcp::keypoint::CurvatureKernel::SCALAR;
+  const kcp::keypoint::MultiScaleCurvature scalar(range_image, params);
+  params.curvature_kernel = kcp::keypoint::CurvatureKernel::AUTO;
+  const kcp::keypoint::MultiScaleCurvature simd(range_image, params);
+
+  // Kernels differ by a few ULPs of the sums of depths
+  const std::vector<float> &expected = scalar.get_curvature();
+  const std::vector<float> &actual   = simd.get_curvature();
+  const std::vector<float> &depths   = range_image.get_image_depth_sequence();
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t idx = 0; idx < actual.size(); ++idx) {
+    EXPECT_NEAR(actual[idx], expected[idx], 1e-5f * std::max(depths[idx], 1.0f)) << "point " << idx;
+  }
+}
+
+TEST(MultiScaleCurvatureTest, SelectionStrategiesAgree) {
+  for (const char *name : {"1531883530.449377000", "1531883530.949817000"}) {
+    const kcp::keypoint::RangeImage range_image(load_scan(name));
+
+    // Caps below and above the number of corner candidates of a segment, and
+    // thresholds selecting few and many keypoints
+    for (const int max_corners_per_segment : {1, 12, 1000}) {
+      for (const float corner_threshold : {1.0f, 30.0f}) {
+        kcp::keypoint::MultiScaleCurvature::Params params;
+        params.max_corners_per_segment = max_corners_per_segment;
+        params.corner_threshold        = corner_threshold;
+        params.plane_threshold         = corner_threshold / 10;
+
+        params.selection = kcp::keypoint::MultiScaleCurvature::Selection::SORT;
+        const kcp::keypoint::MultiScaleCurvature sorted(range_image, params);
+        params.selection = kcp::keypoint::MultiScaleCurvature::Selection::PARTIAL;
+        const kcp::keypoint::MultiScaleCurvature partial(range_image, params);
+
+        SCOPED_TRACE(std::string(name) + ", max_corners_per_segment " + std::to_string(max_corners_per_segment) +
+                     ", corner_threshold " + std::to_string(corner_threshold));
+        EXPECT_GT(sorted.get_corner_point_indices().size(), 0u);
+        EXPECT_GT(sorted.get_plane_point_indices().size(), 0u);
+        expect_same_keypoints(partial, sorted);
+      }
+    }
+  }
+}
+
+TEST(MultiScaleCurvatureTest, DoesNotDependOnThreads) {
+  const Eigen::MatrixX3d first  = load_scan("1531883530.449377000");
+  const Eigen::MatrixX3d second = load_scan("1531883530.949817000");
+  const kcp::keypoint::MultiScaleCurvature serial_first(first);
+  const kcp::keypoint::MultiScaleCurvature serial_second(second);
+
+  // Owned thread pools of several sizes (0 for the hardware threads) and an
+  // external executor, all of which are reused by reset()
+  for (const int n_threads : {2, 4, 0, -1}) {
+    kcp::keypoint::MultiScaleCurvature::Params params;
+    params.n_threads = n_threads;
+    if (n_threads < 0) params.executor = std::make_shared<kcp::ThreadPool>(3);
+
+    SCOPED_TRACE("n_threads " + std::to_string(n_threads));
+    kcp::keypoint::MultiScaleCurvature parallel(kcp::keypoint::RangeImage(first), params);
+    EXPECT_EQ(parallel.get_curvature(), serial_first.get_curvature());
+    expect_same_keypoints(parallel, serial_first);
+
+    kcp::keypoint::RangeImage range_image(second);
+    parallel.reset(range_image);
+    expect_same_keypoints(parallel, serial_second);
+    range_image.reset(first);
+    parallel.reset(range_image);
+    expect_same_keypoints(parallel, serial_first);
+  }
+}
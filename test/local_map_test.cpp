@@ -0,0 +1,187 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <kcp/local_map.hpp>
+#include <kcp/parallel.hpp>
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Uniformly random points in a cube of the given half width.
+ *
+ */
+Eigen::MatrixX3d random_points(Eigen::Index n_points, double half_width, std::mt19937 &rng) {
+  std::uniform_real_distribution<double> coordinate(-half_width, half_width);
+  Eigen::MatrixX3d points(n_points, 3);
+  for (Eigen::Index idx = 0; idx < points.size(); ++idx) points(idx) = coordinate(rng);
+  return points;
+}
+
+/**
+ * @brief A pose of the sensor in the map frame.
+ *
+ */
+Eigen::Matrix4d make_pose(double yaw, const Eigen::Vector3d &translation) {
+  Eigen::Matrix4d pose      = Eigen::Matrix4d::Identity();
+  pose.topLeftCorner(3, 3)  = Eigen::AngleAxisd(yaw, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+  pose.topRightCorner(3, 1) = translation;
+  return pose;
+}
+
+/**
+ * @brief Query the local map with preallocated correspondences.
+ *
+ */
+void search(const kcp::LocalMap &local_map,
+            const Eigen::MatrixX3d &queries,
+            size_t k,
+            kcp::Correspondences &correspondences,
+            std::vector<double> &squared_distances,
+            kcp::Executor *executor = nullptr) {
+  const size_t n_slots = queries.rows() * k;
+  correspondences.points.first.resize(3, n_slots);
+  correspondences.points.second.resize(3, n_slots);
+  correspondences.indices.first.resize(n_slots);
+  correspondences.indices.second.resize(n_slots);
+  local_map.search(queries, queries, k, correspondences, squared_distances, executor);
+}
+
+};  // namespace
+
+TEST(LocalMapTest, SearchMatchesBruteForce) {
+  std::mt19937 rng(1);
+  kcp::LocalMap::Params params;
+  params.max_points_per_voxel = 1000;
+  params.radius               = 1000;
+  kcp::LocalMap local_map(params);
+  local_map.insert(random_points(2000, 20, rng), make_pose(0.3, Eigen::Vector3d(1, 2, 0)));
+  local_map.insert(random_points(2000, 20, rng), make_pose(-0.5, Eigen::Vector3d(-3, 1, 0.5)));
+  const Eigen::MatrixX3d &points = local_map.get_points();
+  ASSERT_EQ(local_map.get_size(), 4000u);
+
+  // Queries within the map, and far away from it, which scan all points
+  Eigen::MatrixX3d queries(400, 3);
+  queries << random_points(300, 25, rng), random_points(100, 200, rng);
+
+  kcp::ThreadPool thread_pool(4);
+  for (const size_t k : {1, 5, 20}) {
+    kcp::Correspondences correspondences, parallel_correspondences;
+    std::vector<double> squared_distances, parallel_squared_distances;
+    search(local_map, queries, k, correspondences, squared_distances);
+
+    for (Eigen::Index query = 0; query < queries.rows(); ++query) {
+      std::vector<double> expected(points.rows());
+      for (Eigen::Index idx = 0; idx < points.rows(); ++idx) {
+        expected[idx] = (points.row(idx) - queries.row(query)).squaredNorm();
+      }
+      std::partial_sort(expected.begin(), expected.begin() + k, expected.end());
+
+      for (size_t i = 0; i < k; ++i) {
+        const size_t slot = query * k + i;
+        const int index   = correspondences.indices.second[slot];
+        ASSERT_GE(index, 0);
+        ASSERT_LT(index, points.rows());
+        EXPECT_DOUBLE_EQ(squared_distances[slot], expected[i]) << "query " << query << ", neighbor " << i;
+        EXPECT_DOUBLE_EQ((points.row(index) - queries.row(query)).squaredNorm(), squared_distances[slot]);
+        EXPECT_EQ(correspondences.indices.first[slot], query);
+        EXPECT_EQ(correspondences.points.first.col(slot), queries.row(query).transpose());
+        EXPECT_EQ(correspondences.points.second.col(slot), points.row(index).transpose());
+      }
+    }
+
+    search(local_map, queries, k, parallel_correspondences, parallel_squared_distances, &thread_pool);
+    EXPECT_EQ(parallel_correspondences.indices.second, correspondences.indices.second);
+    EXPECT_EQ(parallel_squared_distances, squared_distances);
+  }
+}
+
+TEST(LocalMapTest, InsertsTransformedPointsUpToVoxelCapacity) {
+  kcp::LocalMap::Params params;
+  params.max_points_per_voxel = 3;
+  kcp::LocalMap local_map(params);
+
+  // Five points of the same voxel, one of which is not finite
+  Eigen::MatrixX3d scan(5, 3);
+  scan << 0.1, 0.1, 0.1,
+          std::numeric_limits<double>::quiet_NaN(), 0.2, 0.2,
+          0.3, 0.3, 0.3,
+          0.4, 0.4, 0.4,
+          0.5, 0.5, 0.5;
+  const Eigen::Matrix4d pose = make_pose(0, Eigen::Vector3d(10, 20, 30));
+  local_map.insert(scan, pose);
+
+  Eigen::MatrixX3d expected(3, 3);
+  expected << 10.1, 20.1, 30.1,
+              10.3, 20.3, 30.3,
+              10.4, 20.4, 30.4;
+  EXPECT_EQ(local_map.get_n_voxels(), 1u);
+  EXPECT_TRUE(local_map.get_points().isApprox(expected));
+
+  // Other voxels still take points
+  local_map.insert(scan, make_pose(0, Eigen::Vector3d(12, 20, 30)));
+  EXPECT_EQ(local_map.get_n_voxels(), 2u);
+  EXPECT_EQ(local_map.get_size(), 6u);
+
+  local_map.clear();
+  EXPECT_EQ(local_map.get_n_voxels(), 0u);
+  EXPECT_EQ(local_map.get_size(), 0u);
+}
+
+TEST(LocalMapTest, EvictsPointsOutOfRadiusAndAge) {
+  const Eigen::MatrixX3d point    = Eigen::RowVector3d(5, 0, 0);
+  const Eigen::MatrixX3d no_point = Eigen::MatrixX3d(0, 3);
+
+  kcp::LocalMap::Params params;
+  params.radius = 10;
+  kcp::LocalMap local_map(params);
+  local_map.insert(point, Eigen::Matrix4d::Identity());
+  local_map.insert(no_point, make_pose(0, Eigen::Vector3d(12, 0, 0)));
+  EXPECT_EQ(local_map.get_size(), 1u);
+  local_map.insert(no_point, make_pose(0, Eigen::Vector3d(16, 0, 0)));
+  EXPECT_EQ(local_map.get_size(), 0u);
+  EXPECT_EQ(local_map.get_n_voxels(), 0u);
+
+  // Points of the latest ``max_age`` insertions are kept
+  params.max_age = 2;
+  kcp::LocalMap aged_map(params);
+  aged_map.insert(point, Eigen::Matrix4d::Identity());
+  aged_map.insert(point, make_pose(0, Eigen::Vector3d(0, 2, 0)));
+  EXPECT_EQ(aged_map.get_size(), 2u);
+  aged_map.insert(no_point, Eigen::Matrix4d::Identity());
+  ASSERT_EQ(aged_map.get_size(), 1u);
+  EXPECT_EQ(aged_map.get_point(0), Eigen::Vector3d(5, 2, 0));
+}
+
+TEST(LocalMapTest, RejectsInvalidParamsAndQueries) {
+  kcp::LocalMap::Params params;
+  params.voxel_size = 0;
+  EXPECT_THROW(kcp::LocalMap{params}, std::invalid_argument);
+  params = kcp::LocalMap::Params();
+  params.max_points_per_voxel = 0;
+  EXPECT_THROW(kcp::LocalMap{params}, std::invalid_argument);
+
+  std::mt19937 rng(2);
+  kcp::LocalMap local_map;
+  const Eigen::MatrixX3d queries = random_points(10, 5, rng);
+  kcp::Correspondences correspondences;
+  std::vector<double> squared_distances;
+
+  // The map is empty, then holds fewer points than k
+  EXPECT_THROW(search(local_map, queries, 1, correspondences, squared_distances), std::invalid_argument);
+  local_map.insert(random_points(3, 5, rng), Eigen::Matrix4d::Identity());
+  EXPECT_THROW(search(local_map, queries, 4, correspondences, squared_distances), std::invalid_argument);
+  EXPECT_NO_THROW(search(local_map, queries, 3, correspondences, squared_distances));
+
+  const Eigen::MatrixXd features = Eigen::MatrixXd::Zero(queries.rows(), 4);
+  EXPECT_THROW(local_map.search(queries, features, 1, correspondences), std::invalid_argument);
+}
@@ -0,0 +1,137 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <kcp/keypoint.hpp>
+#include <kcp/odometry.hpp>
+#include <kcp/solver.hpp>
+#include <kcp/target.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pcd.hpp"
+
+namespace {
+
+/**
+ * @brief The bundled scans, alternated to make a longer stream.
+ *
+ */
+std::vector<Eigen::MatrixX3d> load_stream(size_t n_scans) {
+  const std::vector<Eigen::MatrixX3d> scans = {
+      load_pcd(std::string(KCP_TEST_DATA_DIR) + "/1531883530.449377000.pcd"),
+      load_pcd(std::string(KCP_TEST_DATA_DIR) + "/1531883530.949817000.pcd"),
+  };
+
+  std::vector<Eigen::MatrixX3d> stream;
+  for (size_t idx = 0; idx < n_scans; ++idx) stream.push_back(scans[idx % scans.size()]);
+  return stream;
+}
+
+};  // namespace
+
+TEST(StreamingOdometryTest, MatchesSequentialRegistration) {
+  const std::vector<Eigen::MatrixX3d> stream = load_stream(5);
+
+  std::vector<kcp::StreamingOdometry::Result> results;
+  const kcp::StreamingOdometry::Params params;
+  {
+    auto collect = [&](const kcp::StreamingOdometry::Result &result) { results.push_back(result); };
+    kcp::StreamingOdometry odometry(params, collect);
+    for (size_t idx = 0; idx < stream.size(); ++idx) EXPECT_EQ(odometry.push(stream[idx]), idx);
+    odometry.flush();
+    EXPECT_EQ(results.size(), stream.size());
+  }
+
+  // Each scan is registered to the previous one in the calling thread
+  kcp::KCP solver(params.kcp);
+  Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+  std::shared_ptr<const kcp::TargetIndex> previous;
+  ASSERT_EQ(results.size(), stream.size());
+  for (size_t idx = 0; idx < stream.size(); ++idx) {
+    const kcp::keypoint::MultiScaleCurvature msc(stream[idx], params.sensor_model, params.hfov_resolution);
+    const Eigen::MatrixX3d &corners = msc.get_corner_points();
+
+    Eigen::Matrix4d solution = Eigen::Matrix4d::Identity();
+    if (previous != nullptr) {
+      solver.solve(corners, corners, *previous);
+      solution = solver.get_solution();
+      pose     = pose * solution;
+    }
+    previous = std::make_shared<const kcp::TargetIndex>(corners, corners);
+
+    SCOPED_TRACE("scan " + std::to_string(idx));
+    EXPECT_EQ(results[idx].index, idx);
+    EXPECT_EQ(results[idx].n_corner_points, static_cast<size_t>(corners.rows()));
+    EXPECT_EQ(results[idx].n_plane_points, static_cast<size_t>(msc.get_plane_points().rows()));
+    EXPECT_TRUE(results[idx].solution.isApprox(solution, 1e-9));
+    EXPECT_TRUE(results[idx].pose.isApprox(pose, 1e-9));
+  }
+}
+
+TEST(StreamingOdometryTest, BoundsCornerPoints) {
+  const std::vector<Eigen::MatrixX3d> stream = load_stream(3);
+
+  kcp::StreamingOdometry::Params params;
+  params.max_corner_points = 100;
+  size_t n_results         = 0;
+  kcp::StreamingOdometry odometry(params, [&](const kcp::StreamingOdometry::Result &result) {
+    EXPECT_LE(result.n_corner_points, params.max_corner_points);
+    EXPECT_GT(result.n_corner_points, 0u);
+    ++n_results;
+  });
+  for (const Eigen::MatrixX3d &scan : stream) odometry.push(scan);
+  odometry.flush();
+  EXPECT_EQ(n_results, stream.size());
+}
+
+TEST(StreamingOdometryTest, FinishesPushedScansOnClose) {
+  const std::vector<Eigen::MatrixX3d> stream = load_stream(4);
+
+  size_t n_results = 0;
+  {
+    kcp::StreamingOdometry odometry(kcp::StreamingOdometry::Params(),
+                                    [&](const kcp::StreamingOdometry::Result &) { ++n_results; });
+    odometry.flush();
+    EXPECT_EQ(n_results, 0u);
+    for (const Eigen::MatrixX3d &scan : stream) odometry.push(scan);
+
+    odometry.close();
+    EXPECT_EQ(n_results, stream.size());
+    EXPECT_NO_THROW(odometry.close());
+    EXPECT_THROW(odometry.push(stream[0]), std::runtime_error);
+    EXPECT_NO_THROW(odometry.flush());
+  }
+
+  // The destructor closes the pipeline as well
+  n_results = 0;
+  {
+    kcp::StreamingOdometry odometry(kcp::StreamingOdometry::Params(),
+                                    [&](const kcp::StreamingOdometry::Result &) { ++n_results; });
+    for (const Eigen::MatrixX3d &scan : stream) odometry.push(scan);
+  }
+  EXPECT_EQ(n_results, stream.size());
+}
+
+TEST(StreamingOdometryTest, RethrowsErrorsOfStages) {
+  const std::vector<Eigen::MatrixX3d> stream = load_stream(4);
+
+  kcp::StreamingOdometry odometry(kcp::StreamingOdometry::Params(), [](const kcp::StreamingOdometry::Result &result) {
+    if (result.index == 1) throw std::logic_error("callback failed");
+  });
+  for (const Eigen::MatrixX3d &scan : stream) {
+    try {
+      odometry.push(scan);
+    } catch (const std::logic_error &) {
+      // The error may already stop later pushes
+      break;
+    }
+  }
+
+  EXPECT_THROW(odometry.flush(), std::logic_error);
+  EXPECT_THROW(odometry.push(stream[0]), std::logic_error);
+}
@@ -0,0 +1,170 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <kcp/sampler.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Generate random points on a few planes, where every ``nan_period``-th
+ * row is non-finite.
+ *
+ */
+template <typename Scalar>
+Eigen::Matrix<Scalar, Eigen::Dynamic, 3> make_cloud(Eigen::Index n_points, Eigen::Index nan_period, std::mt19937 &rng) {
+  std::uniform_real_distribution<double> coordinate(-30, 30);
+  std::uniform_int_distribution<int> plane(0, 3);
+  std::normal_distribution<double> noise(0, 0.02);
+
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 3> cloud(n_points, 3);
+  for (Eigen::Index idx = 0; idx < n_points; ++idx) {
+    const double x = coordinate(rng), y = coordinate(rng);
+    cloud.row(idx) << x, y, 2.0 * plane(rng) + noise(rng);
+    if (nan_period > 0 && idx % nan_period == 0) {
+      cloud(idx, idx % 3) = (idx / nan_period) % 2 ? std::numeric_limits<Scalar>::quiet_NaN()
+                                                   : std::numeric_limits<Scalar>::infinity();
+    }
+  }
+  return cloud;
+}
+
+/**
+ * @brief Indices of finite rows.
+ *
+ */
+template <typename Derived>
+std::vector<int> finite_indices(const Eigen::MatrixBase<Derived> &cloud) {
+  std::vector<int> indices;
+  for (Eigen::Index idx = 0; idx < cloud.rows(); ++idx) {
+    if (cloud.row(idx).allFinite()) indices.push_back(static_cast<int>(idx));
+  }
+  return indices;
+}
+
+/**
+ * @brief Expect sampled indices to be ascending and distinct, to refer to
+ * finite rows, and to match the sampled points.
+ *
+ */
+template <typename Scalar>
+void expect_valid_sample(const kcp::keypoint::BasicVoxelSampler<Scalar> &sampler,
+                         const Eigen::Matrix<Scalar, Eigen::Dynamic, 3> &cloud) {
+  const std::vector<int> &indices = sampler.get_indices();
+  const size_t n_finite           = finite_indices(cloud).size();
+  EXPECT_EQ(indices.size(), std::min(sampler.get_params().max_points, n_finite));
+  EXPECT_TRUE(std::adjacent_find(indices.begin(), indices.end(), std::greater_equal<int>()) == indices.end());
+  ASSERT_EQ(sampler.get_points().rows(), static_cast<Eigen::Index>(indices.size()));
+  for (size_t idx = 0; idx < indices.size(); ++idx) {
+    ASSERT_GE(indices[idx], 0);
+    ASSERT_LT(indices[idx], cloud.rows());
+    EXPECT_TRUE(cloud.row(indices[idx]).allFinite()) << "row " << indices[idx];
+    EXPECT_EQ(sampler.get_points().row(idx), cloud.row(indices[idx]));
+  }
+  EXPECT_EQ(sampler.get_profile().n_sampled_points, indices.size());
+}
+
+/**
+ * @brief Uniformly random scores in [0, 1).
+ *
+ */
+std::vector<float> random_scores(size_t n_points, std::mt19937 &rng) {
+  std::uniform_real_distribution<float> score(0, 1);
+  std::vector<float> scores(n_points);
+  for (float &value : scores) value = score(rng);
+  return scores;
+}
+
+};  // namespace
+
+TEST(VoxelSamplerTest, SamplesFiniteRowsInAscendingOrder) {
+  std::mt19937 rng(1);
+  for (const size_t max_points : {1, 50, 500, 2000, 5000}) {
+    const Eigen::MatrixX3d cloud = make_cloud<double>(3000, 7, rng);
+    const std::vector<float> scores = random_scores(cloud.rows(), rng);
+
+    kcp::keypoint::VoxelSampler::Params params;
+    params.max_points = max_points;
+    kcp::keypoint::VoxelSampler sampler(params);
+
+    sampler.sample(cloud);
+    expect_valid_sample(sampler, cloud);
+    sampler.sample(cloud, scores);
+    expect_valid_sample(sampler, cloud);
+  }
+}
+
+TEST(VoxelSamplerTest, SamplesFiniteRowsInSinglePrecision) {
+  std::mt19937 rng(2);
+  const Eigen::MatrixX3f cloud = make_cloud<float>(4000, 3, rng);
+
+  kcp::keypoint::VoxelSamplerF::Params params;
+  params.max_points = 300;
+  kcp::keypoint::VoxelSamplerF sampler(params);
+  sampler.sample(cloud, random_scores(cloud.rows(), rng));
+  expect_valid_sample(sampler, cloud);
+}
+
+TEST(VoxelSamplerTest, HandlesDegenerateClouds) {
+  kcp::keypoint::VoxelSampler::Params params;
+  params.max_points = 10;
+  kcp::keypoint::VoxelSampler sampler(params);
+
+  // All rows are non-finite
+  Eigen::MatrixX3d cloud = Eigen::MatrixX3d::Constant(20, 3, std::numeric_limits<double>::quiet_NaN());
+  sampler.sample(cloud);
+  expect_valid_sample(sampler, cloud);
+
+  // All finite rows are the same point
+  cloud.topRows(15).setOnes();
+  sampler.sample(cloud);
+  expect_valid_sample(sampler, cloud);
+}
+
+TEST(VoxelSamplerTest, ScoresDoNotChangeSingletonVoxels) {
+  std::mt19937 rng(3);
+  const Eigen::MatrixX3d cloud = make_cloud<double>(1000, 4, rng);
+  const std::vector<int> finite = finite_indices(cloud);
+
+  // With at most ``max_points`` finite points, each of them is its own voxel,
+  // so scores cannot prefer one point over another
+  for (const size_t extra : {0, 1, 100}) {
+    kcp::keypoint::VoxelSampler::Params params;
+    params.max_points = finite.size() + extra;
+    kcp::keypoint::VoxelSampler sampler(params);
+
+    sampler.sample(cloud);
+    EXPECT_EQ(sampler.get_indices(), finite);
+    EXPECT_EQ(sampler.get_voxel_size(), 0);
+
+    sampler.sample(cloud, random_scores(cloud.rows(), rng));
+    EXPECT_EQ(sampler.get_indices(), finite);
+    EXPECT_EQ(sampler.get_voxel_size(), 0);
+  }
+}
+
+TEST(VoxelSamplerTest, ScoresPreferHigherScoredPoints) {
+  std::mt19937 rng(4);
+  const Eigen::MatrixX3d cloud = make_cloud<double>(1000, 4, rng);
+  std::vector<int> finite = finite_indices(cloud);
+  const std::vector<float> scores = random_scores(cloud.rows(), rng);
+
+  // Without a voxel size searched, the lowest scored points are dropped
+  kcp::keypoint::VoxelSampler::Params params;
+  params.max_points = finite.size() - 20;
+  kcp::keypoint::VoxelSampler sampler(params);
+  sampler.sample(cloud, scores);
+  EXPECT_EQ(sampler.get_voxel_size(), 0);
+
+  std::sort(finite.begin(), finite.end(), [&](int lhs, int rhs) { return scores[lhs] > scores[rhs]; });
+  finite.resize(params.max_points);
+  std::sort(finite.begin(), finite.end());
+  EXPECT_EQ(sampler.get_indices(), finite);
+}
@@ -0,0 +1,204 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <kcp/solver.hpp>
+
+#include <Eigen/Geometry>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief The half width and the height of the synthetic room.
+ *
+ */
+constexpr double HALF_WIDTH = 10;
+constexpr double HEIGHT     = 4;
+
+/**
+ * @brief The spacing of target plane points, the same along both axes of a
+ * surface so that neighbors of a point spread on its plane.
+ *
+ */
+constexpr double GRID_STEP = 0.25;
+
+/**
+ * @brief The motion from the source frame to the target frame.
+ *
+ */
+Eigen::Matrix4d ground_truth() {
+  Eigen::Matrix4d transform      = Eigen::Matrix4d::Identity();
+  transform.topLeftCorner(3, 3)  = (Eigen::AngleAxisd(2 * M_PI / 180, Eigen::Vector3d::UnitZ()) *
+                                   Eigen::AngleAxisd(1 * M_PI / 180, Eigen::Vector3d::UnitX()))
+                                      .toRotationMatrix();
+  transform.topRightCorner(3, 1) = Eigen::Vector3d(0.3, -0.2, 0.1);
+  return transform;
+}
+
+/**
+ * @brief Transform points by a rigid transformation.
+ *
+ */
+Eigen::MatrixX3d transform_points(const Eigen::MatrixX3d &points, const Eigen::Matrix4d &transform) {
+  return (points * transform.topLeftCorner<3, 3>().transpose()).rowwise() +
+         transform.topRightCorner<3, 1>().transpose();
+}
+
+/**
+ * @brief A point on the floor (surface 0) or on one of the four walls of the
+ * room, given coordinates along the surface, which are in ``[-HALF_WIDTH,
+ * HALF_WIDTH]`` and in ``[-HALF_WIDTH, HALF_WIDTH]`` (floor) or ``[0,
+ * HEIGHT]`` (walls).
+ *
+ */
+Eigen::RowVector3d surface_point(int surface, double u, double v) {
+  switch (surface) {
+    case 0:
+      return Eigen::RowVector3d(u, v, 0);
+    case 1:
+      return Eigen::RowVector3d(HALF_WIDTH, u, v);
+    case 2:
+      return Eigen::RowVector3d(-HALF_WIDTH, u, v);
+    case 3:
+      return Eigen::RowVector3d(u, HALF_WIDTH, v);
+    default:
+      return Eigen::RowVector3d(u, -HALF_WIDTH, v);
+  }
+}
+
+/**
+ * @brief Target plane points on grids of the surfaces of the room.
+ *
+ */
+Eigen::MatrixX3d grid_plane_points() {
+  std::vector<Eigen::RowVector3d> points;
+  for (int surface = 0; surface < 5; ++surface) {
+    const double min_v = surface == 0 ? -HALF_WIDTH : 0;
+    const double max_v = surface == 0 ? HALF_WIDTH : HEIGHT;
+    for (double u = -HALF_WIDTH; u <= HALF_WIDTH; u += GRID_STEP) {
+      for (double v = min_v; v <= max_v; v += GRID_STEP) points.push_back(surface_point(surface, u, v));
+    }
+  }
+
+  Eigen::MatrixX3d matrix(points.size(), 3);
+  for (size_t idx = 0; idx < points.size(); ++idx) matrix.row(idx) = points[idx];
+  return matrix;
+}
+
+/**
+ * @brief Source plane points at random positions of the surfaces of the room
+ * with noise, in the source frame. Like plane points of the multi-scale
+ * curvature, they stay away from the edges where two surfaces meet.
+ *
+ */
+Eigen::MatrixX3d random_plane_points(Eigen::Index n_points, double noise, std::mt19937 &rng) {
+  const double margin = 0.75;
+  std::uniform_int_distribution<int> surface(0, 4);
+  std::uniform_real_distribution<double> horizontal(-HALF_WIDTH + margin, HALF_WIDTH - margin);
+  std::uniform_real_distribution<double> vertical(margin, HEIGHT - margin);
+  std::normal_distribution<double> perturbation(0, noise);
+
+  Eigen::MatrixX3d points(n_points, 3);
+  for (Eigen::Index idx = 0; idx < n_points; ++idx) {
+    const int s                    = surface(rng);
+    const double u                 = horizontal(rng);
+    const double v                 = s == 0 ? horizontal(rng) : vertical(rng);
+    const Eigen::RowVector3d error = Eigen::RowVector3d(perturbation(rng), perturbation(rng), perturbation(rng));
+    points.row(idx)                = surface_point(s, u, v) + error;
+  }
+  return transform_points(points, ground_truth().inverse());
+}
+
+/**
+ * @brief Expect a transformation to be close to the ground truth.
+ *
+ */
+void expect_close_to_ground_truth(const Eigen::Matrix4d &transform, double max_translation, double max_angle_deg) {
+  const Eigen::Matrix4d difference = ground_truth().inverse() * transform;
+  const double angle               = Eigen::AngleAxisd(Eigen::Matrix3d(difference.topLeftCorner(3, 3))).angle();
+  EXPECT_LT(difference.topRightCorner(3, 1).norm(), max_translation);
+  EXPECT_LT(angle, max_angle_deg * M_PI / 180);
+}
+
+/**
+ * @brief A synthetic scan pair of corner points and plane points.
+ *
+ */
+struct Scene {
+  Eigen::MatrixX3d src_corners, dst_corners, src_planes, dst_planes;
+
+  explicit Scene(std::mt19937 &rng) {
+    // Corners are far apart from each other compared with the motion, so that
+    // their closest points are their true correspondences
+    this->dst_corners.resize(7 * 7 * 2, 3);
+    Eigen::Index idx = 0;
+    for (int x = -3; x <= 3; ++x) {
+      for (int y = -3; y <= 3; ++y) {
+        for (const double z : {1.0, 3.0}) this->dst_corners.row(idx++) << 3 * x, 3 * y, z;
+      }
+    }
+    this->src_corners = transform_points(this->dst_corners, ground_truth().inverse());
+    this->dst_planes  = grid_plane_points();
+    this->src_planes  = random_plane_points(1500, 0.005, rng);
+  }
+};
+
+};  // namespace
+
+/* ------------------------------- Refinement ------------------------------- */
+
+TEST(RefinementTest, ConvergesToGroundTruth) {
+  std::mt19937 rng(1);
+  const Scene scene(rng);
+
+  kcp::KCP::Params params;
+  params.refinement_iterations = 20;
+  kcp::KCP solver(params);
+  solver.solve(scene.src_corners,
+               scene.dst_corners,
+               scene.src_corners,
+               scene.dst_corners,
+               scene.src_planes,
+               scene.dst_planes);
+
+  const int n_iterations = solver.get_profile().n_refinement_iterations;
+  EXPECT_GT(n_iterations, 0);
+  EXPECT_LE(n_iterations, params.refinement_iterations);
+  expect_close_to_ground_truth(solver.get_solution(), 0.005, 0.02);
+
+  // Refining the converged solution again barely moves it
+  const Eigen::Matrix4d solution = solver.get_solution();
+  solver.refine(scene.src_planes, scene.dst_planes);
+  EXPECT_TRUE(solver.get_solution().isApprox(solution, 1e-6));
+}
+
+TEST(RefinementTest, KeepsSolutionWhenDisabledOrWithoutPlanes) {
+  std::mt19937 rng(2);
+  const Scene scene(rng);
+
+  kcp::KCP::Params params;
+  kcp::KCP unrefined(params);
+  unrefined.solve(scene.src_corners, scene.dst_corners, scene.src_corners, scene.dst_corners);
+
+  // Disabled by default
+  kcp::KCP solver(params);
+  solver.solve(scene.src_corners,
+               scene.dst_corners,
+               scene.src_corners,
+               scene.dst_corners,
+               scene.src_planes,
+               scene.dst_planes);
+  EXPECT_EQ(solver.get_profile().n_refinement_iterations, 0);
+  EXPECT_EQ(solver.get_solution(), unrefined.get_solution());
+
+  // Too few plane points to estimate normals
+  solver.get_params().refinement_iterations = 20;
+  EXPECT_EQ(solver.refine(scene.src_planes, scene.dst_planes.topRows(2)), 0);
+  EXPECT_EQ(solver.refine(scene.src_planes.topRows(0), scene.dst_planes), 0);
+  EXPECT_EQ(solver.get_solution(), unrefined.get_solution());
+}
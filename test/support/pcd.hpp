@@ -0,0 +1,111 @@
+// Copyright 2021 Yu-Kai Lin. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Load x, y and z fields of a PCD file with ``DATA ascii`` or ``DATA
+ * binary``, which is enough for the bundled data without depending on PCL.
+ *
+ * @param filename The PCD file.
+ * @return Eigen::MatrixX3d
+ *
+ * @throw std::runtime_error if the file cannot be read, is compressed, or has
+ * no floating-point x, y and z fields.
+ */
+inline Eigen::MatrixX3d load_pcd(const std::string &filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) throw std::runtime_error("Cannot open " + filename);
+
+  std::vector<std::string> fields, types;
+  std::vector<int> sizes, counts;
+  std::string data;
+  size_t n_points = 0;
+
+  std::string line;
+  while (data.empty() && std::getline(file, line)) {
+    std::istringstream stream(line);
+    std::string key, value;
+    stream >> key;
+    if (key == "FIELDS") {
+      while (stream >> value) fields.push_back(value);
+    } else if (key == "SIZE") {
+      while (stream >> value) sizes.push_back(std::stoi(value));
+    } else if (key == "TYPE") {
+      while (stream >> value) types.push_back(value);
+    } else if (key == "COUNT") {
+      while (stream >> value) counts.push_back(std::stoi(value));
+    } else if (key == "POINTS") {
+      stream >> n_points;
+    } else if (key == "DATA") {
+      stream >> data;
+    }
+  }
+  if (counts.empty()) counts.assign(fields.size(), 1);
+  if (sizes.size() != fields.size() || types.size() != fields.size() || counts.size() != fields.size()) {
+    throw std::runtime_error("Malformed PCD header of " + filename);
+  }
+
+  // Locate x, y and z in a record, both as byte offsets and as value indices
+  int xyz_offsets[3] = {-1, -1, -1}, xyz_values[3] = {-1, -1, -1}, xyz_sizes[3] = {0, 0, 0};
+  int record_size = 0, record_values = 0;
+  for (size_t i = 0; i < fields.size(); ++i) {
+    const int axis = fields[i] == "x" ? 0 : fields[i] == "y" ? 1 : fields[i] == "z" ? 2 : -1;
+    if (axis >= 0) {
+      if (types[i] != "F" || (sizes[i] != 4 && sizes[i] != 8)) {
+        throw std::runtime_error("Coordinates of " + filename + " are not floating-point numbers");
+      }
+      xyz_offsets[axis] = record_size;
+      xyz_values[axis]  = record_values;
+      xyz_sizes[axis]   = sizes[i];
+    }
+    record_size += sizes[i] * counts[i];
+    record_values += counts[i];
+  }
+  if (xyz_offsets[0] < 0 || xyz_offsets[1] < 0 || xyz_offsets[2] < 0) {
+    throw std::runtime_error(filename + " has no x, y and z fields");
+  }
+
+  Eigen::MatrixX3d cloud(n_points, 3);
+  if (data == "binary") {
+    std::vector<char> buffer(record_size * n_points);
+    if (!file.read(buffer.data(), buffer.size())) throw std::runtime_error("Truncated data of " + filename);
+
+    for (size_t idx = 0; idx < n_points; ++idx) {
+      const char *record = buffer.data() + idx * record_size;
+      for (int axis = 0; axis < 3; ++axis) {
+        if (xyz_sizes[axis] == 4) {
+          float value;
+          std::memcpy(&value, record + xyz_offsets[axis], sizeof(value));
+          cloud(idx, axis) = value;
+        } else {
+          double value;
+          std::memcpy(&value, record + xyz_offsets[axis], sizeof(value));
+          cloud(idx, axis) = value;
+        }
+      }
+    }
+  } else if (data == "ascii") {
+    std::vector<double> values(record_values);
+    for (size_t idx = 0; idx < n_points; ++idx) {
+      for (auto &value : values) {
+        if (!(file >> value)) throw std::runtime_error("Truncated data of " + filename);
+      }
+      for (int axis = 0; axis < 3; ++axis) cloud(idx, axis) = values[xyz_values[axis]];
+    }
+  } else {
+    throw std::runtime_error("Unsupported PCD data type " + data + " of " + filename);
+  }
+
+  return cloud;
+}